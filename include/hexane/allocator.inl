@@ -1,10 +1,56 @@
 #pragma once
 
 #include <daxa/daxa.inl>
+#include <hexane/constants.inl>
+
+//sizes are rounded up to a multiple of the granule, with one free list per multiple,
+//chunk blobs are at most CHUNK_SIZE * 8 / 32 words so all of them are recycled
+#define ALLOCATOR_SIZE_CLASS_GRANULE 16
+#define ALLOCATOR_SIZE_CLASS_COUNT 9
+
+//set in the size word of a block while it sits on a free list
+#define ALLOCATOR_FREE_BIT 0x80000000u
+#define ALLOCATOR_GUARD 3735928559u
+
+//size and owner in front of the data, guard behind it
+#define ALLOCATOR_BLOCK_OVERHEAD 3
+
+//a compaction cycle starts once more than 1/COMPACT_FREE_RATIO of the heap is free
+#define COMPACT_FREE_RATIO 8
+//upper bounds on the work one compaction slice does, so it fits in a frame
+#define COMPACT_SLICE_WORDS 4096
+#define COMPACT_SLICE_BLOCKS 256
+#define COMPACT_INVOKE_SIZE 256
+
+//owner of a chunk blob, the chunk that has to be rewritten when it moves
+#define ALLOCATOR_OWNER(region_index, chunk_index) ((region_index) * REGION_SIZE + (chunk_index))
+
+struct AllocatorStats {
+    //words in live blocks, size, owner and guard words included
+    daxa_u32 allocated_words;
+    //words in blocks waiting on a free list
+    daxa_u32 free_words;
+    daxa_u32 allocation_count;
+    daxa_u32 reuse_count;
+    daxa_u32 free_count;
+    daxa_u32 failed_count;
+    daxa_u32 compacted_words;
+    daxa_u32 compact_cycles;
+};
 
 struct Allocator {
     daxa_u32 heap_offset;
     daxa_BufferPtr(daxa_u32) heap;
+    //capacity of heap in words, allocations past it fail
+    daxa_u32 heap_size;
+    //address of the first free block per size class, 0 when empty
+    daxa_u32 free_heads[ALLOCATOR_SIZE_CLASS_COUNT];
+    //while compacting, [0, compact_offset) holds moved blocks, [compact_offset,
+    //compact_cursor) is a hole and the rest has not been visited yet
+    daxa_u32 compacting;
+    daxa_u32 compact_cursor;
+    daxa_u32 compact_offset;
+    AllocatorStats stats;
 };
 
 DAXA_ENABLE_BUFFER_PTR(Allocator)
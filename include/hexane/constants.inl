@@ -2,7 +2,8 @@
 
 #include <daxa/daxa.inl>
 
-#define CHUNKS_PER_FRAME 10
+//default per frame budget of the queue, at most the workspace
+#define CHUNKS_PER_FRAME 512
 
 #define AXIS_CHUNK_SIZE 8
 #define CHUNK_SIZE 512
@@ -14,15 +15,46 @@
 
 #define PALETTES_SIZE 64
 
+//the workspace is AXIS_WORKSPACE_SIZE chunks wide and deep, main.cpp stacks
+//as many layers as the largest chunk budget needs, up to WORKSPACE_SIZE chunks
 #define AXIS_WORKSPACE_SIZE 8
-#define WORKSPACE_SIZE 512
+#define WORKSPACE_LAYER_SIZE (AXIS_WORKSPACE_SIZE * AXIS_WORKSPACE_SIZE)
+#define WORKSPACE_SIZE 4096
 #define WORKSPACE_MAXIMUM daxa_u32vec3(AXIS_WORKSPACE_SIZE)
 
+//queue.glsl runs in one workgroup and sorts regions into this many priorities,
+//the first half for regions in the view frustum and the second for the rest
+#define QUEUE_INVOKE_SIZE 512
+#define QUEUE_PRIORITY_COUNT 8
+#define QUEUE_DISTANCE_PRIORITY_COUNT (QUEUE_PRIORITY_COUNT / 2)
+//bounding sphere of a region, in regions
+#define QUEUE_REGION_RADIUS 0.8660254
+//completed regions the queue hands to the uniformity pass per frame, at most
+//WORKSPACE_SIZE
+#define UNIFORMITY_REGIONS_PER_FRAME 8
+//uniformity blocks of 2, 4, 8, 16 and 32 voxels
+#define UNIFORMITY_LEVEL_COUNT 5
+//uniformity.glsl reduces one block of the largest level per workgroup
+#define UNIFORMITY_BLOCK_SIZE 32
+//UniSpec::block_mask of a whole region, 8 blocks of UNIFORMITY_BLOCK_SIZE
+#define UNIFORMITY_ALL_BLOCKS 0xFF
+
 #undef VOID
 #define VOID 0
 
-#define VOLUME_MAX 1000000
+//the volume is a window of AXIS_VIEW_SIZE regions per axis around the camera,
+//regions that leave it are evicted and their cells reused for the ones entering
+#define AXIS_VIEW_SIZE 8
+#define VIEW_SIZE 512
+//regions between the camera and the side of the window before it moves
+#define VIEW_MARGIN 2
+//entries in the region hash, a power of two at least twice VIEW_SIZE
+#define VOLUME_HASH_SIZE 1024
+
+//the prepare passes of raytrace.glsl cull every view cell in one workgroup
+#define PREPARE_INVOKE_SIZE 512
+#define PREPARE_CELLS_PER_INVOCATION (VIEW_SIZE / PREPARE_INVOKE_SIZE)
 
-#define AXIS_WORLD_SIZE 512
+#define PREPASS_SCALE 1
 
-#define PREPASS_SCALE 1
\ No newline at end of file
+#define GIGABYTE daxa_u32(1e+9)
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <daxa/daxa.inl>
+#include <hexane/constants.inl>
+#include <hexane/util.inl>
+
+//edits uploaded per frame, the host keeps the rest for the frames after
+#define EDITS_PER_FRAME 64
+//chunks the edits of a frame may cover, the workspace always holds as many
+#define EDIT_CHUNKS_PER_FRAME 512
+
+#define EDIT_SHAPE_BOX 0
+#define EDIT_SHAPE_SPHERE 1
+
+//Sets every voxel of a shape to block_id, BLOCK_ID_AIR removes them. A box
+//covers center +- extent, a sphere is the ellipsoid inside that box and a
+//single voxel is a box of extent 0. Only chunks that were generated already
+//are edited, the rest come from the brush later on.
+struct Edit {
+    daxa_u32 shape;
+    daxa_u32 block_id;
+    daxa_i32vec3 center;
+    daxa_u32vec3 extent;
+};
+
+//applied in order, a later edit wins where two overlap
+struct Edits {
+    daxa_u32 edit_count;
+    Edit edit[EDITS_PER_FRAME];
+};
+
+INLINE bool edit_contains(Edit edit, daxa_i32vec3 position) {
+    daxa_i32 x = position.x - edit.center.x;
+    daxa_i32 y = position.y - edit.center.y;
+    daxa_i32 z = position.z - edit.center.z;
+
+    if(x > daxa_i32(edit.extent.x) || -x > daxa_i32(edit.extent.x)
+        || y > daxa_i32(edit.extent.y) || -y > daxa_i32(edit.extent.y)
+        || z > daxa_i32(edit.extent.z) || -z > daxa_i32(edit.extent.z)) {
+        return false;
+    }
+
+    if(edit.shape == EDIT_SHAPE_BOX) {
+        return true;
+    }
+
+    daxa_f32 u = daxa_f32(x) / (daxa_f32(edit.extent.x) + 0.5f);
+    daxa_f32 v = daxa_f32(y) / (daxa_f32(edit.extent.y) + 0.5f);
+    daxa_f32 w = daxa_f32(z) / (daxa_f32(edit.extent.z) + 0.5f);
+
+    return u * u + v * v + w * w <= 1.0f;
+}
+
+//first world chunk of the bounds of an edit
+INLINE daxa_u32vec3 edit_chunk_minimum(Edit edit) {
+    daxa_i32 x = edit.center.x - daxa_i32(edit.extent.x);
+    daxa_i32 y = edit.center.y - daxa_i32(edit.extent.y);
+    daxa_i32 z = edit.center.z - daxa_i32(edit.extent.z);
+
+    daxa_u32vec3 minimum;
+    minimum.x = daxa_u32(x > 0 ? x : 0) / AXIS_CHUNK_SIZE;
+    minimum.y = daxa_u32(y > 0 ? y : 0) / AXIS_CHUNK_SIZE;
+    minimum.z = daxa_u32(z > 0 ? z : 0) / AXIS_CHUNK_SIZE;
+    return minimum;
+}
+
+//world chunk after the last one of the bounds of an edit, world positions
+//are never negative so bounds below zero end at chunk 0
+INLINE daxa_u32vec3 edit_chunk_maximum(Edit edit) {
+    daxa_i32 x = edit.center.x + daxa_i32(edit.extent.x) + 1;
+    daxa_i32 y = edit.center.y + daxa_i32(edit.extent.y) + 1;
+    daxa_i32 z = edit.center.z + daxa_i32(edit.extent.z) + 1;
+
+    daxa_u32vec3 maximum;
+    maximum.x = (daxa_u32(x > 0 ? x : 0) + AXIS_CHUNK_SIZE - 1) / AXIS_CHUNK_SIZE;
+    maximum.y = (daxa_u32(y > 0 ? y : 0) + AXIS_CHUNK_SIZE - 1) / AXIS_CHUNK_SIZE;
+    maximum.z = (daxa_u32(z > 0 ? z : 0) + AXIS_CHUNK_SIZE - 1) / AXIS_CHUNK_SIZE;
+    return maximum;
+}
+
+//chunks in the bounds of an edit, an upper bound of the workspace it takes
+INLINE daxa_u32 edit_chunk_count(Edit edit) {
+    daxa_u32vec3 minimum = edit_chunk_minimum(edit);
+    daxa_u32vec3 maximum = edit_chunk_maximum(edit);
+
+    if(maximum.x <= minimum.x || maximum.y <= minimum.y || maximum.z <= minimum.z) {
+        return 0;
+    }
+
+    return (maximum.x - minimum.x) * (maximum.y - minimum.y) * (maximum.z - minimum.z);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <daxa/daxa.inl>
+#include <hexane/constants.inl>
 
 struct DrawIndirect {
     daxa_u32    vertex_count;
@@ -14,3 +15,12 @@ struct DispatchIndirect {
     daxa_u32    y;
     daxa_u32    z;
 };
+
+//written by queue.glsl for the passes after it
+struct QueueDispatch {
+    //{spec_count, 1, 1}, one workgroup per queued chunk for the brush and
+    //compressor passes, so they cost nothing once the world is built
+    DispatchIndirect generation;
+    //one workgroup per UNIFORMITY_BLOCK_SIZE block of every region in unispecs
+    DispatchIndirect uniformity;
+};
@@ -6,6 +6,32 @@
 #include <hexane/workspace.inl>
 #include <hexane/volume.inl>
 
+//width of a packed palette index, the integer form of ceil(log2(palette_count))
+INLINE daxa_u32 palette_index_bits(daxa_u32 palette_count) {
+#ifdef DAXA_SHADER
+	return palette_count > 1 ? daxa_u32(findMSB(palette_count - 1)) + 1 : 0;
+#else
+	return palette_count > 1 ? daxa_u32(std::bit_width(palette_count - 1)) : 0;
+#endif
+}
+
+//rounds the width up to 1, 2, 4 or 8 bits so no index straddles a heap word,
+//which costs up to 8 bits per voxel where 5 would do
+INLINE daxa_u32 palette_index_bits_pow2(daxa_u32 palette_count) {
+	daxa_u32 index_bits = palette_index_bits(palette_count);
+	return index_bits > 1 ? 1u << palette_index_bits(index_bits) : index_bits;
+}
+
+//packed indices may straddle two heap words, high is only read when they do
+INLINE daxa_u32 palette_index_extract(daxa_u32 low, daxa_u32 high, daxa_u32 bit_offset, daxa_u32 index_bits) {
+	daxa_u32 u32_bits = 32;
+	daxa_u32 palette_id = low >> bit_offset;
+	if(bit_offset + index_bits > u32_bits) {
+		palette_id |= high << (u32_bits - bit_offset);
+	}
+	return palette_id & ((1u << index_bits) - 1u);
+}
+
 #ifdef DAXA_SHADER
 struct Query {
 	daxa_BufferPtr(Volume) volume;
@@ -22,17 +48,23 @@ bool query(inout Query query) {
 	INDICES(query.volume, query.position)
 
 	daxa_u32 u32_bits = 32;
-    daxa_u32 index_bits = daxa_u32(ceil(log2(daxa_f32(deref(deref(query.regions).data[region_index]).chunks[chunk_index].palette_count))));
+	daxa_u32 index_bits = deref(deref(query.regions).data[region_index]).chunks[chunk_index].index_bits;
 
 	daxa_u32 palette_id = 0;
 
-	for(daxa_u32 bit = 0; bit < index_bits; bit++) {
-		daxa_u32 bit_index = local_index * index_bits 
-			+ bit
-			+ u32_bits * deref(deref(query.regions).data[region_index]).chunks[chunk_index].heap_offset;
-		daxa_u32 heap_offset = bit_index / u32_bits;
+	if(index_bits != 0) {
+		daxa_u32 bit_index = local_index * index_bits;
+		daxa_u32 heap_offset = deref(deref(query.regions).data[region_index]).chunks[chunk_index].heap_offset
+			+ bit_index / u32_bits;
 		daxa_u32 bit_offset = bit_index % u32_bits;
-		palette_id |= ((deref(deref(query.allocator).heap[heap_offset]) >> bit_offset) & 1u) << bit;
+
+		daxa_u32 low = deref(deref(query.allocator).heap[heap_offset]);
+		daxa_u32 high = 0;
+		if(bit_offset + index_bits > u32_bits) {
+			high = deref(deref(query.allocator).heap[heap_offset + 1]);
+		}
+
+		palette_id = palette_index_extract(low, high, bit_offset, index_bits);
 	}
 
 	query.information = deref(deref(query.regions).data[region_index]).chunks[chunk_index].palettes[palette_id].information;
@@ -2,11 +2,17 @@
 
 #include <daxa/daxa.inl>
 
+//left, right, bottom, top and near, the far plane is left to the distance
+//priority in queue.glsl
+#define FRUSTUM_PLANE_COUNT 5
+
 struct Camera {
     daxa_f32mat4x4 projection;
     daxa_f32mat4x4 inv_projection;
     daxa_f32mat4x4 view;
     daxa_f32mat4x4 transform;
+    //world space, a point is inside when dot(plane.xyz, point) + plane.w >= 0
+    daxa_f32vec4 frustum_planes[FRUSTUM_PLANE_COUNT];
 };
 
 struct Perframe {
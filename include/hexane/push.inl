@@ -6,19 +6,30 @@
 #include <hexane/allocator.inl>
 #include <hexane/specs.inl>
 #include <hexane/indirect.inl>
+#include <hexane/edit.inl>
 
 DAXA_ENABLE_BUFFER_PTR(Perframe)
 DAXA_ENABLE_BUFFER_PTR(Specs)
 DAXA_ENABLE_BUFFER_PTR(UniSpecs)
 DAXA_ENABLE_BUFFER_PTR(RaytraceSpecs)
 DAXA_ENABLE_BUFFER_PTR(DrawIndirect)
+DAXA_ENABLE_BUFFER_PTR(QueueDispatch)
+DAXA_ENABLE_BUFFER_PTR(Edits)
 
 //PUSH CONSTANTS
 struct QueuePush {
+     daxa_BufferPtr(Perframe) perframe;
      daxa_BufferPtr(Volume) volume;
      daxa_BufferPtr(Regions) regions;
+     //heap of the regions evicted from the view
+     daxa_BufferPtr(Allocator) allocator;
      daxa_BufferPtr(Specs) specs;
      daxa_BufferPtr(UniSpecs) unispecs;
+     daxa_BufferPtr(QueueDispatch) dispatch;
+     //at most the workspace main.cpp created, never more than WORKSPACE_SIZE
+     daxa_u32 chunk_budget;
+     //0 queues regions in volume order
+     daxa_u32 streaming;
 };
 
 struct BrushPush {
@@ -34,6 +45,25 @@ struct CompressorPush {
      daxa_BufferPtr(Allocator) allocator;
 };
 
+//EDIT_QUEUE lists the chunks and uniformity blocks the edits touch in specs,
+//unispecs and dispatch, EDIT_APPLY decompresses those chunks into the
+//workspace with the edits applied for the compressor to take over
+struct EditPush {
+     daxa_RWImage3Du32 workspace;
+     daxa_BufferPtr(Edits) edits;
+     daxa_BufferPtr(Volume) volume;
+     daxa_BufferPtr(Regions) regions;
+     daxa_BufferPtr(Allocator) allocator;
+     daxa_BufferPtr(Specs) specs;
+     daxa_BufferPtr(UniSpecs) unispecs;
+     daxa_BufferPtr(QueueDispatch) dispatch;
+};
+
+struct CompactPush {
+     daxa_BufferPtr(Regions) regions;
+     daxa_BufferPtr(Allocator) allocator;
+};
+
 struct RaytraceDrawPush {
      daxa_BufferPtr(RaytraceSpecs) raytrace_specs;
      daxa_BufferPtr(Regions) regions;
@@ -49,6 +79,21 @@ struct RaytracePreparePush {
      daxa_BufferPtr(RaytraceSpecs) raytrace_specs;
 };
 
+#define RAYTRACE_DEBUG_NONE 0
+#define RAYTRACE_DEBUG_STEPS 1
+
+//one invocation per pixel of the render area, no cube geometry
+struct RaytraceTracePush {
+     daxa_BufferPtr(Volume) volume;
+     daxa_BufferPtr(Regions) regions;
+     daxa_BufferPtr(Perframe) perframe;
+     daxa_BufferPtr(Allocator) allocator;
+     daxa_RWImage2Df32 render;
+     daxa_u32vec2 resolution;
+     //RAYTRACE_DEBUG_STEPS shows steps and regions per pixel instead of the shading
+     daxa_u32 debug_view;
+};
+
 struct UniformityPush {
      daxa_BufferPtr(UniSpecs) unispecs;
      daxa_BufferPtr(Regions) regions;
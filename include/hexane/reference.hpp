@@ -0,0 +1,178 @@
+#pragma once
+
+#include <hexane/edit.inl>
+#include <hexane/information.inl>
+#include <hexane/rtx.inl>
+#include <hexane/shared.inl>
+#include <hexane/terrain.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Host-side reference of the generation pipeline in queue.glsl,
+// base_terrain.glsl, compressor.glsl and uniformity.glsl. It keeps the exact
+// Volume/Region/Chunk/heap layout the shaders use, so the storage format can be
+// profiled and diffed against GPU readbacks without a device.
+
+// Returns the block id at a world position, the host analogue of a brush
+// shader such as world_gen_base() in terrain.inl.
+using Brush = std::function<daxa_u32(daxa_i32vec3)>;
+
+struct ThreadPool {
+  explicit ThreadPool(daxa_u32 thread_count);
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool &operator=(ThreadPool const &) = delete;
+  ~ThreadPool();
+
+  // Runs task(i) for every i in [0, count), the calling thread helps out.
+  void parallel_for(daxa_u32 count,
+                    std::function<void(daxa_u32)> const &task);
+
+  daxa_u32 thread_count() const {
+    return static_cast<daxa_u32>(workers.size()) + 1;
+  }
+
+  void worker_loop();
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::function<void(daxa_u32)> const *task = nullptr;
+  daxa_u32 task_count = 0;
+  std::atomic<daxa_u32> next_task = 0;
+  daxa_u32 busy = 0;
+  daxa_u64 generation = 0;
+  bool stopping = false;
+};
+
+struct ReferenceRay {
+  // one of the RAY_STATE_ values in rtx.inl
+  daxa_u32 state_id = RAY_STATE_INITIAL;
+  daxa_u32 block_id = 0;
+  // voxel the ray stopped in
+  daxa_i32vec3 voxel = {};
+  // iterations of ray_cast_drive() that moved the ray
+  daxa_u32 step_count = 0;
+};
+
+struct ReferenceEngineInfo {
+  daxa_u32 thread_count = std::thread::hardware_concurrency();
+  // same capacities as heap_buffer and regions_array_buffer in main.cpp
+  daxa_u32 heap_capacity = (GIGABYTE / 2) / sizeof(daxa_u32);
+  daxa_u32 region_capacity = VIEW_SIZE + 1;
+  // compressor.glsl compiled with PALETTE_INDEX_POW2
+  bool pow2_index_bits = false;
+  // INDICES compiled with VOLUME_HASH
+  bool region_hash = false;
+};
+
+struct ReferenceEngine {
+  explicit ReferenceEngine(ReferenceEngineInfo const &info = {});
+
+  // One frame of the generation part of loop_task_list, in task order.
+  void generate(Brush const &brush);
+  // True once queue() stops producing specs and unispecs.
+  bool generation_complete() const;
+
+  void queue();
+  void brush(Brush const &brush);
+  // brush() with world_gen_base() in terrain.inl, a whole chunk per call so
+  // the AVX2 path of world_gen_base_chunk() can be used.
+  void brush_terrain(bool avx2 = terrain_avx2_supported());
+  // The compressor and uniformity passes run over the queued chunks and
+  // regions, or over the ones of an edit batch.
+  void compressor_free(Specs const &specs);
+  void compressor_free() { compressor_free(*specs); }
+  void compressor_palettize(Specs const &specs);
+  void compressor_palettize() { compressor_palettize(*specs); }
+  void compressor_allocate(Specs const &specs);
+  void compressor_allocate() { compressor_allocate(*specs); }
+  void compressor_occupy(RegionOccupancy &occupancy, daxa_u32vec3 position);
+  void compressor_write(Specs const &specs);
+  void compressor_write() { compressor_write(*specs); }
+  // Same as COMPRESSOR_FUSED, brush() and the palettize, allocate and write
+  // passes above for one chunk at a time without going through the
+  // workspace. compressor_free() has to run first, like the free task in
+  // front of the fused one. Heap offsets depend on the order the chunks
+  // finish in.
+  void compressor_fused(Brush const &brush);
+  // What every pass does for one chunk, voxels are its CHUNK_SIZE block ids.
+  void compressor_free_chunk(Spec spec);
+  void compressor_palettize_chunk(Spec spec, daxa_u32 const *voxels);
+  void compressor_allocate_chunk(Spec spec);
+  void compressor_write_chunk(Spec spec, daxa_u32 const *voxels);
+  void compact_slice();
+  void uniformity(UniSpecs const &unispecs);
+  void uniformity() { uniformity(*unispecs); }
+
+  // One frame of the edit tasks of loop_task_list, in task order. The batch
+  // holds at most EDITS_PER_FRAME edits whose edit_chunk_count() add up to
+  // EDIT_CHUNKS_PER_FRAME or less, the same limits EditQueue in main.cpp
+  // keeps.
+  void edit(Edits const &edits);
+  // Same as EDIT_QUEUE and EDIT_APPLY in edit.glsl.
+  void edit_queue(Edits const &edits);
+  void edit_apply(Edits const &edits);
+
+  // Same lookup as query() in information.inl.
+  bool query(daxa_u32vec3 position, daxa_u32 &information) const;
+  // Same region lookup as INDICES in workspace.inl.
+  daxa_u32 region_slot(daxa_u32vec3 region_position) const;
+  // Same traversal as ray_cast_drive() in rtx.inl for a ray stopping in
+  // [minimum, maximum), with or without RAYTRACE_UNIFORMITY.
+  ReferenceRay ray_cast(daxa_f32vec3 origin, daxa_f32vec3 direction,
+                        daxa_i32vec3 minimum, daxa_i32vec3 maximum,
+                        bool uniformity) const;
+  daxa_u32 sample_lod(daxa_u32vec3 position) const;
+  daxa_u32 sample_occupancy(daxa_u32vec3 position) const;
+
+  // Same as the helpers of the same name in queue.glsl.
+  bool queue_visible(daxa_u32vec3 origin) const;
+  daxa_u32 queue_priority(daxa_u32vec3 origin) const;
+  daxa_u32vec3 queue_window_origin(daxa_u32vec3 origin) const;
+  void queue_evict(daxa_u32 slot);
+  void queue_hash_insert(daxa_u32vec3 region_position, daxa_u32 slot);
+
+  Region &region(daxa_u32 region_index);
+  Region const &region(daxa_u32 region_index) const;
+  daxa_u32 index_bits(daxa_u32 palette_count) const;
+  daxa_u32 heap_word(daxa_u32 address) const;
+  daxa_u32 shader_malloc_block(daxa_u32 address, daxa_u32 size,
+                               daxa_u32 owner);
+  daxa_u32 shader_malloc(daxa_u32 size, daxa_u32 owner);
+  void shader_free(daxa_u32 address);
+
+  ReferenceEngineInfo info;
+  ThreadPool pool;
+
+  // perframe.camera.transform[3].xyz and frustum_planes, in regions. queue()
+  // keeps the view window around the camera and fills regions in the frustum
+  // first, then the nearby ones; all zero planes see everything.
+  daxa_f32vec3 camera_position = {0.0f, 0.0f, 0.0f};
+  daxa_f32vec4 frustum_planes[FRUSTUM_PLANE_COUNT] = {};
+  // QueuePush::chunk_budget and QueuePush::streaming
+  daxa_u32 chunk_budget = CHUNKS_PER_FRAME;
+  bool streaming = true;
+
+  std::unique_ptr<Volume> volume;
+  Regions regions = {};
+  std::vector<Region> region_data;
+  Allocator allocator = {};
+  std::vector<daxa_u32> heap;
+  // held around shader_malloc() by compressor_fused()
+  std::mutex allocator_mutex;
+  std::unique_ptr<Specs> specs;
+  std::unique_ptr<UniSpecs> unispecs;
+  // edit_specs_buffer and edit_unispecs_buffer
+  std::unique_ptr<Specs> edit_specs;
+  std::unique_ptr<UniSpecs> edit_unispecs;
+  // chunk-major copy of workspace_image, CHUNK_SIZE voxels per workspace
+  // chunk. brush() overwrites every queued chunk, so it is never cleared.
+  std::vector<daxa_u32> workspace;
+};
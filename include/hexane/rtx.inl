@@ -3,8 +3,6 @@
 #include <daxa/daxa.inl>
 #include <hexane/information.inl>
 
-#ifdef DAXA_SHADER
-
 #define MAX_STEP_COUNT 1024
 #define RAY_STATE_INITIAL 0
 #define RAY_STATE_OUT_OF_BOUNDS 1
@@ -12,6 +10,8 @@
 #define RAY_STATE_MAX_STEP_REACHED 3
 #define RAY_STATE_VOXEL_FOUND 4
 
+#ifdef DAXA_SHADER
+
 struct RayDescriptor {
     daxa_BufferPtr(Volume) volume;
     daxa_BufferPtr(Regions) regions;
@@ -48,6 +48,10 @@ struct Hit {
 	daxa_u32 block_id;
 };
 
+//Compiled with RAYTRACE_UNIFORMITY rays skip through the uniform blocks of
+//RegionUniformity and query the palette on every step. Otherwise they descend
+//the RegionOccupancy 64-tree and only query the voxel they stop at.
+#ifdef RAYTRACE_UNIFORMITY
 daxa_u32 sample_lod(inout Ray ray) {	
     bool inside = all(greaterThanEqual(daxa_i32vec3(ray.position), ray.descriptor.minimum))
 		&& all(lessThan(daxa_i32vec3(ray.position), ray.descriptor.maximum));
@@ -70,6 +74,11 @@ daxa_u32 sample_lod(inout Ray ray) {
 
     INDICES(q.volume, q.position)
 
+    //regions that are not resident are crossed in one step
+    if(region_index == 0) {
+        return 6;
+    }
+
     daxa_u32 i;
 
 	daxa_u32vec3 p = q.position % (AXIS_CHUNK_SIZE * AXIS_REGION_SIZE);
@@ -92,10 +101,35 @@ daxa_u32 sample_lod(inout Ray ray) {
 
     return 0;
 }
+#else
+//edge of the empty cell around the ray in voxels, 0 if its voxel is occupied
+daxa_u32 sample_occupancy(inout Ray ray) {
+	daxa_u32vec3 position = daxa_u32vec3(daxa_i32vec3(ray.position));
+
+	INDICES(ray.descriptor.volume, position)
+
+	if(region_index == 0) {
+		return AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+	}
 
-void ray_cast_body(inout Ray ray) {
-	daxa_u32 voxel = daxa_u32(pow(2, sample_lod(ray)));
+	daxa_u32vec3 p = position % (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE);
 
+	daxa_u32 bit = occupancy_bit(p, 16);
+	if(((deref(deref(ray.descriptor.regions).data[region_index]).occupancy.nodes[bit / 32] >> (bit % 32)) & 1) == 0)
+		return 16;
+	bit = occupancy_bit(p, 4);
+	if(((deref(deref(ray.descriptor.regions).data[region_index]).occupancy.bricks[bit / 32] >> (bit % 32)) & 1) == 0)
+		return 4;
+	bit = occupancy_bit(p, 1);
+	if(((deref(deref(ray.descriptor.regions).data[region_index]).occupancy.voxels[bit / 32] >> (bit % 32)) & 1) == 0)
+		return 1;
+
+	return 0;
+}
+#endif
+
+//steps to the far side of the aligned cell of edge voxel around the ray
+void ray_cast_body(inout Ray ray, daxa_u32 voxel) {
     vec3 t_max = ray.delta_dist * (daxa_f32(voxel) * ray.step01 - mod(ray.position, daxa_f32(voxel)));
 
 	ray.mask = lessThanEqual(t_max.xyz, min(t_max.yzx, t_max.zxy));
@@ -210,11 +244,21 @@ bool ray_cast_drive(inout Ray ray) {
 		return false;
 	}
 
+#ifdef RAYTRACE_UNIFORMITY
 	if(ray_cast_check_success(ray)) {
 		return false;
 	}
 	
-	ray_cast_body(ray);
+	ray_cast_body(ray, 1u << sample_lod(ray));
+#else
+	daxa_u32 cell_size = sample_occupancy(ray);
+
+	if(cell_size == 0 && ray_cast_check_success(ray)) {
+		return false;
+	}
+
+	ray_cast_body(ray, max(cell_size, 1));
+#endif
 
 	return true;
 }
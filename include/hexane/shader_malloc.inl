@@ -1,9 +1,111 @@
-daxa_u32 shader_malloc(daxa_u32 size) {
-    daxa_u32 result_address = atomicAdd(deref(push.allocator).heap_offset, size + 2);
+//Blocks are framed by their size and owner at the beginning and DEADBEEF at
+//the end. Freed blocks go on a per size class list threaded through their
+//first word, which is the guard for empty blocks.
+//
+//The lists are only safe because shader_malloc, shader_free and compaction
+//never run in the same dispatch: pops can't race pushes, so there is no ABA
+//to worry about.
+
+//blocks come back holding stale words, the write passes store every index
+//word of a blob outright and nothing reads the size class padding
+daxa_u32 shader_malloc_block(daxa_u32 address, daxa_u32 size, daxa_u32 owner) {
     //SIZE as the beginning
-    deref(deref(push.allocator).heap[result_address]) = size + 2;
+    deref(deref(push.allocator).heap[address - 2]) = size + ALLOCATOR_BLOCK_OVERHEAD;
+    deref(deref(push.allocator).heap[address - 1]) = owner;
     //DEADBEEF at the end
-    deref(deref(push.allocator).heap[result_address + size + 1])  = 3735928559;
+    deref(deref(push.allocator).heap[address + size]) = ALLOCATOR_GUARD;
+
+    atomicAdd(deref(push.allocator).stats.allocated_words, size + ALLOCATOR_BLOCK_OVERHEAD);
+    atomicAdd(deref(push.allocator).stats.allocation_count, 1);
+
+    return address;
+}
+
+daxa_u32 shader_malloc(daxa_u32 size, daxa_u32 owner) {
+    daxa_u32 size_class = (size + ALLOCATOR_SIZE_CLASS_GRANULE - 1) / ALLOCATOR_SIZE_CLASS_GRANULE;
+
+    if(size_class < ALLOCATOR_SIZE_CLASS_COUNT) {
+        size = size_class * ALLOCATOR_SIZE_CLASS_GRANULE;
+
+        daxa_u32 address = deref(push.allocator).free_heads[size_class];
+
+        while(address != 0) {
+            daxa_u32 next = deref(deref(push.allocator).heap[address]);
+            daxa_u32 old_address = atomicCompSwap(deref(push.allocator).free_heads[size_class], address, next);
+
+            if(old_address == address) {
+                atomicAdd(deref(push.allocator).stats.free_words, -(size + ALLOCATOR_BLOCK_OVERHEAD));
+                atomicAdd(deref(push.allocator).stats.reuse_count, 1);
+
+                return shader_malloc_block(address, size, owner);
+            }
+
+            address = old_address;
+        }
+    }
+
+    //while compacting, blocks are cut from the gap between compact_offset and
+    //compact_cursor before the tail grows, otherwise edits could bump the heap
+    //faster than the slices catch up with heap_offset
+    if(deref(push.allocator).compacting != 0) {
+        daxa_u32 offset = deref(push.allocator).compact_offset;
+
+        while(offset + size + ALLOCATOR_BLOCK_OVERHEAD <= deref(push.allocator).compact_cursor) {
+            daxa_u32 old_offset = atomicCompSwap(deref(push.allocator).compact_offset, offset, offset + size + ALLOCATOR_BLOCK_OVERHEAD);
+
+            if(old_offset == offset) {
+                return shader_malloc_block(offset + 2, size, owner);
+            }
+
+            offset = old_offset;
+        }
+    }
+
+    //heap_offset only moves past blocks that fit, compaction scans up to it
+    //and trusts every size word below it
+    daxa_u32 result_address = deref(push.allocator).heap_offset;
+
+    while(result_address + size + ALLOCATOR_BLOCK_OVERHEAD <= deref(push.allocator).heap_size) {
+        daxa_u32 old_address = atomicCompSwap(deref(push.allocator).heap_offset, result_address, result_address + size + ALLOCATOR_BLOCK_OVERHEAD);
+
+        if(old_address == result_address) {
+            return shader_malloc_block(result_address + 2, size, owner);
+        }
+
+        result_address = old_address;
+    }
+
+    atomicAdd(deref(push.allocator).stats.failed_count, 1);
+    return 0;
+}
+
+void shader_free(daxa_u32 address) {
+    if(address == 0) {
+        return;
+    }
+
+    daxa_u32 block_size = atomicOr(deref(deref(push.allocator).heap[address - 2]), ALLOCATOR_FREE_BIT);
+
+    if((block_size & ALLOCATOR_FREE_BIT) != 0) {
+        return;
+    }
+
+    atomicAdd(deref(push.allocator).stats.allocated_words, -block_size);
+    atomicAdd(deref(push.allocator).stats.free_count, 1);
+    atomicAdd(deref(push.allocator).stats.free_words, block_size);
+
+    daxa_u32 size = block_size - ALLOCATOR_BLOCK_OVERHEAD;
+    daxa_u32 size_class = size / ALLOCATOR_SIZE_CLASS_GRANULE;
+
+    //blocks past the largest class are never recycled
+    if(size % ALLOCATOR_SIZE_CLASS_GRANULE != 0 || size_class >= ALLOCATOR_SIZE_CLASS_COUNT) {
+        return;
+    }
+
+    //compaction has not reached this block yet, it reclaims it when it does
+    if(deref(push.allocator).compacting != 0 && address >= deref(push.allocator).compact_offset) {
+        return;
+    }
 
-    return result_address + 1;
-}
\ No newline at end of file
+    deref(deref(push.allocator).heap[address]) = atomicExchange(deref(push.allocator).free_heads[size_class], address);
+}
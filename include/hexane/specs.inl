@@ -4,6 +4,7 @@
 #include <hexane/volume.inl>
 
 struct Spec {
+    //view cell of the region, origin is its world position
     daxa_u32 region_index;
     daxa_u32 chunk_index;
     daxa_i32vec3 origin;
@@ -11,12 +12,16 @@ struct Spec {
 
 struct Specs {
     daxa_BufferPtr(Volume) volume;
+    //regions in the view frustum that are fully compressed once this workspace is
+    daxa_u32 visible_region_count;
     daxa_u32 spec_count;
     Spec spec[WORKSPACE_SIZE];
 };
 
 struct UniSpec {
     daxa_u32 region_index;
+    //a bit per UNIFORMITY_BLOCK_SIZE block of the region to rebuild
+    daxa_u32 block_mask;
 };
 
 struct UniSpecs {
@@ -32,6 +37,6 @@ struct RaytraceSpec {
 struct RaytraceSpecs {
     daxa_BufferPtr(Volume) volume;
     daxa_u32 spec_count;
-    RaytraceSpec spec[VOLUME_MAX];
+    RaytraceSpec spec[VIEW_SIZE];
 };
 
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <hexane/constants.inl>
+#include <hexane/terrain.inl>
+
+// Host version of world_gen_base() in terrain.inl, so worlds can be generated
+// offline or on servers without a device. The scalar path is the shared code
+// itself, the AVX2 path does the same float operations in the same order for
+// AXIS_CHUNK_SIZE voxels at once, so both write the densities the shaders do.
+
+// True when this build and the CPU it runs on can take the AVX2 path.
+bool terrain_avx2_supported();
+
+// world_gen_density() of the AXIS_CHUNK_SIZE voxels from position along x.
+// avx2 falls back to the scalar path without terrain_avx2_supported().
+void world_gen_density_row(daxa_i32vec3 position, daxa_f32 *density,
+                           bool avx2);
+
+// world_gen_base() of the CHUNK_SIZE voxels of the chunk whose lowest voxel is
+// at origin, in three_d_to_one_d() order like the workspace.
+void world_gen_base_chunk(daxa_i32vec3 origin, daxa_u32 *voxels, bool avx2);
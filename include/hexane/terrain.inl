@@ -0,0 +1,39 @@
+#pragma once
+
+#include <hexane/util.inl>
+#include <hexane/blocks.inl>
+
+//the brush, shared by base_terrain.glsl, COMPRESSOR_FUSED and the host
+//generator in terrain.hpp so all of them generate the same world
+
+INLINE daxa_f32 world_gen_density(daxa_i32vec3 position) {
+    Fbm f;
+    f.position.x = daxa_f32(position.x);
+    f.position.y = daxa_f32(position.y);
+    f.position.z = daxa_f32(position.z);
+    f.seed = 400;
+    f.octaves = 10;
+    f.lacunarity = daxa_f32(2.0);
+    f.gain = daxa_f32(0.5);
+    f.amplitude = daxa_f32(1.0);
+    f.frequency = daxa_f32(0.05);
+
+    PRECISE daxa_f32 alpha = fbm(f);
+    alpha = alpha > daxa_f32(0.0) ? alpha : daxa_f32(0.0);
+    alpha = alpha < daxa_f32(1.0) ? alpha : daxa_f32(1.0);
+
+    daxa_f32 height_offset = daxa_f32(30.0);
+    daxa_f32 squashing_factor = daxa_f32(0.02);
+
+    PRECISE daxa_f32 density = alpha - (daxa_f32(position.z) - height_offset) * squashing_factor;
+
+    return density;
+}
+
+INLINE daxa_u32 world_gen_base(daxa_i32vec3 position) {
+    if(world_gen_density(position) > daxa_f32(0.0)) {
+        return BLOCK_ID_STONE;
+    }
+
+    return BLOCK_ID_AIR;
+}
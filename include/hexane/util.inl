@@ -4,6 +4,15 @@
 
 #if !defined(DAXA_SHADER)
 #include <bit>
+#include <cmath>
+#endif
+
+//functions shared with host code are included from several translation units
+#undef INLINE
+#if defined(DAXA_SHADER)
+#define INLINE
+#else
+#define INLINE inline
 #endif
 
 #ifdef DAXA_SHADER
@@ -24,11 +33,11 @@ vec4 map(daxa_f32vec4 value, daxa_f32vec4 in_min, daxa_f32vec4 in_max, daxa_f32v
 }
 #endif
 
-daxa_u32 three_d_to_one_d(daxa_u32vec3 p, daxa_u32vec3 max) {
+INLINE daxa_u32 three_d_to_one_d(daxa_u32vec3 p, daxa_u32vec3 max) {
     return (p.z * max.x * max.y) + (p.y * max.x) + p.x;
 }
 
-daxa_u32vec3 one_d_to_three_d(daxa_u32 idx, daxa_u32vec3 max) {
+INLINE daxa_u32vec3 one_d_to_three_d(daxa_u32 idx, daxa_u32vec3 max) {
     daxa_u32 z = idx / (max.x * max.y);
     idx -= (z * max.x * max.y);
     daxa_u32 y = idx / max.x;
@@ -40,7 +49,7 @@ daxa_u32vec3 one_d_to_three_d(daxa_u32 idx, daxa_u32vec3 max) {
     return p; 
 }
 
-daxa_u32 hash(daxa_u32 a) {
+INLINE daxa_u32 hash(daxa_u32 a) {
     daxa_u32 x = a;
 	x += ( x << 10u );
     x ^= ( x >>  6u );
@@ -50,19 +59,19 @@ daxa_u32 hash(daxa_u32 a) {
     return x;
 }
 
-daxa_u32 hash(daxa_u32vec2 v) {
+INLINE daxa_u32 hash(daxa_u32vec2 v) {
     return hash(v.x ^ hash(v.y));
 }
 
-daxa_u32 hash(daxa_u32vec3 v) {
+INLINE daxa_u32 hash(daxa_u32vec3 v) {
     return hash(v.x ^ hash(v.y) ^ hash(v.z));
 }
 
-daxa_u32 hash(daxa_u32vec4 v) {
+INLINE daxa_u32 hash(daxa_u32vec4 v) {
     return hash(v.x ^ hash(v.y) ^ hash(v.z) ^ hash(v.w));
 }
 
-daxa_u32 bitcast(daxa_f32 x) {
+INLINE daxa_u32 bitcast(daxa_f32 x) {
 #ifdef DAXA_SHADER
 	return floatBitsToUint(x);
 #else
@@ -70,7 +79,7 @@ daxa_u32 bitcast(daxa_f32 x) {
 #endif
 }
 
-daxa_f32 bitcast(daxa_u32 x) {
+INLINE daxa_f32 bitcast(daxa_u32 x) {
 #ifdef DAXA_SHADER
 	return uintBitsToFloat(x);
 #else
@@ -78,7 +87,7 @@ daxa_f32 bitcast(daxa_u32 x) {
 #endif
 }
 
-daxa_f32 float_construct(daxa_u32 m) {
+INLINE daxa_f32 float_construct(daxa_u32 m) {
 	daxa_u32 x = m;
 
 	daxa_u32 ieee_mantissa = 0x007FFFFFu;
@@ -92,18 +101,18 @@ daxa_f32 float_construct(daxa_u32 m) {
 	return f - 1.0;
 }
 
-daxa_f32 random(daxa_f32 x) {
+INLINE daxa_f32 random(daxa_f32 x) {
     return float_construct(hash(bitcast(x)));
 }
 
-daxa_f32 random(daxa_f32vec2 v) {
+INLINE daxa_f32 random(daxa_f32vec2 v) {
     daxa_u32vec2 a;
     a.x = bitcast(v.x);
     a.y = bitcast(v.y);
     return float_construct(hash(a));
 }
 
-daxa_f32 random(daxa_f32vec3 v) {
+INLINE daxa_f32 random(daxa_f32vec3 v) {
     daxa_u32vec3 a;
     a.x = bitcast(v.x);
     a.y = bitcast(v.y); 
@@ -111,7 +120,7 @@ daxa_f32 random(daxa_f32vec3 v) {
     return float_construct(hash(a));
 }
 
-daxa_f32 random(daxa_f32vec4 v) {
+INLINE daxa_f32 random(daxa_f32vec4 v) {
     daxa_u32vec4 a;
     a.x = bitcast(v.x);
     a.y = bitcast(v.y);
@@ -120,63 +129,124 @@ daxa_f32 random(daxa_f32vec4 v) {
     return float_construct(hash(a));
 }
 
-//TODO implement perlin noise for non-shader code if need be
-#ifdef DAXA_SHADER
+//the noise below only multiplies, adds and compares so hosts reproduce it
+//bit for bit: precise keeps the shader compiler from fusing into fma, host
+//builds turn contraction off, and sin/cos are polynomials instead of the
+//builtins whose precision is up to the driver
+#if defined(DAXA_SHADER)
+#define PRECISE precise
+#else
+#define PRECISE
+#endif
+
+//taylor series, exact to a float ulp on the [0, 1) range of random()
+INLINE daxa_f32 noise_sin(daxa_f32 x) {
+    PRECISE daxa_f32 x2 = x * x;
+    PRECISE daxa_f32 s = daxa_f32(2.75573188e-06);
+    s = daxa_f32(-0.000198412701) + x2 * s;
+    s = daxa_f32(0.00833333377) + x2 * s;
+    s = daxa_f32(-0.166666672) + x2 * s;
+    s = daxa_f32(1.0) + x2 * s;
+    s = x * s;
+    return s;
+}
 
-daxa_f32vec3 random_gradient(daxa_i32vec3 position, daxa_u32 seed) {
-    daxa_f32 alpha = random(daxa_f32vec4(daxa_f32vec3(position), daxa_f32(seed)));
-	daxa_f32 beta = random(daxa_f32vec4(daxa_f32vec3(position), daxa_f32(seed) + 1.0));
+INLINE daxa_f32 noise_cos(daxa_f32 x) {
+    PRECISE daxa_f32 x2 = x * x;
+    PRECISE daxa_f32 c = daxa_f32(-2.755732e-07);
+    c = daxa_f32(2.48015876e-05) + x2 * c;
+    c = daxa_f32(-0.00138888892) + x2 * c;
+    c = daxa_f32(0.0416666679) + x2 * c;
+    c = daxa_f32(-0.5) + x2 * c;
+    c = daxa_f32(1.0) + x2 * c;
+    return c;
+}
 
-    //normalize not implemented for non shaders
-	return normalize(daxa_f32vec3(
-		cos(alpha) * cos(beta),
-		sin(beta),
-		sin(alpha) * cos(beta)
-	));
+//the glsl definition of mix, spelled out so every compiler rounds the same
+INLINE daxa_f32 noise_mix(daxa_f32 a, daxa_f32 b, daxa_f32 t) {
+    PRECISE daxa_f32 m = a * (daxa_f32(1.0) - t) + b * t;
+    return m;
 }
 
-daxa_f32 dot_grid_gradient(daxa_i32vec3 i, daxa_f32vec3 p, daxa_u32 seed) {
-    return dot(random_gradient(i, seed), p - daxa_f32vec3(i));
+//unit length without normalize, the angles already place it on the sphere
+INLINE daxa_f32vec3 random_gradient(daxa_i32vec3 position, daxa_u32 seed) {
+    daxa_f32vec4 lattice;
+    lattice.x = daxa_f32(position.x);
+    lattice.y = daxa_f32(position.y);
+    lattice.z = daxa_f32(position.z);
+    lattice.w = daxa_f32(seed);
+    daxa_f32 alpha = random(lattice);
+    lattice.w = daxa_f32(seed + 1u);
+    daxa_f32 beta = random(lattice);
+
+    daxa_f32 cos_beta = noise_cos(beta);
+    PRECISE daxa_f32vec3 gradient;
+    gradient.x = noise_cos(alpha) * cos_beta;
+    gradient.y = noise_sin(beta);
+    gradient.z = noise_sin(alpha) * cos_beta;
+    return gradient;
 }
 
-daxa_f32 perlin(daxa_f32vec3 position, daxa_u32 seed) {
-    daxa_i32vec3 m0 = daxa_i32vec3(floor(position));
+INLINE daxa_f32 dot_grid_gradient(daxa_i32vec3 i, daxa_f32vec3 p, daxa_u32 seed) {
+    daxa_f32vec3 gradient = random_gradient(i, seed);
+    PRECISE daxa_f32 d = gradient.x * (p.x - daxa_f32(i.x))
+        + gradient.y * (p.y - daxa_f32(i.y))
+        + gradient.z * (p.z - daxa_f32(i.z));
+    return d;
+}
 
-	daxa_i32vec3 m1 = m0 + 1;
+INLINE daxa_i32vec3 noise_corner(daxa_i32vec3 m0, daxa_i32vec3 m1, daxa_u32 corner) {
+    daxa_i32vec3 m;
+    m.x = (corner & 1u) != 0u ? m1.x : m0.x;
+    m.y = (corner & 2u) != 0u ? m1.y : m0.y;
+    m.z = (corner & 4u) != 0u ? m1.z : m0.z;
+    return m;
+}
 
-	daxa_f32vec3 s = position - daxa_f32vec3(m0);
+INLINE daxa_f32 perlin(daxa_f32vec3 position, daxa_u32 seed) {
+    daxa_i32vec3 m0;
+    m0.x = daxa_i32(floor(position.x));
+    m0.y = daxa_i32(floor(position.y));
+    m0.z = daxa_i32(floor(position.z));
 
-	daxa_f32 n0;
-	daxa_f32 n1;
-	daxa_f32 ix0;
-	daxa_f32 ix1;
-	daxa_f32 jx0;
-	daxa_f32 jx1;
-	daxa_f32 k;
+    daxa_i32vec3 m1;
+    m1.x = m0.x + 1;
+    m1.y = m0.y + 1;
+    m1.z = m0.z + 1;
 
-	n0 = dot_grid_gradient(daxa_i32vec3(m0.x, m0.y, m0.z), position, seed);
-	n1 = dot_grid_gradient(daxa_i32vec3(m1.x, m0.y, m0.z), position, seed);
-	ix0 = mix(n0, n1, s.x);
+    PRECISE daxa_f32vec3 s;
+    s.x = position.x - daxa_f32(m0.x);
+    s.y = position.y - daxa_f32(m0.y);
+    s.z = position.z - daxa_f32(m0.z);
 
-	n0 = dot_grid_gradient(daxa_i32vec3(m0.x, m1.y, m0.z), position, seed);
-	n1 = dot_grid_gradient(daxa_i32vec3(m1.x, m1.y, m0.z), position, seed);
-	ix1 = mix(n0, n1, s.x);
+    daxa_f32 n0;
+    daxa_f32 n1;
+    daxa_f32 ix0;
+    daxa_f32 ix1;
+    daxa_f32 jx0;
+    daxa_f32 jx1;
 
-	jx0 = mix(ix0, ix1, s.y); 
-	
-	n0 = dot_grid_gradient(daxa_i32vec3(m0.x, m0.y, m1.z), position, seed);
-	n1 = dot_grid_gradient(daxa_i32vec3(m1.x, m0.y, m1.z), position, seed);
-	ix0 = mix(n0, n1, s.x);
+    n0 = dot_grid_gradient(noise_corner(m0, m1, 0u), position, seed);
+    n1 = dot_grid_gradient(noise_corner(m0, m1, 1u), position, seed);
+    ix0 = noise_mix(n0, n1, s.x);
 
-	n0 = dot_grid_gradient(daxa_i32vec3(m0.x, m1.y, m1.z), position, seed);
-	n1 = dot_grid_gradient(daxa_i32vec3(m1.x, m1.y, m1.z), position, seed);
-	ix1 = mix(n0, n1, s.x);
+    n0 = dot_grid_gradient(noise_corner(m0, m1, 2u), position, seed);
+    n1 = dot_grid_gradient(noise_corner(m0, m1, 3u), position, seed);
+    ix1 = noise_mix(n0, n1, s.x);
 
-	jx1 = mix(ix0, ix1, s.y); 
+    jx0 = noise_mix(ix0, ix1, s.y);
 
-	k = mix(jx0, jx1, s.z);
+    n0 = dot_grid_gradient(noise_corner(m0, m1, 4u), position, seed);
+    n1 = dot_grid_gradient(noise_corner(m0, m1, 5u), position, seed);
+    ix0 = noise_mix(n0, n1, s.x);
 
-	return k;
+    n0 = dot_grid_gradient(noise_corner(m0, m1, 6u), position, seed);
+    n1 = dot_grid_gradient(noise_corner(m0, m1, 7u), position, seed);
+    ix1 = noise_mix(n0, n1, s.x);
+
+    jx1 = noise_mix(ix0, ix1, s.y);
+
+    return noise_mix(jx0, jx1, s.z);
 }
 
 struct Fbm {
@@ -189,16 +259,18 @@ struct Fbm {
     daxa_f32 frequency;
 };
 
-daxa_f32 fbm(Fbm f) {
-    daxa_f32 height = 0.0;
+INLINE daxa_f32 fbm(Fbm f) {
+    PRECISE daxa_f32 height = daxa_f32(0.0);
 
     for(daxa_u32 i = 0; i < f.octaves; i++) {
-        height += f.amplitude * perlin(f.frequency * f.position, f.seed);
+        PRECISE daxa_f32vec3 position;
+        position.x = f.frequency * f.position.x;
+        position.y = f.frequency * f.position.y;
+        position.z = f.frequency * f.position.z;
+        height += f.amplitude * perlin(position, f.seed);
         f.frequency *= f.lacunarity;
-        f.amplitude *= f.gain;    
+        f.amplitude *= f.gain;
     }
 
     return height;
 }
-
-#endif
\ No newline at end of file
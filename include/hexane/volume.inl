@@ -2,6 +2,7 @@
 
 #include <daxa/daxa.inl>
 #include <hexane/constants.inl>
+#include <hexane/util.inl>
 
 //REGION
 struct Palette {
@@ -12,9 +13,13 @@ struct Chunk {
     daxa_u32 heap_offset;
     daxa_u32 edge_exposed[6];
     daxa_u32 palette_count;
+    //ceil(log2(palette_count)), cached by the allocate pass for query()
+    daxa_u32 index_bits;
     Palette palettes[PALETTES_SIZE];
 };
 
+//A bit per 2^3 ... 32^3 block of a region, set if the whole block holds one
+//block id. Blocks that are all void keep their bit.
 struct RegionUniformity {
     daxa_u32 lod_x2[1024];
     daxa_u32 lod_x4[256];
@@ -23,10 +28,45 @@ struct RegionUniformity {
     daxa_u32 lod_x32[4];
 };
 
+//id of a block whose parts hold different block ids
+#define UNIFORMITY_MIXED 0xFFFFFFFF
+
+//id of a block made of two blocks, the mip step of the uniformity pass
+INLINE daxa_u32 uniformity_merge(daxa_u32 a, daxa_u32 b) {
+    return a == b ? a : UNIFORMITY_MIXED;
+}
+
+//64-tree over the 64^3 voxels of a region: a bit per 16^3 node, per 4^3 brick
+//and per voxel, set if anything below it is neither void nor air. The 64
+//children of a node or brick are two consecutive words of the level below.
+//Node bits are only ever set, so they may stay set over chunks edited empty.
+struct RegionOccupancy {
+    daxa_u32 nodes[2];
+    daxa_u32 bricks[128];
+    daxa_u32 voxels[8192];
+};
+
+//bit of a region local voxel position in the level with cells of size 16, 4 or 1
+INLINE daxa_u32 occupancy_bit(daxa_u32vec3 position, daxa_u32 size) {
+    daxa_u32 bit = 0;
+    for(daxa_u32 level_size = 16; level_size >= size && level_size > 0; level_size /= 4) {
+        bit = bit * 64
+            + ((position.z / level_size) % 4) * 16
+            + ((position.y / level_size) % 4) * 4
+            + (position.x / level_size) % 4;
+    }
+    return bit;
+}
+
 struct Region {
     daxa_f32mat4x4 transform;
+    //world position of the region in its view cell, in regions
+    daxa_u32vec3 position;
     daxa_u32 chunk_count;
+    //set by queue.glsl once the region has been handed to the uniformity pass
+    daxa_u32 uniformity_queued;
     RegionUniformity uniformity;
+    RegionOccupancy occupancy;
     Chunk chunks[REGION_SIZE];
 };
 
@@ -44,10 +84,75 @@ struct VolumeDescriptor {
     daxa_u32vec3 bounds;
 };
 
+struct VolumeHashEntry {
+    daxa_u32vec3 position;
+    //0 marks an empty entry
+    daxa_u32 slot;
+};
+
 struct Volume {
+    //bounds is the size of the view window
     VolumeDescriptor descriptor;
+    //world position of the first region in the window, moved by queue.glsl
+    daxa_u32vec3 window_origin;
     daxa_u32 region_count;
-    daxa_u32 region_indices[VOLUME_MAX];
+    //region slot of every view cell, 0 until the cell has been generated
+    daxa_u32 region_indices[VIEW_SIZE];
+    //linear probing table from world position to slot of the generated
+    //regions, rebuilt by queue.glsl whenever they change
+    VolumeHashEntry region_hash[VOLUME_HASH_SIZE];
 };
 
-DAXA_ENABLE_BUFFER_PTR(Volume)
\ No newline at end of file
+DAXA_ENABLE_BUFFER_PTR(Volume)
+
+INLINE daxa_u32 volume_hash_start(daxa_u32vec3 region_position) {
+    return hash(region_position) & (VOLUME_HASH_SIZE - 1);
+}
+
+#ifdef DAXA_SHADER
+//the table is never more than half full, so every probe sequence ends on an empty entry
+daxa_u32 volume_hash_find(daxa_BufferPtr(Volume) volume, daxa_u32vec3 region_position) {
+    daxa_u32 entry_index = volume_hash_start(region_position);
+
+    for(daxa_u32 probe = 0; probe < VOLUME_HASH_SIZE; probe++) {
+        VolumeHashEntry entry = deref(volume).region_hash[entry_index];
+
+        if(entry.slot == 0 || entry.position == region_position) {
+            return entry.slot;
+        }
+
+        entry_index = (entry_index + 1) & (VOLUME_HASH_SIZE - 1);
+    }
+
+    return 0;
+}
+#endif
+
+//the window is toroidal, a region keeps its cell while the window slides and
+//only the ones crossing its far side are replaced
+INLINE daxa_u32 view_cell_index(daxa_u32vec3 region_position) {
+    daxa_u32vec3 cell;
+    cell.x = region_position.x % AXIS_VIEW_SIZE;
+    cell.y = region_position.y % AXIS_VIEW_SIZE;
+    cell.z = region_position.z % AXIS_VIEW_SIZE;
+    return (cell.z * AXIS_VIEW_SIZE * AXIS_VIEW_SIZE) + (cell.y * AXIS_VIEW_SIZE) + cell.x;
+}
+
+//world position of the region a window places in a cell
+INLINE daxa_u32vec3 view_cell_position(daxa_u32vec3 window_origin, daxa_u32 cell_index) {
+    daxa_u32vec3 cell;
+    cell.x = cell_index % AXIS_VIEW_SIZE;
+    cell.y = (cell_index / AXIS_VIEW_SIZE) % AXIS_VIEW_SIZE;
+    cell.z = cell_index / (AXIS_VIEW_SIZE * AXIS_VIEW_SIZE);
+    daxa_u32vec3 p;
+    p.x = window_origin.x + (cell.x + AXIS_VIEW_SIZE - window_origin.x % AXIS_VIEW_SIZE) % AXIS_VIEW_SIZE;
+    p.y = window_origin.y + (cell.y + AXIS_VIEW_SIZE - window_origin.y % AXIS_VIEW_SIZE) % AXIS_VIEW_SIZE;
+    p.z = window_origin.z + (cell.z + AXIS_VIEW_SIZE - window_origin.z % AXIS_VIEW_SIZE) % AXIS_VIEW_SIZE;
+    return p;
+}
+
+INLINE bool view_contains(daxa_u32vec3 window_origin, daxa_u32vec3 region_position) {
+    return region_position.x >= window_origin.x && region_position.x < window_origin.x + AXIS_VIEW_SIZE
+        && region_position.y >= window_origin.y && region_position.y < window_origin.y + AXIS_VIEW_SIZE
+        && region_position.z >= window_origin.z && region_position.z < window_origin.z + AXIS_VIEW_SIZE;
+}
\ No newline at end of file
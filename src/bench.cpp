@@ -0,0 +1,1680 @@
+#include <hexane/reference.hpp>
+
+#include "generation_budget.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+// CPU micro-benchmarks of the storage format, built on the reference engine
+// so they run on machines without a GPU.
+//
+//   hexane_bench <benchmark> [--regions N] [--lookups N] [--threads N]
+//                [--budget N]
+
+struct BenchOptions {
+  daxa_u32 region_count = 64;
+  daxa_u32 lookup_count = 1 << 24;
+  daxa_u32 thread_count = std::thread::hardware_concurrency();
+  daxa_u32 chunk_budget = CHUNKS_PER_FRAME;
+};
+
+// Layered terrain with a few materials per chunk so that palette indices take
+// 1 to 3 bits and regularly straddle heap words.
+daxa_u32 bench_brush(daxa_i32vec3 position) {
+  daxa_u32vec2 column = {daxa_u32(position.x / 4), daxa_u32(position.y / 4)};
+  daxa_i32 height = 24 + daxa_i32(hash(column) % 16);
+
+  if (position.z > height) {
+    return BLOCK_ID_AIR;
+  }
+  if (position.z > height - 3) {
+    return BLOCK_ID_STONE + 1;
+  }
+
+  daxa_u32vec3 cell = {daxa_u32(position.x / 2), daxa_u32(position.y / 2),
+                       daxa_u32(position.z / 2)};
+  return BLOCK_ID_STONE + 2 + hash(cell) % 4;
+}
+
+double bench_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// View cells of the regions queue() has handed out every chunk of. They
+// complete nearest to the camera first, not in cell order.
+std::vector<daxa_u32> bench_generated_regions(ReferenceEngine const &engine) {
+  std::vector<daxa_u32> generated_regions;
+  for (daxa_u32 cell_index = 0; cell_index < VIEW_SIZE; cell_index++) {
+    daxa_u32 slot = engine.volume->region_indices[cell_index];
+    if (slot != 0 && engine.region_data[slot].chunk_count >= REGION_SIZE) {
+      generated_regions.push_back(cell_index);
+    }
+  }
+  return generated_regions;
+}
+
+struct BenchGeneration {
+  double total_ms = 0;
+  double write_ms = 0;
+  daxa_u32 chunk_count = 0;
+  double uniformity_ms = 0;
+  daxa_u32 uniformity_regions = 0;
+};
+
+// ReferenceEngine::generate() with the write and uniformity passes timed on
+// their own
+BenchGeneration bench_generate(ReferenceEngine &engine,
+                               BenchOptions const &options) {
+  BenchGeneration generation;
+  // volume order fills the terrain layer first, streaming from the origin
+  // would mostly generate air
+  engine.streaming = false;
+  auto start = std::chrono::steady_clock::now();
+  while (!engine.generation_complete() &&
+         bench_generated_regions(engine).size() < options.region_count) {
+    engine.queue();
+    engine.brush(bench_brush);
+    engine.compressor_palettize();
+    engine.compressor_allocate();
+    auto write_start = std::chrono::steady_clock::now();
+    engine.compressor_write();
+    generation.write_ms += bench_ms(write_start);
+    generation.chunk_count += engine.specs->spec_count;
+    auto uniformity_start = std::chrono::steady_clock::now();
+    engine.uniformity();
+    generation.uniformity_ms += bench_ms(uniformity_start);
+    generation.uniformity_regions += engine.unispecs->spec_count;
+  }
+  generation.total_ms = bench_ms(start);
+  std::cout << "generated " << bench_generated_regions(engine).size()
+            << " regions in " << generation.total_ms << " ms, heap "
+            << engine.allocator.heap_offset << " words, write "
+            << generation.chunk_count / std::max(generation.write_ms, 1e-3)
+            << " chunks per ms, uniformity "
+            << generation.uniformity_ms /
+                   std::max(generation.uniformity_regions, daxa_u32(1))
+            << " ms per region" << std::endl;
+  return generation;
+}
+
+void bench_index_widths(ReferenceEngine const &engine) {
+  std::map<daxa_u32, daxa_u32> chunks_per_width;
+  for (daxa_u32 i = 1; i < engine.region_data.size(); i++) {
+    for (auto const &chunk : engine.region_data[i].chunks) {
+      if (chunk.palette_count != 0) {
+        chunks_per_width[chunk.index_bits]++;
+      }
+    }
+  }
+  for (auto [index_bits, count] : chunks_per_width) {
+    std::cout << "  " << count << " chunks with " << index_bits
+              << "-bit indices" << std::endl;
+  }
+}
+
+std::vector<daxa_u32vec3> bench_positions(ReferenceEngine const &engine,
+                                          daxa_u32 count) {
+  auto generated_regions = bench_generated_regions(engine);
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<std::size_t> region(
+      0, generated_regions.size() - 1);
+  std::uniform_int_distribution<daxa_u32> voxel(0, axis_region_size - 1);
+
+  std::vector<daxa_u32vec3> positions(count);
+  for (auto &position : positions) {
+    daxa_u32vec3 origin = view_cell_position(engine.volume->window_origin,
+                                             generated_regions[region(rng)]);
+    position = {origin.x * axis_region_size + voxel(rng),
+                origin.y * axis_region_size + voxel(rng),
+                origin.z * axis_region_size + voxel(rng)};
+  }
+  return positions;
+}
+
+// query() as it was before index_bits was cached: the width goes through
+// ceil(log2()) and the index is gathered one bit per heap load.
+bool query_bit_serial(ReferenceEngine const &engine, daxa_u32vec3 position,
+                      daxa_u32 &information) {
+  daxa_u32 local_index = three_d_to_one_d(
+      {position.x % AXIS_CHUNK_SIZE, position.y % AXIS_CHUNK_SIZE,
+       position.z % AXIS_CHUNK_SIZE},
+      {AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+  daxa_u32 chunk_index = three_d_to_one_d(
+      {(position.x / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE,
+       (position.y / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE,
+       (position.z / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE},
+      {AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+  daxa_u32 axis_region_size = AXIS_CHUNK_SIZE * AXIS_REGION_SIZE;
+  daxa_u32 region_index =
+      engine.volume->region_indices[view_cell_index(
+          {position.x / axis_region_size, position.y / axis_region_size,
+           position.z / axis_region_size})];
+
+  Chunk const &chunk = engine.region_data[region_index].chunks[chunk_index];
+
+  daxa_u32 u32_bits = 32;
+  daxa_u32 index_bits =
+      daxa_u32(std::ceil(std::log2(daxa_f32(chunk.palette_count))));
+
+  daxa_u32 palette_id = 0;
+  for (daxa_u32 bit = 0; bit < index_bits; bit++) {
+    daxa_u32 bit_index =
+        local_index * index_bits + bit + u32_bits * chunk.heap_offset;
+    palette_id |= ((engine.heap_word(bit_index / u32_bits) >>
+                    (bit_index % u32_bits)) &
+                   1u)
+                  << bit;
+  }
+
+  information = chunk.palettes[palette_id].information;
+  return information != 0;
+}
+
+template <typename Lookup>
+double bench_lookups(std::vector<daxa_u32vec3> const &positions,
+                     daxa_u32 &checksum, Lookup lookup) {
+  auto start = std::chrono::steady_clock::now();
+  daxa_u32 sum = 0;
+  for (auto position : positions) {
+    daxa_u32 information;
+    lookup(position, information);
+    sum += information;
+  }
+  auto ns = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+  checksum = sum;
+  return ns / double(positions.size());
+}
+
+int bench_query(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  bench_generate(engine, options);
+
+  bench_index_widths(engine);
+
+  auto positions = bench_positions(engine, options.lookup_count);
+
+  for (auto position : positions) {
+    daxa_u32 expected, actual;
+    query_bit_serial(engine, position, expected);
+    engine.query(position, actual);
+    if (expected != actual) {
+      std::cerr << "decoders disagree at " << position.x << " " << position.y
+                << " " << position.z << std::endl;
+      return -1;
+    }
+  }
+
+  daxa_u32 serial_checksum, word_checksum;
+  double serial_ns =
+      bench_lookups(positions, serial_checksum,
+                    [&](daxa_u32vec3 p, daxa_u32 &information) {
+                      return query_bit_serial(engine, p, information);
+                    });
+  double word_ns = bench_lookups(positions, word_checksum,
+                                 [&](daxa_u32vec3 p, daxa_u32 &information) {
+                                   return engine.query(p, information);
+                                 });
+
+  std::cout << "bit-serial decode  " << serial_ns << " ns/lookup" << std::endl;
+  std::cout << "word-aligned decode " << word_ns << " ns/lookup" << std::endl;
+  std::cout << "speedup " << serial_ns / word_ns << "x (checksum "
+            << serial_checksum << " " << word_checksum << ")" << std::endl;
+  return 0;
+}
+
+// The view window table against the region hash (VOLUME_HASH). Slot lookups
+// cover the whole window, most of which is not generated, queries only hit
+// generated regions.
+int bench_region_lookup(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  bench_generate(engine, options);
+
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<daxa_u32> voxel(
+      0, AXIS_VIEW_SIZE * axis_region_size - 1);
+  std::vector<daxa_u32vec3> window_positions(options.lookup_count);
+  for (auto &position : window_positions) {
+    position = {engine.volume->window_origin.x * axis_region_size + voxel(rng),
+                engine.volume->window_origin.y * axis_region_size + voxel(rng),
+                engine.volume->window_origin.z * axis_region_size + voxel(rng)};
+  }
+  auto positions = bench_positions(engine, options.lookup_count);
+
+  // probes a lookup of every generated region takes
+  daxa_u32 entry_count = 0, probe_count = 0;
+  for (daxa_u32 i = 0; i < VOLUME_HASH_SIZE; i++) {
+    VolumeHashEntry const &entry = engine.volume->region_hash[i];
+    if (entry.slot != 0) {
+      entry_count++;
+      probe_count +=
+          ((i - volume_hash_start(entry.position)) & (VOLUME_HASH_SIZE - 1)) +
+          1;
+    }
+  }
+
+  struct Mode {
+    char const *name;
+    bool region_hash;
+    std::size_t table_bytes;
+    daxa_u32 slot_checksum = 0;
+    daxa_u32 query_checksum = 0;
+    double slot_ns = 0;
+    double query_ns = 0;
+  };
+  Mode modes[] = {{.name = "window",
+                   .region_hash = false,
+                   .table_bytes = sizeof(Volume::region_indices)},
+                  {.name = "hash",
+                   .region_hash = true,
+                   .table_bytes = sizeof(Volume::region_hash)}};
+
+  for (auto &mode : modes) {
+    engine.info.region_hash = mode.region_hash;
+    mode.slot_ns = bench_lookups(
+        window_positions, mode.slot_checksum,
+        [&](daxa_u32vec3 p, daxa_u32 &slot) {
+          slot = engine.region_slot({p.x / axis_region_size,
+                                     p.y / axis_region_size,
+                                     p.z / axis_region_size});
+          return slot != 0;
+        });
+    mode.query_ns = bench_lookups(positions, mode.query_checksum,
+                                  [&](daxa_u32vec3 p, daxa_u32 &information) {
+                                    return engine.query(p, information);
+                                  });
+  }
+
+  if (modes[0].slot_checksum != modes[1].slot_checksum ||
+      modes[0].query_checksum != modes[1].query_checksum) {
+    std::cerr << "window and hash find different regions" << std::endl;
+    return -1;
+  }
+
+  std::cout << entry_count << " regions in " << VOLUME_HASH_SIZE
+            << " entries, " << double(probe_count) / entry_count
+            << " probes per hit" << std::endl;
+  std::cout << "mode    table_bytes  slot_ns  query_ns" << std::endl;
+  for (auto const &mode : modes) {
+    std::cout << mode.name << "  " << mode.table_bytes << "  " << mode.slot_ns
+              << "  " << mode.query_ns << std::endl;
+  }
+  return 0;
+}
+
+// Compresses one chunk with more distinct ids than PALETTES_SIZE. The ids
+// without a palette fall back to the last one, so every voxel has to decode
+// to its own id or to that palette, in either index width.
+bool bench_palette_overflow(ReferenceEngine &engine) {
+  daxa_u32 id_count = PALETTES_SIZE + PALETTES_SIZE / 2;
+  Brush many_ids = [&](daxa_i32vec3 position) -> daxa_u32 {
+    daxa_u32vec3 local = {daxa_u32(position.x) % AXIS_CHUNK_SIZE,
+                          daxa_u32(position.y) % AXIS_CHUNK_SIZE,
+                          daxa_u32(position.z) % AXIS_CHUNK_SIZE};
+    return BLOCK_ID_STONE +
+           three_d_to_one_d(local, {AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE,
+                                    AXIS_CHUNK_SIZE}) %
+               id_count;
+  };
+
+  daxa_u32 region_index = bench_generated_regions(engine)[0];
+  daxa_u32vec3 origin =
+      view_cell_position(engine.volume->window_origin, region_index);
+  engine.specs->spec_count = 1;
+  engine.specs->spec[0] = {
+      .region_index = region_index,
+      .chunk_index = 0,
+      .origin = {daxa_i32(origin.x), daxa_i32(origin.y), daxa_i32(origin.z)},
+  };
+
+  engine.brush(many_ids);
+  engine.compressor_free();
+  engine.compressor_palettize();
+  engine.compressor_allocate();
+  engine.compressor_write();
+
+  Chunk const &chunk =
+      engine.region_data[engine.volume->region_indices[region_index]]
+          .chunks[0];
+  if (chunk.palette_count != PALETTES_SIZE) {
+    std::cerr << "a chunk with " << id_count << " ids got "
+              << chunk.palette_count << " palettes" << std::endl;
+    return false;
+  }
+
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+    daxa_u32vec3 local = one_d_to_three_d(
+        local_index, {AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+    daxa_u32vec3 position = {origin.x * axis_region_size + local.x,
+                             origin.y * axis_region_size + local.y,
+                             origin.z * axis_region_size + local.z};
+    daxa_u32 id = many_ids({daxa_i32(position.x), daxa_i32(position.y),
+                            daxa_i32(position.z)});
+
+    daxa_u32 expected = chunk.palettes[PALETTES_SIZE - 1].information;
+    for (daxa_u32 palette_id = 0; palette_id < PALETTES_SIZE; palette_id++) {
+      if (chunk.palettes[palette_id].information == id) {
+        expected = id;
+      }
+    }
+
+    daxa_u32 information;
+    if (!engine.query(position, information) || information != expected) {
+      std::cerr << "the voxel with id " << id << " past the palettes decodes "
+                << "to " << information << std::endl;
+      return false;
+    }
+  }
+
+  std::cout << "  " << id_count << " ids in one chunk decode with "
+            << chunk.index_bits << "-bit indices" << std::endl;
+  return true;
+}
+
+// Packed ceil(log2()) widths against widths rounded to 1/2/4/8 bits
+// (PALETTE_INDEX_POW2), over the same terrain.
+int bench_index_width(BenchOptions const &options) {
+  struct Mode {
+    char const *name;
+    bool pow2_index_bits;
+    BenchGeneration generation = {};
+    daxa_u32 heap_words = 0;
+    daxa_u32 chunk_count = 0;
+    double query_ns = 0;
+    daxa_u32 checksum = 0;
+  };
+  Mode modes[] = {{.name = "packed", .pow2_index_bits = false},
+                  {.name = "pow2", .pow2_index_bits = true}};
+
+  for (auto &mode : modes) {
+    std::cout << mode.name << ":" << std::endl;
+    ReferenceEngine engine({.thread_count = options.thread_count,
+                            .pow2_index_bits = mode.pow2_index_bits});
+    mode.generation = bench_generate(engine, options);
+    bench_index_widths(engine);
+
+    mode.heap_words = engine.allocator.heap_offset;
+    for (daxa_u32 i = 1; i < engine.region_data.size(); i++) {
+      for (auto const &chunk : engine.region_data[i].chunks) {
+        mode.chunk_count += chunk.palette_count != 0;
+      }
+    }
+
+    auto positions = bench_positions(engine, options.lookup_count);
+    mode.query_ns =
+        bench_lookups(positions, mode.checksum,
+                      [&](daxa_u32vec3 p, daxa_u32 &information) {
+                        return engine.query(p, information);
+                      });
+
+    if (!bench_palette_overflow(engine)) {
+      return -1;
+    }
+  }
+
+  if (modes[0].checksum != modes[1].checksum) {
+    std::cerr << "modes decode different worlds" << std::endl;
+    return -1;
+  }
+
+  // heap bytes include the two word header of every allocation
+  std::cout << "mode    heap_bytes  bytes/chunk  write_ms  query_ns"
+            << std::endl;
+  for (auto const &mode : modes) {
+    daxa_u32 heap_bytes = mode.heap_words * sizeof(daxa_u32);
+    std::cout << mode.name << "  " << heap_bytes << "  "
+              << double(heap_bytes) / double(mode.chunk_count) << "  "
+              << mode.generation.write_ms << "  " << mode.query_ns
+              << std::endl;
+  }
+  std::cout << "pow2: heap +"
+            << 100.0 * (double(modes[1].heap_words) / modes[0].heap_words - 1)
+            << "%, query " << modes[0].query_ns / modes[1].query_ns
+            << "x, write "
+            << modes[0].generation.write_ms / modes[1].generation.write_ms
+            << "x" << std::endl;
+  return 0;
+}
+
+daxa_f32 bench_fragmentation(Allocator const &allocator) {
+  return daxa_f32(allocator.stats.free_words) /
+         daxa_f32(std::max(allocator.heap_offset, daxa_u32(1)));
+}
+
+// Walks the heap block by block and checks the guards, the owners and the
+// allocator statistics against what is actually there.
+bool bench_check_heap(ReferenceEngine const &engine) {
+  auto const &allocator = engine.allocator;
+  daxa_u32 allocated_words = 0, free_words = 0;
+  for (daxa_u32 address = 0; address < allocator.heap_offset;) {
+    // the hole a compaction cycle leaves behind holds stale words
+    if (allocator.compacting != 0 && address == allocator.compact_offset &&
+        address != allocator.compact_cursor) {
+      address = allocator.compact_cursor;
+      continue;
+    }
+
+    daxa_u32 block_size = engine.heap[address] & ~ALLOCATOR_FREE_BIT;
+    bool free = (engine.heap[address] & ALLOCATOR_FREE_BIT) != 0;
+    if (block_size < ALLOCATOR_BLOCK_OVERHEAD) {
+      std::cerr << "bad block size at " << address << std::endl;
+      return false;
+    }
+    // a free block of size 0 keeps its list link in the guard word
+    if (!(free && block_size == ALLOCATOR_BLOCK_OVERHEAD) &&
+        engine.heap[address + block_size - 1] != ALLOCATOR_GUARD) {
+      std::cerr << "guard overwritten at " << address << std::endl;
+      return false;
+    }
+    if (!free) {
+      daxa_u32 owner = engine.heap[address + 1];
+      if (engine.region_data[owner / REGION_SIZE]
+              .chunks[owner % REGION_SIZE]
+              .heap_offset != address + 2) {
+        std::cerr << "block at " << address << " is not owned by chunk "
+                  << owner << std::endl;
+        return false;
+      }
+    }
+    (free ? free_words : allocated_words) += block_size;
+    address += block_size;
+  }
+
+  if (allocated_words != allocator.stats.allocated_words ||
+      free_words != allocator.stats.free_words) {
+    std::cerr << "allocator stats drifted: " << allocated_words << "/"
+              << allocator.stats.allocated_words << " allocated, "
+              << free_words << "/" << allocator.stats.free_words << " free"
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Compresses CHUNKS_PER_FRAME distinct random chunks of the generated world
+// again, the way edits will. compact runs a compaction slice afterwards, as a frame does.
+void bench_recompress(ReferenceEngine &engine, std::mt19937 &rng,
+                      Brush const &brush, bool compact) {
+  auto generated_regions = bench_generated_regions(engine);
+
+  std::uniform_int_distribution<std::size_t> region(
+      0, generated_regions.size() - 1);
+  std::uniform_int_distribution<daxa_u32> chunk(0, REGION_SIZE - 1);
+
+  // queue() never schedules a chunk twice per workspace, neither does this
+  std::set<std::pair<daxa_u32, daxa_u32>> queued;
+
+  engine.specs->spec_count = 0;
+  while (engine.specs->spec_count < CHUNKS_PER_FRAME) {
+    daxa_u32 region_index = generated_regions[region(rng)];
+    daxa_u32 chunk_index = chunk(rng);
+    if (!queued.emplace(region_index, chunk_index).second) {
+      continue;
+    }
+
+    daxa_u32vec3 origin =
+        view_cell_position(engine.volume->window_origin, region_index);
+    engine.specs->spec[engine.specs->spec_count++] = {
+        .region_index = region_index,
+        .chunk_index = chunk_index,
+        .origin = {daxa_i32(origin.x), daxa_i32(origin.y),
+                   daxa_i32(origin.z)},
+    };
+  }
+
+  engine.brush(brush);
+  engine.compressor_free();
+  engine.compressor_palettize();
+  engine.compressor_allocate();
+  engine.compressor_write();
+  if (compact) {
+    engine.compact_slice();
+  }
+}
+
+// Recompresses random chunks with alternating brushes and tracks whether the
+// heap stays bounded.
+int bench_heap(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  bench_generate(engine, options);
+
+  // same terrain shifted in z, so palettes and blob sizes change
+  Brush brushes[] = {
+      bench_brush,
+      [](daxa_i32vec3 position) {
+        return bench_brush({position.x, position.y, position.z + 5});
+      },
+  };
+
+  std::mt19937 rng(1234);
+  daxa_u32 bump_words = engine.allocator.heap_offset;
+
+  std::cout << "round  heap_offset  allocated  free  fragmentation  reused  "
+               "compactions"
+            << std::endl;
+  for (daxa_u32 round = 0; round < 64; round++) {
+    bench_recompress(engine, rng, brushes[round % 2], true);
+
+    // what the bump allocator would have grown by
+    for (daxa_u32 i = 0; i < engine.specs->spec_count; i++) {
+      Spec spec = engine.specs->spec[i];
+      Chunk const &chunk =
+          engine.region_data[engine.volume->region_indices[spec.region_index]]
+              .chunks[spec.chunk_index];
+      bump_words += CHUNK_SIZE * chunk.index_bits / 32 + ALLOCATOR_BLOCK_OVERHEAD;
+    }
+
+    if (!bench_check_heap(engine)) {
+      return -1;
+    }
+
+    auto const &stats = engine.allocator.stats;
+    if (round % 8 == 7) {
+      std::cout << round + 1 << "  " << engine.allocator.heap_offset << "  "
+                << stats.allocated_words << "  " << stats.free_words << "  "
+                << bench_fragmentation(engine.allocator)
+                << "  " << stats.reuse_count << "/" << stats.allocation_count
+                << "  " << stats.compact_cycles << std::endl;
+    }
+  }
+
+  // the last round's chunks decode to what the brush wrote
+  for (daxa_u32 i = 0; i < engine.specs->spec_count; i++) {
+    Spec spec = engine.specs->spec[i];
+    daxa_u32vec3 chunk_position =
+        one_d_to_three_d(spec.chunk_index, {AXIS_REGION_SIZE, AXIS_REGION_SIZE,
+                                            AXIS_REGION_SIZE});
+    for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+      daxa_u32vec3 local = one_d_to_three_d(
+          local_index, {AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+      daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+      daxa_u32vec3 position = {
+          spec.origin.x * axis_region_size +
+              chunk_position.x * AXIS_CHUNK_SIZE + local.x,
+          spec.origin.y * axis_region_size +
+              chunk_position.y * AXIS_CHUNK_SIZE + local.y,
+          spec.origin.z * axis_region_size +
+              chunk_position.z * AXIS_CHUNK_SIZE + local.z};
+
+      daxa_u32 information;
+      engine.query(position, information);
+      daxa_u32 expected = brushes[1]({daxa_i32(position.x),
+                                      daxa_i32(position.y),
+                                      daxa_i32(position.z)});
+      if (information != expected) {
+        std::cerr << "recompressed chunk decodes wrong at " << position.x
+                  << " " << position.y << " " << position.z << std::endl;
+        return -1;
+      }
+    }
+  }
+
+  std::cout << "heap " << engine.allocator.heap_offset
+            << " words, a bump allocator would be at " << bump_words
+            << std::endl;
+  return 0;
+}
+
+// Fragments the heap by recompressing chunks at narrower index widths, then
+// compacts it slice by slice. Every slice has to leave query() results
+// identical to the ones taken before compaction started.
+int bench_compact(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  bench_generate(engine, options);
+
+  // one or two materials per chunk, so most blobs shrink to 1 bit indices
+  Brush bench_brush_function = bench_brush;
+  Brush flat_brush = [](daxa_i32vec3 position) -> daxa_u32 {
+    return position.z > 28 ? BLOCK_ID_AIR : BLOCK_ID_STONE;
+  };
+
+  // brush that last wrote each chunk, by allocator owner
+  std::vector<Brush const *> chunk_brush(
+      engine.region_data.size() * REGION_SIZE, &bench_brush_function);
+  std::mt19937 rng(1234);
+  auto recompress_engine = [&](ReferenceEngine &target,
+                               std::vector<Brush const *> &brushes,
+                               Brush const &brush, bool compact) {
+    bench_recompress(target, rng, brush, compact);
+    for (daxa_u32 i = 0; i < target.specs->spec_count; i++) {
+      Spec spec = target.specs->spec[i];
+      brushes[ALLOCATOR_OWNER(
+          target.volume->region_indices[spec.region_index],
+          spec.chunk_index)] = &brush;
+    }
+  };
+  auto recompress = [&](Brush const &brush, bool compact) {
+    recompress_engine(engine, chunk_brush, brush, compact);
+  };
+
+  // until compact_slice() starts a cycle, flat chunks that were already
+  // flat free nothing, so a fixed round count may stay below the trigger
+  for (daxa_u32 round = 0; engine.allocator.stats.free_words *
+                               COMPACT_FREE_RATIO <=
+                           engine.allocator.heap_offset;
+       round++) {
+    if (round == 64) {
+      std::cerr << "recompressing never freed 1/" << COMPACT_FREE_RATIO
+                << " of the heap" << std::endl;
+      return -1;
+    }
+    recompress(flat_brush, false);
+  }
+  if (!bench_check_heap(engine)) {
+    return -1;
+  }
+
+  daxa_u32 heap_offset = engine.allocator.heap_offset;
+  std::cout << "fragmented heap " << heap_offset << " words, "
+            << engine.allocator.stats.free_words << " free ("
+            << 100.0f * bench_fragmentation(engine.allocator)
+            << "%)" << std::endl;
+
+  auto positions = bench_positions(
+      engine, std::min<daxa_u32>(options.lookup_count, 1 << 20));
+  std::vector<daxa_u32> expected(positions.size());
+  for (daxa_u32 i = 0; i < positions.size(); i++) {
+    engine.query(positions[i], expected[i]);
+  }
+
+  daxa_u32 slice_count = 0;
+  double max_slice_ms = 0;
+  daxa_u32 max_slice_words = 0;
+  do {
+    daxa_u32 compacted_words = engine.allocator.stats.compacted_words;
+    auto start = std::chrono::steady_clock::now();
+    engine.compact_slice();
+    max_slice_ms = std::max(max_slice_ms, bench_ms(start));
+    max_slice_words = std::max(
+        max_slice_words, engine.allocator.stats.compacted_words - compacted_words);
+    slice_count++;
+
+    if (!bench_check_heap(engine)) {
+      return -1;
+    }
+    for (daxa_u32 i = 0; i < positions.size(); i++) {
+      daxa_u32 information;
+      engine.query(positions[i], information);
+      if (information != expected[i]) {
+        std::cerr << "slice " << slice_count << " changed the voxel at "
+                  << positions[i].x << " " << positions[i].y << " "
+                  << positions[i].z << std::endl;
+        return -1;
+      }
+    }
+  } while (engine.allocator.compacting != 0);
+
+  // a cycle that moves nothing leaves the checks above nothing to catch
+  if (engine.allocator.stats.compacted_words == 0 || slice_count < 2) {
+    std::cerr << "compaction moved " << engine.allocator.stats.compacted_words
+              << " words in " << slice_count << " slices" << std::endl;
+    return -1;
+  }
+
+  std::cout << "compacted to " << engine.allocator.heap_offset << " words in "
+            << slice_count << " slices, " << engine.allocator.stats.compacted_words
+            << " words moved, at most " << max_slice_words << " words and "
+            << max_slice_ms << " ms per slice" << std::endl;
+  std::cout << positions.size() << " queries identical after every slice"
+            << std::endl;
+
+  // fragment again and keep recompressing while the next cycle runs, so
+  // frees and allocations land on both sides of the compaction cursor
+  for (daxa_u32 round = 0; round < 8; round++) {
+    recompress(bench_brush_function, false);
+  }
+  for (daxa_u32 round = 0; round < 8; round++) {
+    recompress(flat_brush, false);
+  }
+
+  daxa_u32 cycles = engine.allocator.stats.compact_cycles;
+  for (daxa_u32 round = 0;
+       engine.allocator.compacting != 0 ||
+       engine.allocator.stats.compact_cycles == cycles;
+       round++) {
+    recompress(round % 2 == 0 ? bench_brush_function : flat_brush, true);
+    if (!bench_check_heap(engine)) {
+      return -1;
+    }
+  }
+
+  // chunks whose blob failed to allocate decode as their first palette
+  // entry, they only have to stay inside the chunk's palettes
+  auto check_brushes = [&](ReferenceEngine const &target,
+                           std::vector<Brush const *> const &brushes,
+                           char const *when) {
+    daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+    for (auto position : positions) {
+      daxa_u32 region_index = target.volume->region_indices[view_cell_index(
+          {position.x / axis_region_size, position.y / axis_region_size,
+           position.z / axis_region_size})];
+      daxa_u32 chunk_index = three_d_to_one_d(
+          {(position.x / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE,
+           (position.y / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE,
+           (position.z / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE},
+          {AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+      Chunk const &chunk = target.region_data[region_index].chunks[chunk_index];
+
+      daxa_u32 information;
+      bool found = target.query(position, information);
+
+      // chunks generation never reached
+      if (chunk.palette_count == 0) {
+        continue;
+      }
+
+      daxa_u32 expected = (*brushes[ALLOCATOR_OWNER(
+          region_index, chunk_index)])({daxa_i32(position.x),
+                                        daxa_i32(position.y),
+                                        daxa_i32(position.z)});
+      bool failed = chunk.heap_offset == 0 && chunk.palette_count > 1;
+      if (!found || (!failed && information != expected)) {
+        std::cerr << "voxel at " << position.x << " " << position.y << " "
+                  << position.z << " is wrong " << when << std::endl;
+        return false;
+      }
+    }
+    return true;
+  };
+
+  if (!check_brushes(engine, chunk_brush, "after compacting under edits")) {
+    return -1;
+  }
+
+  std::cout << "compaction under edits ended at "
+            << engine.allocator.heap_offset << " words, "
+            << engine.allocator.stats.free_words << " free" << std::endl;
+
+  // the same world in half the heap it needs: failed allocations must leave
+  // heap_offset on a block boundary inside the heap, so compaction keeps
+  // finding blocks where it scans
+  ReferenceEngine full({.thread_count = options.thread_count,
+                        .heap_capacity = heap_offset / 2});
+  bench_generate(full, options);
+  std::vector<Brush const *> full_brush(
+      full.region_data.size() * REGION_SIZE, &bench_brush_function);
+
+  cycles = full.allocator.stats.compact_cycles;
+  for (daxa_u32 round = 0;
+       full.allocator.compacting != 0 ||
+       full.allocator.stats.compact_cycles == cycles;
+       round++) {
+    if (round == 1024) {
+      std::cerr << "no compaction cycle completed on the full heap, "
+                << full.allocator.stats.free_words << " of "
+                << full.allocator.heap_offset << " words free" << std::endl;
+      return -1;
+    }
+    // narrower blobs free more than they take, until a cycle starts
+    recompress_engine(full, full_brush, flat_brush, true);
+    if (full.allocator.heap_offset > full.allocator.heap_size ||
+        !bench_check_heap(full)) {
+      std::cerr << "the heap broke after running out of space" << std::endl;
+      return -1;
+    }
+  }
+
+  if (full.allocator.stats.failed_count == 0) {
+    std::cerr << "the heap never ran out of space" << std::endl;
+    return -1;
+  }
+  if (!check_brushes(full, full_brush, "after running out of space")) {
+    return -1;
+  }
+
+  std::cout << "out of space: " << full.allocator.stats.failed_count
+            << " failed allocations, compacted to "
+            << full.allocator.heap_offset << "/" << full.allocator.heap_size
+            << " words" << std::endl;
+  return 0;
+}
+
+struct BenchStream {
+  daxa_u32 frame_count = 0;
+  daxa_u32 mixed_frame_count = 0;
+  // frames until a region in the frustum, and the camera's own region, are
+  // fully generated
+  daxa_u32 first_visible_frame = 0;
+  daxa_u32 camera_region_frame = 0;
+  double total_ms = 0;
+  double first_visible_ms = 0;
+};
+
+// Generates the whole view window from a camera standing in the terrain layer
+// and looking along +x through a 90 degree frustum. Checks that queue() hands
+// out every chunk and every uniformity pass exactly once, in priority order.
+bool bench_stream(BenchOptions const &options, bool streaming,
+                  BenchStream &stream) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  daxa_f32vec3 camera = {1.5f, daxa_f32(AXIS_VIEW_SIZE) / 2 + 0.5f, 0.5f};
+
+  engine.streaming = streaming;
+  engine.chunk_budget = options.chunk_budget;
+  engine.camera_position = camera;
+  engine.frustum_planes[0] = {1, -1, 0, camera.y - camera.x};
+  engine.frustum_planes[1] = {1, 1, 0, -camera.x - camera.y};
+  engine.frustum_planes[2] = {1, 0, -1, camera.z - camera.x};
+  engine.frustum_planes[3] = {1, 0, 1, -camera.x - camera.z};
+  engine.frustum_planes[4] = {1, 0, 0, -camera.x - 0.1f};
+
+  daxa_u32 camera_region = view_cell_index(
+      {daxa_u32(camera.x), daxa_u32(camera.y), daxa_u32(camera.z)});
+
+  std::vector<daxa_u32> queued_chunks(VIEW_SIZE * REGION_SIZE);
+  std::vector<daxa_u32> uniformity_passes(VIEW_SIZE);
+  daxa_u32 last_priority = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  while (!engine.generation_complete()) {
+    engine.generate(bench_brush);
+    stream.frame_count++;
+
+    std::set<daxa_u32> frame_regions;
+    for (daxa_u32 i = 0; i < engine.specs->spec_count; i++) {
+      Spec spec = engine.specs->spec[i];
+      queued_chunks[spec.region_index * REGION_SIZE + spec.chunk_index]++;
+      frame_regions.insert(spec.region_index);
+
+      daxa_u32 priority = engine.queue_priority(
+          view_cell_position(engine.volume->window_origin, spec.region_index));
+      if (priority < last_priority) {
+        std::cerr << "region " << spec.region_index
+                  << " was queued after a region of lower priority"
+                  << std::endl;
+        return false;
+      }
+      last_priority = priority;
+    }
+    stream.mixed_frame_count += frame_regions.size() > 1;
+
+    for (daxa_u32 i = 0; i < engine.unispecs->spec_count; i++) {
+      uniformity_passes[engine.unispecs->spec[i].region_index]++;
+    }
+
+    if (stream.first_visible_frame == 0 &&
+        engine.specs->visible_region_count != 0) {
+      stream.first_visible_frame = stream.frame_count;
+      stream.first_visible_ms = bench_ms(start);
+    }
+    daxa_u32 slot = engine.volume->region_indices[camera_region];
+    if (stream.camera_region_frame == 0 && slot != 0 &&
+        engine.region(slot).chunk_count >= REGION_SIZE) {
+      stream.camera_region_frame = stream.frame_count;
+    }
+  }
+  stream.total_ms = bench_ms(start);
+
+  for (daxa_u32 i = 0; i < queued_chunks.size(); i++) {
+    if (queued_chunks[i] != 1) {
+      std::cerr << "chunk " << i % REGION_SIZE << " of region "
+                << i / REGION_SIZE << " was queued " << queued_chunks[i]
+                << " times" << std::endl;
+      return false;
+    }
+  }
+  for (daxa_u32 i = 0; i < VIEW_SIZE; i++) {
+    if (uniformity_passes[i] != 1) {
+      std::cerr << "region " << i << " got " << uniformity_passes[i]
+                << " uniformity passes" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Volume order against streaming order for the same camera and budget.
+int bench_queue(BenchOptions const &options) {
+  std::cout << "mode  frames  mixed_frames  first_visible_frame  "
+               "first_visible_ms  camera_region_frame  total_ms"
+            << std::endl;
+  for (bool streaming : {false, true}) {
+    BenchStream stream;
+    if (!bench_stream(options, streaming, stream)) {
+      return -1;
+    }
+    std::cout << (streaming ? "streaming" : "volume") << "  "
+              << stream.frame_count << "  " << stream.mixed_frame_count
+              << "  " << stream.first_visible_frame << "  "
+              << stream.first_visible_ms << "  " << stream.camera_region_frame
+              << "  " << stream.total_ms << std::endl;
+  }
+  return 0;
+}
+
+struct BenchBudget {
+  daxa_u32 frame_count = 0;
+  double generation_ms = 0;
+  daxa_u32 budget_max = 0;
+};
+
+// Builds the whole view window with the chunk budget GenerationBudget hands
+// out, fed with the CPU time of the brush and compressor passes in place of
+// the GPU timestamps main.cpp reads.
+bool bench_budget_build(BenchOptions const &options,
+                        GenerationBudgetInfo const &info, BenchBudget &build) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  GenerationBudget budget(info);
+  engine.streaming = false;
+
+  while (!engine.generation_complete()) {
+    engine.chunk_budget = budget.chunk_budget;
+    engine.queue();
+    if (engine.specs->spec_count > info.maximum_budget) {
+      std::cerr << "queued " << engine.specs->spec_count
+                << " chunks into a workspace of " << info.maximum_budget
+                << std::endl;
+      return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    engine.brush(bench_brush);
+    engine.compressor_free();
+    engine.compressor_palettize();
+    engine.compressor_allocate();
+    engine.compressor_write();
+    daxa_f32 frame_ms = daxa_f32(bench_ms(start));
+    engine.compact_slice();
+    engine.uniformity();
+
+    if (engine.specs->spec_count != 0) {
+      build.frame_count++;
+      build.generation_ms += frame_ms;
+      build.budget_max = std::max(build.budget_max, budget.chunk_budget);
+    }
+    budget.record(frame_ms, engine.specs->spec_count);
+  }
+  return bench_check_heap(engine);
+}
+
+// The fixed --budget against the adaptive budget aiming for four times the
+// generation time of a fixed frame.
+int bench_budget(BenchOptions const &options) {
+  daxa_u32 workspace_size = workspace_capacity(options.chunk_budget);
+  BenchBudget fixed;
+  if (!bench_budget_build(options,
+                          {.initial_budget = options.chunk_budget,
+                           .maximum_budget = workspace_size},
+                          fixed)) {
+    return -1;
+  }
+
+  daxa_f32 target_ms = 4 * daxa_f32(fixed.generation_ms / fixed.frame_count);
+  BenchBudget adaptive;
+  if (!bench_budget_build(options,
+                          {.target_ms = target_ms,
+                           .initial_budget = options.chunk_budget,
+                           .maximum_budget = WORKSPACE_SIZE},
+                          adaptive)) {
+    return -1;
+  }
+
+  std::cout << "mode  frames  ms_per_frame  max_budget" << std::endl;
+  for (auto [name, build] : {std::pair{"fixed", fixed},
+                             std::pair{"adaptive", adaptive}}) {
+    std::cout << name << "  " << build.frame_count << "  "
+              << build.generation_ms / build.frame_count << "  "
+              << build.budget_max << std::endl;
+  }
+  std::cout << "target " << target_ms << " ms" << std::endl;
+  return 0;
+}
+
+// Carves and fills random spheres, boxes and voxels in the generated world,
+// EDITS_PER_FRAME per frame. Every chunk an edit touched has to decode to the
+// brush with all edits so far applied in order, and its lod_x2 bits have to
+// match what it decodes to.
+int bench_edit(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  bench_generate(engine, options);
+
+  auto generated_regions = bench_generated_regions(engine);
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<std::size_t> region(
+      0, generated_regions.size() - 1);
+  std::uniform_int_distribution<daxa_u32> voxel(0, axis_region_size - 1);
+  std::uniform_int_distribution<daxa_u32> shape(0, 2);
+  std::uniform_int_distribution<daxa_u32> extent(1, 6);
+
+  std::vector<Edit> history;
+  double edit_ms = 0;
+  daxa_u32 chunk_count = 0;
+  daxa_u32 frame_count = 4;
+
+  for (daxa_u32 frame = 0; frame < frame_count; frame++) {
+    Edits edits = {};
+    daxa_u32 workspace_count = 0;
+    while (edits.edit_count < EDITS_PER_FRAME) {
+      daxa_u32vec3 origin = view_cell_position(engine.volume->window_origin,
+                                               generated_regions[region(rng)]);
+      Edit edit = {
+          .shape = EDIT_SHAPE_BOX,
+          .block_id = daxa_u32(edits.edit_count % 2 == 0 ? BLOCK_ID_AIR
+                                                         : BLOCK_ID_STONE + 1),
+          .center = {daxa_i32(origin.x * axis_region_size + voxel(rng)),
+                     daxa_i32(origin.y * axis_region_size + voxel(rng)),
+                     daxa_i32(origin.z * axis_region_size + voxel(rng))},
+          .extent = {},
+      };
+      switch (shape(rng)) {
+      case 0:
+        edit.shape = EDIT_SHAPE_SPHERE;
+        edit.extent.x = edit.extent.y = edit.extent.z = extent(rng);
+        break;
+      case 1:
+        edit.extent = {extent(rng), extent(rng), extent(rng)};
+        break;
+      default:
+        break;
+      }
+
+      // the same limit EditQueue keeps
+      if (workspace_count + edit_chunk_count(edit) > EDIT_CHUNKS_PER_FRAME) {
+        break;
+      }
+      workspace_count += edit_chunk_count(edit);
+      edits.edit[edits.edit_count++] = edit;
+      history.push_back(edit);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    engine.edit(edits);
+    edit_ms += bench_ms(start);
+    chunk_count += engine.edit_specs->spec_count;
+
+    for (daxa_u32 i = 0; i < engine.edit_specs->spec_count; i++) {
+      Spec spec = engine.edit_specs->spec[i];
+      Region const &target =
+          engine.region_data[engine.volume->region_indices[spec.region_index]];
+      daxa_u32vec3 chunk_position =
+          one_d_to_three_d(spec.chunk_index, {AXIS_REGION_SIZE,
+                                              AXIS_REGION_SIZE,
+                                              AXIS_REGION_SIZE});
+      daxa_u32vec3 chunk_origin = {
+          spec.origin.x * axis_region_size + chunk_position.x * AXIS_CHUNK_SIZE,
+          spec.origin.y * axis_region_size + chunk_position.y * AXIS_CHUNK_SIZE,
+          spec.origin.z * axis_region_size +
+              chunk_position.z * AXIS_CHUNK_SIZE};
+
+      for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+        daxa_u32vec3 local = one_d_to_three_d(
+            local_index, {AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+        daxa_i32vec3 position = {daxa_i32(chunk_origin.x + local.x),
+                                 daxa_i32(chunk_origin.y + local.y),
+                                 daxa_i32(chunk_origin.z + local.z)};
+
+        daxa_u32 expected = bench_brush(position);
+        for (auto const &edit : history) {
+          if (edit_contains(edit, position)) {
+            expected = edit.block_id;
+          }
+        }
+
+        daxa_u32 information;
+        engine.query({daxa_u32(position.x), daxa_u32(position.y),
+                      daxa_u32(position.z)},
+                     information);
+        if (information != expected) {
+          std::cerr << "edited chunk decodes wrong at " << position.x << " "
+                    << position.y << " " << position.z << std::endl;
+          return -1;
+        }
+      }
+
+      if (target.uniformity_queued == 0) {
+        continue;
+      }
+
+      // x2 blocks of the chunk
+      for (daxa_u32 j = 0; j < 64; j++) {
+        daxa_u32vec3 block = one_d_to_three_d(j, {4, 4, 4});
+        block = {chunk_position.x * 4 + block.x,
+                 chunk_position.y * 4 + block.y,
+                 chunk_position.z * 4 + block.z};
+
+        bool uniform = true;
+        daxa_u32 first = 0;
+        for (daxa_u32 k = 0; k < 8; k++) {
+          daxa_u32vec3 offset = one_d_to_three_d(k, {2, 2, 2});
+          daxa_u32 information;
+          engine.query({spec.origin.x * axis_region_size + block.x * 2 +
+                            offset.x,
+                        spec.origin.y * axis_region_size + block.y * 2 +
+                            offset.y,
+                        spec.origin.z * axis_region_size + block.z * 2 +
+                            offset.z},
+                       information);
+          first = k == 0 ? information : first;
+          uniform = uniform && information == first;
+        }
+
+        daxa_u32 bit = three_d_to_one_d(
+            block, {axis_region_size / 2, axis_region_size / 2,
+                    axis_region_size / 2});
+        if (((target.uniformity.lod_x2[bit / 32] >> (bit % 32)) & 1) !=
+            daxa_u32(uniform)) {
+          std::cerr << "stale lod_x2 bit " << bit << " in view cell "
+                    << spec.region_index << std::endl;
+          return -1;
+        }
+      }
+    }
+
+    if (!bench_check_heap(engine)) {
+      return -1;
+    }
+  }
+
+  std::cout << history.size() << " edits over " << frame_count
+            << " frames recompressed " << chunk_count << " chunks, "
+            << edit_ms / frame_count << " ms per frame" << std::endl;
+  return 0;
+}
+
+// The brush and the four compressor passes against the free pass and
+// compressor_fused() over the same queue. The fused path allocates as chunks finish, so the heaps
+// differ and the two worlds are compared through query().
+int bench_fused(BenchOptions const &options) {
+  ReferenceEngine chain({.thread_count = options.thread_count});
+  ReferenceEngine fused({.thread_count = options.thread_count});
+  chain.streaming = false;
+  fused.streaming = false;
+
+  double chain_ms = 0, fused_ms = 0;
+  daxa_u32 chunk_count = 0;
+  while (!chain.generation_complete() &&
+         bench_generated_regions(chain).size() < options.region_count) {
+    chain.queue();
+    fused.queue();
+    if (chain.specs->spec_count != fused.specs->spec_count) {
+      std::cerr << "the queues diverged" << std::endl;
+      return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    chain.brush(bench_brush);
+    chain.compressor_free();
+    chain.compressor_palettize();
+    chain.compressor_allocate();
+    chain.compressor_write();
+    chain_ms += bench_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    fused.compressor_free();
+    fused.compressor_fused(bench_brush);
+    fused_ms += bench_ms(start);
+
+    chunk_count += chain.specs->spec_count;
+    chain.uniformity();
+    fused.uniformity();
+  }
+
+  if (!bench_check_heap(chain) || !bench_check_heap(fused)) {
+    return -1;
+  }
+
+  for (auto position : bench_positions(chain, options.lookup_count)) {
+    daxa_u32 expected, actual;
+    chain.query(position, expected);
+    fused.query(position, actual);
+    if (expected != actual) {
+      std::cerr << "fused generation disagrees at " << position.x << " "
+                << position.y << " " << position.z << std::endl;
+      return -1;
+    }
+  }
+
+  std::cout << "generated " << chunk_count << " chunks, four passes "
+            << chunk_count / std::max(chain_ms, 1e-3)
+            << " chunks per ms, fused "
+            << chunk_count / std::max(fused_ms, 1e-3) << " chunks per ms, heap "
+            << chain.allocator.heap_offset << " and "
+            << fused.allocator.heap_offset << " words" << std::endl;
+  return 0;
+}
+
+// world_gen_base() on the host, the scalar path against the AVX2 one over the
+// same queue. The two have to write the same densities bit for bit, and the
+// compressed world has to decode back to world_gen_base().
+int bench_terrain(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  engine.streaming = false;
+
+  bool avx2 = terrain_avx2_supported();
+  double scalar_ms = 0, avx2_ms = 0;
+  daxa_u32 chunk_count = 0;
+  std::vector<daxa_u32> scalar_workspace;
+  while (!engine.generation_complete() &&
+         bench_generated_regions(engine).size() < options.region_count) {
+    engine.queue();
+    auto voxels_end =
+        engine.workspace.begin() + engine.specs->spec_count * CHUNK_SIZE;
+
+    auto start = std::chrono::steady_clock::now();
+    engine.brush_terrain(false);
+    scalar_ms += bench_ms(start);
+    scalar_workspace.assign(engine.workspace.begin(), voxels_end);
+
+    start = std::chrono::steady_clock::now();
+    engine.brush_terrain(true);
+    avx2_ms += bench_ms(start);
+    if (!std::equal(engine.workspace.begin(), voxels_end,
+                    scalar_workspace.begin())) {
+      std::cerr << "the AVX2 path generated other blocks" << std::endl;
+      return -1;
+    }
+
+    chunk_count += engine.specs->spec_count;
+    engine.compressor_free();
+    engine.compressor_palettize();
+    engine.compressor_allocate();
+    engine.compressor_write();
+    engine.uniformity();
+  }
+
+  if (!bench_check_heap(engine)) {
+    return -1;
+  }
+
+  for (auto position : bench_positions(engine, options.lookup_count)) {
+    daxa_i32vec3 voxel = {daxa_i32(position.x), daxa_i32(position.y),
+                          daxa_i32(position.z)};
+    daxa_u32 actual;
+    engine.query(position, actual);
+    if (actual != world_gen_base(voxel)) {
+      std::cerr << "the generated world disagrees with world_gen_base() at "
+                << position.x << " " << position.y << " " << position.z
+                << std::endl;
+      return -1;
+    }
+  }
+
+  // the block ids only tell which side of zero a density is on
+  auto rows = bench_positions(engine, std::min(options.lookup_count,
+                                               daxa_u32(1) << 16));
+  for (auto position : rows) {
+    daxa_i32vec3 row = {daxa_i32(position.x), daxa_i32(position.y),
+                        daxa_i32(position.z)};
+    daxa_f32 scalar[AXIS_CHUNK_SIZE], vector[AXIS_CHUNK_SIZE];
+    world_gen_density_row(row, scalar, false);
+    world_gen_density_row(row, vector, true);
+    for (daxa_u32 x = 0; x < AXIS_CHUNK_SIZE; x++) {
+      if (bitcast(scalar[x]) != bitcast(vector[x])) {
+        std::cerr << "the AVX2 density differs at " << row.x + x << " "
+                  << row.y << " " << row.z << std::endl;
+        return -1;
+      }
+    }
+  }
+
+  std::cout << "generated " << chunk_count << " chunks, scalar "
+            << chunk_count / std::max(scalar_ms, 1e-3) << " chunks per ms, "
+            << (avx2 ? "AVX2 " : "AVX2 unsupported, scalar again ")
+            << chunk_count / std::max(avx2_ms, 1e-3) << " chunks per ms on "
+            << engine.pool.thread_count() << " threads, " << rows.size()
+            << " density rows identical" << std::endl;
+  return 0;
+}
+
+// Streams region_count regions around a camera, then walks it along +x so the
+// window slides. Checks that evicted regions return their heap and leave the
+// region hash, that the resident ones still decode and that the heap stops
+// growing.
+int bench_window(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  engine.chunk_budget = options.chunk_budget;
+  // a frame fills at most one region at the default budget
+  daxa_u32 frames_per_step = options.region_count;
+  daxa_u32 lookup_count = std::min(options.lookup_count, daxa_u32(1 << 16));
+
+  std::cout << "step  camera_x  window_x  resident_regions  heap_words  "
+               "allocated_words  free_words  step_ms"
+            << std::endl;
+  for (daxa_u32 step = 0; step < 6; step++) {
+    engine.camera_position = {daxa_f32(AXIS_VIEW_SIZE / 2 + 2 * step) + 0.5f,
+                              daxa_f32(AXIS_VIEW_SIZE / 2) + 0.5f, 0.5f};
+
+    auto start = std::chrono::steady_clock::now();
+    for (daxa_u32 frame = 0; frame < frames_per_step; frame++) {
+      engine.generate(bench_brush);
+    }
+    double step_ms = bench_ms(start);
+
+    if (!bench_check_heap(engine)) {
+      return -1;
+    }
+    for (auto position : bench_positions(engine, lookup_count)) {
+      daxa_u32 information;
+      engine.query(position, information);
+      if (information != bench_brush({daxa_i32(position.x),
+                                      daxa_i32(position.y),
+                                      daxa_i32(position.z)})) {
+        std::cerr << "voxel at " << position.x << " " << position.y << " "
+                  << position.z << " is wrong after the window moved"
+                  << std::endl;
+        return -1;
+      }
+    }
+
+    // the region hash has to follow every eviction
+    for (daxa_u32 cell_index = 0; cell_index < VIEW_SIZE; cell_index++) {
+      daxa_u32vec3 region_position =
+          view_cell_position(engine.volume->window_origin, cell_index);
+      daxa_u32 slots[2];
+      for (bool region_hash : {false, true}) {
+        engine.info.region_hash = region_hash;
+        slots[region_hash] = engine.region_slot(region_position);
+      }
+      engine.info.region_hash = false;
+      if (slots[0] != slots[1]) {
+        std::cerr << "region hash holds slot " << slots[1] << " for cell "
+                  << cell_index << " instead of " << slots[0] << std::endl;
+        return -1;
+      }
+    }
+
+    std::cout << step << "  " << engine.camera_position.x << "  "
+              << engine.volume->window_origin.x << "  "
+              << engine.volume->region_count << "  "
+              << engine.allocator.heap_offset << "  "
+              << engine.allocator.stats.allocated_words << "  "
+              << engine.allocator.stats.free_words << "  " << step_ms
+              << std::endl;
+  }
+  return 0;
+}
+
+// Generated terrain with the lods of every region, the camera looks down +x
+// over it from the middle of the -x side of the view window.
+struct BenchView {
+  daxa_f32vec3 origin;
+  std::vector<daxa_f32vec3> directions;
+};
+
+BenchView bench_view(ReferenceEngine &engine, BenchOptions const &options) {
+  bench_generate(engine, options);
+
+  // uniformity lags a frame behind the chunks it covers
+  engine.chunk_budget = 0;
+  for (daxa_u32 frame = 0; frame < 16; frame++) {
+    engine.queue();
+    engine.uniformity();
+  }
+
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  BenchView view;
+  view.origin = {8.5f, daxa_f32(axis_region_size * 4) + 0.5f, 60.5f};
+  daxa_u32 resolution = 256;
+  daxa_f32 pitch = 0.35f;
+
+  for (daxa_u32 y = 0; y < resolution; y++) {
+    for (daxa_u32 x = 0; x < resolution; x++) {
+      // 90 degree field of view
+      daxa_f32 u = (daxa_f32(x) + 0.5f) / daxa_f32(resolution) * 2.0f - 1.0f;
+      daxa_f32 v = (daxa_f32(y) + 0.5f) / daxa_f32(resolution) * 2.0f - 1.0f;
+      view.directions.push_back({std::cos(pitch) - v * std::sin(pitch), u,
+                                 -std::sin(pitch) - v * std::cos(pitch)});
+    }
+  }
+  return view;
+}
+
+// Primary rays over the generated terrain, traversed through the occupancy
+// tree and through the uniformity lods (RAYTRACE_UNIFORMITY). Both have to
+// stop in the same voxel.
+int bench_rays(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  auto [origin, directions] = bench_view(engine, options);
+
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  daxa_i32vec3 minimum = {0, 0, 0};
+  daxa_i32vec3 maximum = {daxa_i32(axis_region_size * AXIS_VIEW_SIZE),
+                          daxa_i32(axis_region_size * AXIS_VIEW_SIZE),
+                          daxa_i32(axis_region_size)};
+
+  std::vector<ReferenceRay> rays[2];
+  std::cout << "traversal  steps/ray  Mrays/s  hits  misses" << std::endl;
+  for (bool uniformity : {false, true}) {
+    rays[uniformity].resize(directions.size());
+    auto start = std::chrono::steady_clock::now();
+    engine.pool.parallel_for(
+        daxa_u32(directions.size()), [&](daxa_u32 i) {
+          rays[uniformity][i] = engine.ray_cast(origin, directions[i], minimum,
+                                                maximum, uniformity);
+        });
+    double ms = bench_ms(start);
+
+    daxa_u64 step_count = 0;
+    daxa_u32 hits = 0;
+    for (auto const &ray : rays[uniformity]) {
+      step_count += ray.step_count;
+      hits += ray.state_id == RAY_STATE_VOXEL_FOUND;
+    }
+    std::cout << (uniformity ? "uniformity" : "occupancy") << "  "
+              << double(step_count) / double(directions.size()) << "  "
+              << double(directions.size()) / ms / 1000.0 << "  " << hits
+              << "  " << directions.size() - hits << std::endl;
+  }
+
+  // misses may fail differently, the lods run into MAX_STEP_COUNT first. A
+  // ray grazing the corner of a voxel may slip past it when a large cell step
+  // ends within the 4e-4 nudge, so a few hits land one voxel apart.
+  daxa_u32 disagreements = 0;
+  for (daxa_u32 i = 0; i < directions.size(); i++) {
+    ReferenceRay const &a = rays[0][i];
+    ReferenceRay const &b = rays[1][i];
+    bool a_hit = a.state_id == RAY_STATE_VOXEL_FOUND;
+    bool b_hit = b.state_id == RAY_STATE_VOXEL_FOUND;
+    if (a_hit != b_hit ||
+        (a_hit && (a.voxel.x != b.voxel.x || a.voxel.y != b.voxel.y ||
+                   a.voxel.z != b.voxel.z))) {
+      disagreements++;
+    }
+  }
+  std::cout << disagreements << " rays hit different voxels" << std::endl;
+  if (disagreements * 1000 > directions.size()) {
+    std::cerr << "traversals disagree on more than 0.1% of rays" << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+// The fullscreen trace of RAYTRACE_TRACE against the region cubes of
+// RAYTRACE_VERT/RAYTRACE_FRAG. Every resident region whose cube covers a
+// pixel shades a fragment with a ray clamped to that region, the trace casts
+// one ray across the whole view window.
+int bench_trace(BenchOptions const &options) {
+  ReferenceEngine engine({.thread_count = options.thread_count});
+  auto [origin, directions] = bench_view(engine, options);
+
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  daxa_u32vec3 window_origin = engine.volume->window_origin;
+  std::vector<daxa_u32> cells;
+  for (daxa_u32 cell_index = 0; cell_index < VIEW_SIZE; cell_index++) {
+    if (engine.volume->region_indices[cell_index] != 0) {
+      cells.push_back(cell_index);
+    }
+  }
+
+  struct Pixel {
+    ReferenceRay ray;
+    daxa_f32 dist = std::numeric_limits<daxa_f32>::max();
+    daxa_u32 fragment_count = 0;
+    daxa_u32 step_count = 0;
+  };
+  std::vector<Pixel> pixels[2];
+
+  std::cout << "path  fragments/pixel  steps/pixel  ms  hits" << std::endl;
+  for (bool trace : {false, true}) {
+    pixels[trace].resize(directions.size());
+    auto start = std::chrono::steady_clock::now();
+    engine.pool.parallel_for(daxa_u32(directions.size()), [&](daxa_u32 i) {
+      Pixel &pixel = pixels[trace][i];
+      daxa_f32vec3 d = directions[i];
+      daxa_f32 length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+      daxa_f32 direction[3] = {d.x / length, d.y / length, d.z / length};
+      daxa_f32 o[3] = {origin.x, origin.y, origin.z};
+
+      if (trace) {
+        daxa_i32vec3 minimum = {
+            daxa_i32(window_origin.x * axis_region_size),
+            daxa_i32(window_origin.y * axis_region_size),
+            daxa_i32(window_origin.z * axis_region_size)};
+        daxa_i32vec3 maximum = {
+            minimum.x + daxa_i32(AXIS_VIEW_SIZE * axis_region_size),
+            minimum.y + daxa_i32(AXIS_VIEW_SIZE * axis_region_size),
+            minimum.z + daxa_i32(AXIS_VIEW_SIZE * axis_region_size)};
+        pixel.ray = engine.ray_cast(origin, d, minimum, maximum, false);
+        pixel.fragment_count = 1;
+        pixel.step_count = pixel.ray.step_count;
+        return;
+      }
+
+      for (daxa_u32 cell_index : cells) {
+        daxa_u32vec3 region_position =
+            view_cell_position(window_origin, cell_index);
+        daxa_i32 minimum[3] = {daxa_i32(region_position.x * axis_region_size),
+                               daxa_i32(region_position.y * axis_region_size),
+                               daxa_i32(region_position.z * axis_region_size)};
+
+        // the cube covers the pixel if the ray crosses it
+        daxa_f32 t_enter = 0;
+        daxa_f32 t_exit = std::numeric_limits<daxa_f32>::max();
+        for (daxa_u32 axis = 0; axis < 3; axis++) {
+          daxa_f32 t0 = (daxa_f32(minimum[axis]) - o[axis]) / direction[axis];
+          daxa_f32 t1 = (daxa_f32(minimum[axis] + daxa_i32(axis_region_size)) -
+                         o[axis]) /
+                        direction[axis];
+          t_enter = std::max(t_enter, std::min(t0, t1));
+          t_exit = std::min(t_exit, std::max(t0, t1));
+        }
+        if (t_enter >= t_exit) {
+          continue;
+        }
+
+        // front faces start on the cube, the back face pass at the camera
+        daxa_f32 t = t_enter > 0 ? t_enter + 1e-3f : 0;
+        ReferenceRay ray = engine.ray_cast(
+            {o[0] + t * direction[0], o[1] + t * direction[1],
+             o[2] + t * direction[2]},
+            d, {minimum[0], minimum[1], minimum[2]},
+            {minimum[0] + daxa_i32(axis_region_size),
+             minimum[1] + daxa_i32(axis_region_size),
+             minimum[2] + daxa_i32(axis_region_size)},
+            false);
+        pixel.fragment_count++;
+        pixel.step_count += ray.step_count;
+
+        // depth testing keeps the nearest hit
+        if (ray.state_id == RAY_STATE_VOXEL_FOUND) {
+          daxa_f32 dx = daxa_f32(ray.voxel.x) + 0.5f - o[0];
+          daxa_f32 dy = daxa_f32(ray.voxel.y) + 0.5f - o[1];
+          daxa_f32 dz = daxa_f32(ray.voxel.z) + 0.5f - o[2];
+          daxa_f32 dist = dx * dx + dy * dy + dz * dz;
+          if (dist < pixel.dist) {
+            pixel.dist = dist;
+            pixel.ray = ray;
+          }
+        }
+      }
+    });
+    double ms = bench_ms(start);
+
+    daxa_u64 fragment_count = 0;
+    daxa_u64 step_count = 0;
+    daxa_u32 hits = 0;
+    for (auto const &pixel : pixels[trace]) {
+      fragment_count += pixel.fragment_count;
+      step_count += pixel.step_count;
+      hits += pixel.ray.state_id == RAY_STATE_VOXEL_FOUND;
+    }
+    std::cout << (trace ? "trace" : "region cubes") << "  "
+              << double(fragment_count) / double(directions.size()) << "  "
+              << double(step_count) / double(directions.size()) << "  " << ms
+              << "  " << hits << std::endl;
+  }
+
+  // rays grazing voxel corners may slip past them, see bench_rays
+  daxa_u32 disagreements = 0;
+  for (daxa_u32 i = 0; i < directions.size(); i++) {
+    ReferenceRay const &a = pixels[0][i].ray;
+    ReferenceRay const &b = pixels[1][i].ray;
+    bool a_hit = a.state_id == RAY_STATE_VOXEL_FOUND;
+    bool b_hit = b.state_id == RAY_STATE_VOXEL_FOUND;
+    if (a_hit != b_hit ||
+        (a_hit && (a.voxel.x != b.voxel.x || a.voxel.y != b.voxel.y ||
+                   a.voxel.z != b.voxel.z))) {
+      disagreements++;
+    }
+  }
+  std::cout << disagreements << " pixels hit different voxels" << std::endl;
+  if (disagreements * 1000 > directions.size()) {
+    std::cerr << "the trace disagrees with the region cubes on more than 0.1% "
+                 "of pixels"
+              << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  std::map<std::string, int (*)(BenchOptions const &)> benchmarks = {
+      {"budget", bench_budget},
+      {"compact", bench_compact},
+      {"edit", bench_edit},
+      {"fused", bench_fused},
+      {"heap", bench_heap},
+      {"index-width", bench_index_width},
+      {"query", bench_query},
+      {"queue", bench_queue},
+      {"rays", bench_rays},
+      {"trace", bench_trace},
+      {"region-lookup", bench_region_lookup},
+      {"terrain", bench_terrain},
+      {"window", bench_window},
+  };
+
+  BenchOptions options;
+  std::string name = argc > 1 ? argv[1] : "";
+  for (int i = 2; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    daxa_u32 value = std::stoul(argv[i + 1]);
+    if (arg == "--regions") {
+      options.region_count = value;
+    } else if (arg == "--lookups") {
+      options.lookup_count = value;
+    } else if (arg == "--threads") {
+      options.thread_count = value;
+    } else if (arg == "--budget") {
+      options.chunk_budget = value;
+    } else {
+      name = "";
+    }
+  }
+
+  if (!benchmarks.contains(name)) {
+    std::cerr << "usage: hexane_bench <";
+    for (auto it = benchmarks.begin(); it != benchmarks.end(); it++) {
+      std::cerr << (it == benchmarks.begin() ? "" : "|") << it->first;
+    }
+    std::cerr << "> [--regions N] [--lookups N] [--threads N] [--budget N]"
+              << std::endl;
+    return -1;
+  }
+
+  return benchmarks[name](options);
+}
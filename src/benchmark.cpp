@@ -0,0 +1,530 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numbers>
+#include <numeric>
+#include <sstream>
+
+static daxa_u64 buffer_creation_count = 0;
+
+daxa::BufferId benchmark_create_buffer(daxa::Device &device,
+                                       daxa::BufferInfo const &info) {
+  buffer_creation_count++;
+  return device.create_buffer(info);
+}
+
+Benchmark::Benchmark(BenchmarkInfo const &info) : info(info) {}
+
+void Benchmark::add_task(daxa::TaskList &task_list,
+                         daxa::TaskInfo const &task_info) {
+  task_infos.push_back(task_info);
+
+  if (!info.enabled) {
+    task_list.add_task(task_info);
+    return;
+  }
+
+  if (task_names.empty()) {
+    task_list.add_task({
+        .task =
+            [this](daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+              daxa_u32 query_count =
+                  2 * static_cast<daxa_u32>(task_names.size());
+              cmd_list.reset_timestamps({
+                  .query_pool = *query_pool,
+                  .start_index = slot * query_count,
+                  .count = query_count,
+              });
+            },
+        .debug_name = "reset timestamps task",
+    });
+  }
+
+  daxa_u32 task_index = static_cast<daxa_u32>(task_names.size());
+  task_names.push_back(task_info.debug_name);
+
+  auto timed_task_info = task_info;
+  timed_task_info.task = [this, task_index, task = task_info.task](
+                             daxa::TaskRuntimeInterface task_runtime) {
+    auto cmd_list = task_runtime.get_command_list();
+    daxa_u32 query_index =
+        2 * (slot * static_cast<daxa_u32>(task_names.size()) + task_index);
+    cmd_list.write_timestamp({
+        .query_pool = *query_pool,
+        .pipeline_stage = daxa::PipelineStageFlagBits::TOP_OF_PIPE,
+        .query_index = query_index,
+    });
+
+    task(task_runtime);
+
+    cmd_list.write_timestamp({
+        .query_pool = *query_pool,
+        .pipeline_stage = daxa::PipelineStageFlagBits::BOTTOM_OF_PIPE,
+        .query_index = query_index + 1,
+    });
+  };
+  task_list.add_task(timed_task_info);
+}
+
+void Benchmark::begin_frame(daxa_u32 slot) {
+  if (!info.enabled) {
+    return;
+  }
+
+  if (!query_pool.has_value()) {
+    query_pool = info.device.create_timeline_query_pool({
+        .query_count =
+            2 * static_cast<daxa_u32>(task_names.size()) * info.slot_count,
+        .debug_name = "benchmark query pool",
+    });
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (!cpu_ms.empty()) {
+    frame_ms.push_back(
+        std::chrono::duration<daxa_f32, std::milli>(now - frame_start)
+            .count());
+  }
+
+  this->slot = slot;
+  frame_start = now;
+  last_buffer_creation_count = buffer_creation_count;
+}
+
+void Benchmark::end_frame_submit() {
+  if (!info.enabled) {
+    return;
+  }
+
+  frame_submit = std::chrono::steady_clock::now();
+  cpu_ms.push_back(
+      std::chrono::duration<daxa_f32, std::milli>(frame_submit - frame_start)
+          .count());
+  buffer_creations.push_back(
+      static_cast<daxa_u32>(buffer_creation_count - last_buffer_creation_count));
+}
+
+void Benchmark::mark_present() {
+  present_task_count = static_cast<daxa_u32>(task_names.size());
+}
+
+void Benchmark::end_frame(daxa_u32 slot) {
+  if (!info.enabled) {
+    return;
+  }
+
+  daxa_u32 query_count = 2 * static_cast<daxa_u32>(task_names.size());
+  // pairs of (timestamp, availability)
+  auto results =
+      query_pool->get_query_results(slot * query_count, query_count);
+  daxa_f32 timestamp_period =
+      info.device.properties().limits.timestamp_period;
+
+  auto &frame_task_ms = task_ms.emplace_back(task_names.size(), 0.0f);
+  for (daxa_u32 i = 0; i < task_names.size(); i++) {
+    daxa::u64 begin = results[4 * i];
+    daxa::u64 begin_available = results[4 * i + 1];
+    daxa::u64 end = results[4 * i + 2];
+    daxa::u64 end_available = results[4 * i + 3];
+
+    if (begin_available == 0 || end_available == 0 || end < begin) {
+      frame_task_ms[i] = NAN;
+      continue;
+    }
+
+    frame_task_ms[i] = daxa_f32(end - begin) * timestamp_period / 1e6f;
+  }
+
+  daxa_f32 frame_present_ms = NAN;
+  if (present_task_count != 0) {
+    daxa::u64 begin = results[0];
+    daxa::u64 end = results[4 * (present_task_count - 1) + 2];
+    if (results[1] != 0 && results[4 * (present_task_count - 1) + 3] != 0 &&
+        end >= begin) {
+      frame_present_ms = daxa_f32(end - begin) * timestamp_period / 1e6f;
+    }
+  }
+  present_ms.push_back(frame_present_ms);
+}
+
+void Benchmark::finish() {
+  if (!info.enabled || frame_ms.size() == cpu_ms.size()) {
+    return;
+  }
+
+  frame_ms.push_back(std::chrono::duration<daxa_f32, std::milli>(
+                         std::chrono::steady_clock::now() - frame_start)
+                         .count());
+}
+
+void Benchmark::record_heap(Allocator const &allocator) {
+  if (!info.enabled) {
+    return;
+  }
+
+  heap_offset.push_back(allocator.heap_offset);
+  heap_stats.push_back(allocator.stats);
+}
+
+void Benchmark::record_specs(daxa_u32 visible_region_count,
+                             daxa_u32 spec_count, daxa_u32 unispec_count) {
+  if (!info.enabled) {
+    return;
+  }
+
+  this->visible_region_count.push_back(visible_region_count);
+  this->spec_count.push_back(spec_count);
+  this->unispec_count.push_back(unispec_count);
+}
+
+void Benchmark::record_budget(daxa_u32 chunk_budget) {
+  if (!info.enabled) {
+    return;
+  }
+
+  this->chunk_budget.push_back(chunk_budget);
+}
+
+void Benchmark::record_edits(
+    std::vector<std::chrono::steady_clock::time_point> const &pushed_at) {
+  if (!info.enabled) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  for (auto time : pushed_at) {
+    edit_latency_ms.push_back(
+        std::chrono::duration<daxa_f32, std::milli>(now - time).count());
+  }
+}
+
+daxa_f32 heap_fragmentation(daxa_u32 heap_offset, AllocatorStats const &stats) {
+  return heap_offset == 0 ? 0.0f
+                          : daxa_f32(stats.free_words) / daxa_f32(heap_offset);
+}
+
+std::string heap_summary(Allocator const &allocator) {
+  std::ostringstream out;
+  out << "heap " << allocator.heap_offset << "/" << allocator.heap_size
+      << " words, " << allocator.stats.allocated_words << " allocated, "
+      << allocator.stats.free_words << " free ("
+      << 100.0f * heap_fragmentation(allocator.heap_offset, allocator.stats)
+      << "%), " << allocator.stats.reuse_count << "/"
+      << allocator.stats.allocation_count << " allocations reused, "
+      << allocator.stats.failed_count << " failed, "
+      << allocator.stats.compact_cycles << " compactions";
+  return out.str();
+}
+
+struct BenchmarkStatistics {
+  daxa_f32 mean = 0, p50 = 0, p95 = 0, max = 0;
+};
+
+static BenchmarkStatistics benchmark_statistics(std::vector<daxa_f32> values) {
+  values.erase(std::remove_if(values.begin(), values.end(),
+                              [](daxa_f32 v) { return std::isnan(v); }),
+               values.end());
+  if (values.empty()) {
+    return {};
+  }
+
+  std::sort(values.begin(), values.end());
+  auto percentile = [&](daxa_f32 p) {
+    return values[std::min(values.size() - 1,
+                           static_cast<size_t>(p * values.size()))];
+  };
+
+  return {
+      .mean = std::accumulate(values.begin(), values.end(), 0.0f) /
+              daxa_f32(values.size()),
+      .p50 = percentile(0.5f),
+      .p95 = percentile(0.95f),
+      .max = values.back(),
+  };
+}
+
+static void write_statistics(std::ostream &out, BenchmarkStatistics s) {
+  out << "{\"mean_ms\": " << s.mean << ", \"p50_ms\": " << s.p50
+      << ", \"p95_ms\": " << s.p95 << ", \"max_ms\": " << s.max << "}";
+}
+
+void Benchmark::write_report() const {
+  if (!info.enabled) {
+    return;
+  }
+
+  {
+    std::ofstream csv(info.output + ".csv");
+    csv << "frame,cpu_ms,frame_ms,present_ms";
+    for (auto const &name : task_names) {
+      csv << ",\"" << name << "\"";
+    }
+    csv << ",heap_offset,allocated_words,free_words,visible_regions,"
+           "spec_count,unispec_count,buffer_creations,chunk_budget\n";
+    for (daxa_u32 frame = 0; frame < cpu_ms.size(); frame++) {
+      csv << frame << "," << cpu_ms[frame] << "," << frame_ms[frame] << ","
+          << present_ms[frame];
+      for (auto ms : task_ms[frame]) {
+        csv << "," << ms;
+      }
+      if (frame < heap_stats.size()) {
+        csv << "," << heap_offset[frame] << ","
+            << heap_stats[frame].allocated_words << ","
+            << heap_stats[frame].free_words;
+      } else {
+        csv << ",,,";
+      }
+      if (frame < visible_region_count.size()) {
+        csv << "," << visible_region_count[frame] << "," << spec_count[frame]
+            << "," << unispec_count[frame];
+      } else {
+        csv << ",,,";
+      }
+      csv << "," << buffer_creations[frame];
+      if (frame < chunk_budget.size()) {
+        csv << "," << chunk_budget[frame];
+      } else {
+        csv << ",";
+      }
+      csv << "\n";
+    }
+  }
+
+  // summaries skip the warmup frames (pipeline compilation, first uploads)
+  auto skip = std::min<size_t>(info.warmup_frame_count, cpu_ms.size());
+  auto measured = [&](std::vector<daxa_f32> const &values) {
+    return std::vector<daxa_f32>(values.begin() + skip, values.end());
+  };
+
+  std::ofstream json(info.output + ".json");
+  json << "{\n";
+  json << "  \"device\": \"" << info.device.properties().device_name
+       << "\",\n";
+  json << "  \"frame_count\": " << cpu_ms.size() << ",\n";
+  json << "  \"warmup_frame_count\": " << skip << ",\n";
+  json << "  \"cpu\": ";
+  write_statistics(json, benchmark_statistics(measured(cpu_ms)));
+  json << ",\n  \"frame\": ";
+  write_statistics(json, benchmark_statistics(measured(frame_ms)));
+  json << ",\n  \"present\": ";
+  write_statistics(json, benchmark_statistics(measured(present_ms)));
+  // frames that queued chunks against frames after the world was built,
+  // where the generation passes dispatch no workgroups
+  if (!spec_count.empty()) {
+    std::vector<daxa_f32> generating_ms, idle_ms;
+    for (size_t frame = skip; frame < spec_count.size(); frame++) {
+      (spec_count[frame] != 0 ? generating_ms : idle_ms)
+          .push_back(frame_ms[frame]);
+    }
+    json << ",\n  \"generating_frame\": ";
+    write_statistics(json, benchmark_statistics(generating_ms));
+    json << ",\n  \"idle_frame\": ";
+    write_statistics(json, benchmark_statistics(idle_ms));
+  }
+  // how many frames building the world took and the budgets they ran with,
+  // warmup included since generation starts on the first frame
+  if (!spec_count.empty() && chunk_budget.size() == spec_count.size()) {
+    daxa_u32 frames = 0;
+    daxa_f32 budget_sum = 0;
+    daxa_u32 budget_max = 0;
+    for (size_t frame = 0; frame < spec_count.size(); frame++) {
+      if (spec_count[frame] != 0) {
+        frames++;
+        budget_sum += daxa_f32(chunk_budget[frame]);
+        budget_max = std::max(budget_max, chunk_budget[frame]);
+      }
+    }
+    json << ",\n  \"chunk_budget\": {\"generating_frames\": " << frames
+         << ", \"mean\": "
+         << (frames != 0 ? budget_sum / daxa_f32(frames) : 0.0f)
+         << ", \"max\": " << budget_max << "}";
+  }
+  // GPU time of the uniformity task over every region it covered, warmup
+  // included so each region is counted once
+  auto uniformity_task = std::find(task_names.begin(), task_names.end(),
+                                   std::string("uniformity task"));
+  if (!unispec_count.empty() && uniformity_task != task_names.end()) {
+    auto task = std::distance(task_names.begin(), uniformity_task);
+    daxa_u32 regions = 0;
+    daxa_f32 gpu_ms = 0;
+    for (size_t frame = 0; frame < unispec_count.size(); frame++) {
+      regions += unispec_count[frame];
+      if (!std::isnan(task_ms[frame][task])) {
+        gpu_ms += task_ms[frame][task];
+      }
+    }
+    json << ",\n  \"uniformity\": {\"regions\": " << regions
+         << ", \"gpu_ms\": " << gpu_ms << ", \"ms_per_region\": "
+         << (regions != 0 ? gpu_ms / daxa_f32(regions) : 0.0f) << "}";
+  }
+  // GPU time of the named tasks over every queued chunk, warmup included
+  // like the uniformity above, edits have their own tasks
+  auto write_chunk_tasks = [&](char const *key,
+                               std::initializer_list<char const *> names) {
+    std::vector<size_t> tasks;
+    for (char const *name : names) {
+      auto task = std::find(task_names.begin(), task_names.end(),
+                            std::string(name));
+      if (task != task_names.end()) {
+        tasks.push_back(std::distance(task_names.begin(), task));
+      }
+    }
+    daxa_u32 chunks = 0;
+    daxa_f32 gpu_ms = 0;
+    for (size_t frame = 0; frame < spec_count.size(); frame++) {
+      chunks += spec_count[frame];
+      for (auto task : tasks) {
+        if (!std::isnan(task_ms[frame][task])) {
+          gpu_ms += task_ms[frame][task];
+        }
+      }
+    }
+    json << ",\n  \"" << key << "\": {\"chunks\": " << chunks
+         << ", \"gpu_ms\": " << gpu_ms << ", \"chunks_per_ms\": "
+         << (gpu_ms != 0 ? daxa_f32(chunks) / gpu_ms : 0.0f) << "}";
+  };
+  if (!spec_count.empty()) {
+    write_chunk_tasks("compression",
+                      {"compressor free task", "compressor palettize task",
+                       "compressor allocate task (part 2)",
+                       "compressor write task (part 3)"});
+    // the brush and the compressor against --fused-generation, which keeps
+    // the free task in front of the fused one
+    write_chunk_tasks("generation",
+                      {"brush task", "compressor free task",
+                       "compressor palettize task",
+                       "compressor allocate task (part 2)",
+                       "compressor write task (part 3)",
+                       "compressor fused task"});
+  }
+  // from EditQueue::push() until the frame that rendered the edit is seen
+  // finished
+  if (!edit_latency_ms.empty()) {
+    json << ",\n  \"edits\": {\"count\": " << edit_latency_ms.size()
+         << ", \"latency\": ";
+    write_statistics(json, benchmark_statistics(edit_latency_ms));
+    json << "}";
+  }
+  // buffers created after warmup, anything but zero is an allocator round
+  // trip in the frame loop
+  json << ",\n  \"buffer_creations\": "
+       << std::accumulate(buffer_creations.begin() + skip,
+                          buffer_creations.end(), daxa_u32(0));
+  json << ",\n  \"tasks\": [\n";
+  for (daxa_u32 i = 0; i < task_names.size(); i++) {
+    std::vector<daxa_f32> values;
+    for (size_t frame = skip; frame < task_ms.size(); frame++) {
+      values.push_back(task_ms[frame][i]);
+    }
+    json << "    {\"name\": \"" << task_names[i] << "\", \"gpu\": ";
+    write_statistics(json, benchmark_statistics(values));
+    json << (i + 1 < task_names.size() ? "},\n" : "}\n");
+  }
+  json << "  ]";
+  if (!heap_stats.empty()) {
+    auto const &stats = heap_stats.back();
+    json << ",\n  \"heap\": {\"heap_offset\": " << heap_offset.back()
+         << ", \"peak_heap_offset\": "
+         << *std::max_element(heap_offset.begin(), heap_offset.end())
+         << ", \"allocated_words\": " << stats.allocated_words
+         << ", \"free_words\": " << stats.free_words
+         << ", \"fragmentation\": "
+         << heap_fragmentation(heap_offset.back(), stats)
+         << ", \"allocation_count\": " << stats.allocation_count
+         << ", \"reuse_count\": " << stats.reuse_count
+         << ", \"free_count\": " << stats.free_count
+         << ", \"failed_count\": " << stats.failed_count
+         << ", \"compacted_words\": " << stats.compacted_words
+         << ", \"compact_cycles\": " << stats.compact_cycles << "}";
+  }
+  // wall time from the first frame, warmup included, until a region in the
+  // view frustum is fully generated
+  auto first_visible = std::find_if(visible_region_count.begin(),
+                                    visible_region_count.end(),
+                                    [](daxa_u32 count) { return count != 0; });
+  if (first_visible != visible_region_count.end()) {
+    auto frame = std::distance(visible_region_count.begin(), first_visible);
+    json << ",\n  \"first_visible_terrain\": {\"frame\": " << frame
+         << ", \"ms\": "
+         << std::accumulate(frame_ms.begin(), frame_ms.begin() + frame + 1,
+                            0.0f)
+         << "}";
+  }
+  json << "\n}\n";
+
+  std::cout << "wrote " << info.output << ".csv and " << info.output
+            << ".json" << std::endl;
+}
+
+void Benchmark::write_task_list(std::ostream &out) const {
+  // Reads after reads of a buffer need no barrier, everything else does, and
+  // images also need one for every change of access since it changes their
+  // layout.
+  struct Use {
+    std::string_view access;
+    bool image;
+  };
+  auto barrier = [](Use const &last, Use const &use) {
+    bool write = last.access.find("WRITE") != std::string_view::npos ||
+                 use.access.find("WRITE") != std::string_view::npos;
+    return write || (use.image && use.access != last.access);
+  };
+
+  std::map<std::pair<bool, daxa_u32>, Use> first_uses, last_uses;
+  daxa_u32 barrier_count = 0;
+  auto record = [&](bool image, daxa_u32 index, std::string_view access) {
+    Use use = {access, image};
+    auto key = std::make_pair(image, index);
+    bool needs_barrier =
+        last_uses.contains(key) && barrier(last_uses.at(key), use);
+    first_uses.try_emplace(key, use);
+    last_uses[key] = use;
+    barrier_count += needs_barrier;
+
+    out << "    " << (image ? "image " : "buffer ") << index << " " << access
+        << (needs_barrier ? " (barrier)" : "") << "\n";
+  };
+
+  for (auto const &task_info : task_infos) {
+    out << "  " << task_info.debug_name << "\n";
+    for (auto const &use : task_info.used_buffers) {
+      record(false, use.id.index, daxa::to_string(use.access));
+    }
+    for (auto const &use : task_info.used_images) {
+      record(true, use.id.index, daxa::to_string(use.access));
+    }
+  }
+
+  // the next execution starts from the last accesses of this one
+  daxa_u32 wrap_count = 0;
+  for (auto const &[key, use] : first_uses) {
+    wrap_count += barrier(last_uses.at(key), use);
+  }
+
+  out << "  " << task_infos.size() << " tasks, " << barrier_count
+      << " barriers within an execution and " << wrap_count
+      << " into the next" << std::endl;
+}
+
+CameraPathPoint benchmark_camera_path(daxa_u32 frame, daxa_u32 frame_count) {
+  // circles the first view window, the window follows near its edge
+  daxa_f32 center = daxa_f32(AXIS_VIEW_SIZE) / 2;
+  daxa_f32 radius = daxa_f32(AXIS_VIEW_SIZE) * 0.375f;
+
+  daxa_f32 pi = std::numbers::pi_v<daxa_f32>;
+  daxa_f32 angle = 2.0f * pi * daxa_f32(frame) /
+                   daxa_f32(std::max(frame_count, daxa_u32(1)));
+
+  // rotation.x turns the camera about z so it faces the center, rotation.y
+  // tilts it from looking straight down to just below the horizon
+  return {
+      .translation = {center + radius * std::cos(angle),
+                      center + radius * std::sin(angle), 1.5f},
+      .rotation = {angle + pi / 2.0f, pi / 2.0f - 0.35f},
+  };
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+#include <daxa/utils/task_list.hpp>
+
+#include <chrono>
+#include <ostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <hexane/shared.inl>
+
+// Per-task GPU timestamps and CPU frame times for --headless runs, written as
+// <output>.csv (one row per frame) and <output>.json (summary).
+
+struct BenchmarkInfo {
+  daxa::Device device;
+  bool enabled = false;
+  daxa_u32 warmup_frame_count = 10;
+  std::string output = "benchmark";
+  // frames that can be in flight at once, each writes its timestamps to a
+  // range of its own
+  daxa_u32 slot_count = 1;
+};
+
+struct Benchmark {
+  explicit Benchmark(BenchmarkInfo const &info);
+
+  // Adds the task to the list, bracketed by timestamps when enabled. The
+  // first call also records the query pool reset for the frame.
+  void add_task(daxa::TaskList &task_list, daxa::TaskInfo const &task_info);
+
+  // Starts a frame in the slot, whose previous frame was read back with
+  // end_frame() by now.
+  void begin_frame(daxa_u32 slot);
+  // CPU side of the frame is recorded and submitted.
+  void end_frame_submit();
+  // The tasks added so far are the ones presented, see present_ms.
+  void mark_present();
+  // Reads back the frame in the slot once its GPU work is done, frames are
+  // read in the order they began.
+  void end_frame(daxa_u32 slot);
+  // Ends the last frame, once the device is idle.
+  void finish();
+
+  // Samples the allocator readback of the finished frame.
+  void record_heap(Allocator const &allocator);
+  // Samples Specs::visible_region_count, Specs::spec_count and
+  // UniSpecs::spec_count of the finished frame.
+  void record_specs(daxa_u32 visible_region_count, daxa_u32 spec_count,
+                    daxa_u32 unispec_count);
+  // Samples QueuePush::chunk_budget of the finished frame.
+  void record_budget(daxa_u32 chunk_budget);
+  // Samples the edits the finished frame rendered, by the time they were
+  // pushed onto the EditQueue. Those are the edits of the frame before.
+  void record_edits(
+      std::vector<std::chrono::steady_clock::time_point> const &pushed_at);
+
+  void write_report() const;
+  // Prints every task added so far with the resources it declares, and marks
+  // the accesses that need a barrier after the previous use, wrapping around
+  // to the previous execution of the list.
+  void write_task_list(std::ostream &out) const;
+
+  BenchmarkInfo info;
+  std::optional<daxa::TimelineQueryPool> query_pool;
+  std::vector<std::string> task_names;
+  // every task added, timed or not
+  std::vector<daxa::TaskInfo> task_infos;
+  // tasks up to the present, 0 until mark_present()
+  daxa_u32 present_task_count = 0;
+  // of the frame being recorded
+  daxa_u32 slot = 0;
+
+  std::chrono::steady_clock::time_point frame_start;
+  std::chrono::steady_clock::time_point frame_submit;
+  std::vector<daxa_f32> cpu_ms;
+  // from the start of a frame to the start of the next, frames overlap on
+  // the GPU
+  std::vector<daxa_f32> frame_ms;
+  // GPU time from the first task of a frame to the end of the last one
+  // presented
+  std::vector<daxa_f32> present_ms;
+  // task_ms[frame][task]
+  std::vector<std::vector<daxa_f32>> task_ms;
+  // heap_offset, allocated_words and free_words per frame
+  std::vector<daxa_u32> heap_offset;
+  std::vector<AllocatorStats> heap_stats;
+  std::vector<daxa_u32> visible_region_count;
+  // chunks queued for generation, 0 once the world is built
+  std::vector<daxa_u32> spec_count;
+  // regions handed to the uniformity pass
+  std::vector<daxa_u32> unispec_count;
+  // chunks the queue was allowed to hand out
+  std::vector<daxa_u32> chunk_budget;
+  // push to visible time of every edit, warmup included
+  std::vector<daxa_f32> edit_latency_ms;
+  // benchmark_create_buffer calls during each frame
+  std::vector<daxa_u32> buffer_creations;
+  daxa_u64 last_buffer_creation_count = 0;
+};
+
+// device.create_buffer that counts its calls for the report.
+daxa::BufferId benchmark_create_buffer(daxa::Device &device,
+                                       daxa::BufferInfo const &info);
+
+// Share of the bumped heap that sits on free lists.
+daxa_f32 heap_fragmentation(daxa_u32 heap_offset, AllocatorStats const &stats);
+
+// One line summary of shader_malloc usage, for logs.
+std::string heap_summary(Allocator const &allocator);
+
+// Scripted camera for benchmark runs, orbiting the world center while looking
+// slightly down at the terrain. Units match the main loop (one per region).
+struct CameraPathPoint {
+  daxa_f32vec3 translation;
+  daxa_f32vec2 rotation;
+};
+
+CameraPathPoint benchmark_camera_path(daxa_u32 frame, daxa_u32 frame_count);
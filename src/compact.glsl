@@ -0,0 +1,140 @@
+#include <hexane/shared.inl>
+
+#include <daxa/daxa.inl>
+
+layout(push_constant, scalar) uniform Push
+{
+    CompactPush push;
+};
+
+layout(
+    local_size_x = COMPACT_INVOKE_SIZE, 
+    local_size_y = 1, 
+    local_size_z = 1
+) in;
+
+//One slice of a sliding compaction: live blocks from compact_cursor onwards
+//are moved down to compact_offset, free blocks in between are dropped. Blocks
+//only ever move towards 0, so a slice stages its words in shared memory
+//before storing them, sources and targets may overlap. Between slices
+//shader_malloc may cut new blocks out of the gap, compact_offset moves past
+//them.
+
+shared daxa_u32 slice_words[COMPACT_SLICE_WORDS];
+shared daxa_u32 block_source[COMPACT_SLICE_BLOCKS];
+shared daxa_u32 block_target[COMPACT_SLICE_BLOCKS];
+shared daxa_u32 block_count;
+shared daxa_u32 slice_base;
+
+void main() {
+    daxa_u32 invocation = gl_LocalInvocationIndex;
+
+    if(invocation == 0) {
+        block_count = 0;
+
+        if(deref(push.allocator).compacting == 0
+            && deref(push.allocator).stats.free_words * COMPACT_FREE_RATIO > deref(push.allocator).heap_offset) {
+            deref(push.allocator).compacting = 1;
+            deref(push.allocator).compact_cursor = 0;
+            deref(push.allocator).compact_offset = 0;
+            deref(push.allocator).stats.compact_cycles++;
+
+            //listed blocks may be overwritten before they are popped, the
+            //scan reclaims them instead
+            for(daxa_u32 size_class = 0; size_class < ALLOCATOR_SIZE_CLASS_COUNT; size_class++) {
+                deref(push.allocator).free_heads[size_class] = 0;
+            }
+        }
+
+        if(deref(push.allocator).compacting != 0) {
+            daxa_u32 cursor = deref(push.allocator).compact_cursor;
+            daxa_u32 offset = deref(push.allocator).compact_offset;
+            daxa_u32 heap_offset = min(deref(push.allocator).heap_offset, deref(push.allocator).heap_size);
+            daxa_u32 slice_size = 0;
+
+            for(daxa_u32 i = 0; i < COMPACT_SLICE_BLOCKS && cursor < heap_offset; i++) {
+                daxa_u32 size_word = deref(deref(push.allocator).heap[cursor]);
+                daxa_u32 block_size = size_word & ~ALLOCATOR_FREE_BIT;
+
+                //not a block, the cycle stays parked here instead of
+                //walking off the heap or writing a bad heap_offset back
+                if(block_size == 0 || block_size > heap_offset - cursor) {
+                    break;
+                }
+
+                if((size_word & ALLOCATOR_FREE_BIT) != 0) {
+                    deref(push.allocator).stats.free_words -= block_size;
+                    cursor += block_size;
+                    continue;
+                }
+
+                //nothing freed below this block yet, it stays where it is
+                if(cursor == offset) {
+                    cursor += block_size;
+                    offset += block_size;
+                    continue;
+                }
+
+                if(slice_size + block_size > COMPACT_SLICE_WORDS) {
+                    break;
+                }
+
+                if(block_count == 0) {
+                    slice_base = offset;
+                }
+
+                block_source[block_count] = cursor;
+                block_target[block_count] = offset;
+                block_count++;
+
+                cursor += block_size;
+                offset += block_size;
+                slice_size += block_size;
+            }
+
+            deref(push.allocator).stats.compacted_words += slice_size;
+
+            if(cursor >= heap_offset) {
+                //the tail is returned to the bump pointer
+                deref(push.allocator).heap_offset = offset;
+                deref(push.allocator).compacting = 0;
+            } else {
+                deref(push.allocator).compact_cursor = cursor;
+            }
+            deref(push.allocator).compact_offset = offset;
+        }
+    }
+
+    barrier();
+
+    for(daxa_u32 block = 0; block < block_count; block++) {
+        daxa_u32 source = block_source[block];
+        daxa_u32 staging = block_target[block] - slice_base;
+        daxa_u32 block_size = deref(deref(push.allocator).heap[source]);
+
+        for(daxa_u32 i = invocation; i < block_size; i += COMPACT_INVOKE_SIZE) {
+            slice_words[staging + i] = deref(deref(push.allocator).heap[source + i]);
+        }
+    }
+
+    barrier();
+
+    for(daxa_u32 block = 0; block < block_count; block++) {
+        daxa_u32 target = block_target[block];
+        daxa_u32 staging = target - slice_base;
+        daxa_u32 block_size = slice_words[staging];
+
+        for(daxa_u32 i = invocation; i < block_size; i += COMPACT_INVOKE_SIZE) {
+            deref(deref(push.allocator).heap[target + i]) = slice_words[staging + i];
+        }
+    }
+
+    for(daxa_u32 block = invocation; block < block_count; block += COMPACT_INVOKE_SIZE) {
+        daxa_u32 target = block_target[block];
+        daxa_u32 owner = slice_words[target - slice_base + 1];
+
+        deref(deref(push.regions).data[owner / REGION_SIZE])
+            .chunks[owner % REGION_SIZE]
+            .heap_offset = target + 2;
+    }
+}
@@ -2,6 +2,7 @@
 #extension GL_EXT_debug_printf : require
 
 #include <hexane/shared.inl>
+#include <hexane/information.inl>
 
 #include <daxa/daxa.inl>
 
@@ -12,7 +13,7 @@ layout(push_constant, scalar) uniform Push
 
 #include <hexane/shader_malloc.inl>
 
-#if defined(COMPRESSOR_PALETTIZE) || defined(COMPRESSOR_WRITE)
+#if defined(COMPRESSOR_PALETTIZE) || defined(COMPRESSOR_WRITE) || defined(COMPRESSOR_FUSED)
 layout(
     local_size_x = AXIS_CHUNK_SIZE, 
     local_size_y = AXIS_CHUNK_SIZE, 
@@ -26,60 +27,108 @@ layout(
 ) in;
 #endif
 
+//allocate and write must be compiled with the same width
+#ifdef PALETTE_INDEX_POW2
+#define COMPRESSOR_INDEX_BITS palette_index_bits_pow2
+#else
+#define COMPRESSOR_INDEX_BITS palette_index_bits
+#endif
+
 #define COMPRESSOR_BITS \
     daxa_u32 u32_bits = 32; \
-    daxa_u32 index_bits = daxa_u32(ceil(log2(daxa_f32(deref(deref(push.regions).data[region_index]).chunks[chunk_index].palette_count))));
+    daxa_u32 index_bits = COMPRESSOR_INDEX_BITS(deref(deref(push.regions).data[region_index]).chunks[chunk_index].palette_count);
 
 #define COMPRESSOR_LOAD_INFORMATION daxa_u32 information = imageLoad(push.workspace, daxa_i32vec3(workspace_position)).r;
 
-#ifdef COMPRESSOR_PALETTIZE
+#if defined(COMPRESSOR_PALETTIZE) || defined(COMPRESSOR_FUSED)
 
-void main() {
-    WORKSPACE_PRELUDE
+//open addressing over one slot per voxel, so the table never fills up
+#define PALETTIZE_HASH_SIZE CHUNK_SIZE
 
-    COMPRESSOR_LOAD_INFORMATION
+shared daxa_u32 palettize_hash[PALETTIZE_HASH_SIZE];
+//the distinct ids of the chunk in no particular order
+shared daxa_u32 palettize_ids[CHUNK_SIZE];
+shared daxa_u32 palettize_id_count;
 
+//the hash and the count have to be reset and behind a barrier first
+void compressor_palettize_insert(daxa_u32 information) {
     if(information == VOID) {
-            return;
+        return;
     }
 
-    for(daxa_u32 palette_id = 0; palette_id < PALETTES_SIZE; palette_id++) {
-        daxa_u32 old_information = atomicCompSwap(
-            deref(deref(push.regions).data[region_index])
-                .chunks[chunk_index]
-                .palettes[palette_id]
-                .information,
-            VOID,
-            information
-        );
-        
+    daxa_u32 slot = hash(information) % PALETTIZE_HASH_SIZE;
+
+    for(daxa_u32 probe = 0; probe < PALETTIZE_HASH_SIZE; probe++) {
+        daxa_u32 old_information = atomicCompSwap(palettize_hash[slot], VOID, information);
+
         if(old_information == VOID) {
-            atomicAdd(
-                deref(deref(push.regions).data[region_index])
-                    .chunks[chunk_index]
-                    .palette_count,
-                1
-            );
+            palettize_ids[atomicAdd(palettize_id_count, 1)] = information;
         }
 
-        daxa_u32 current_information = deref(deref(push.regions).data[region_index])
-                .chunks[chunk_index]
-                .palettes[palette_id]
-                .information;
-
-        if(current_information == information) {
+        if(old_information == VOID || old_information == information) {
             break;
         }
-    }    
+
+        slot = (slot + 1) % PALETTIZE_HASH_SIZE;
+    }
 }
-#elif defined(COMPRESSOR_ALLOCATE)
 
-#include <hexane/allocator.inl>
+//the palette id of a distinct id is the number of smaller ones
+daxa_u32 compressor_palettize_rank(daxa_u32 id, daxa_u32 id_count) {
+    daxa_u32 palette_id = 0;
 
-void main() {
-    ALLOCATOR_PRELUDE
+    for(daxa_u32 i = 0; i < id_count; i++) {
+        palette_id += palettize_ids[i] < id ? 1 : 0;
+    }
 
-    COMPRESSOR_BITS
+    return palette_id;
+}
+#endif
+
+#if defined(COMPRESSOR_FREE)
+void compressor_free_chunk(daxa_u32 region_index, daxa_u32 chunk_index) {
+    //queued chunks are compressed from scratch
+    daxa_u32 heap_offset = deref(deref(push.regions).data[region_index])
+        .chunks[chunk_index]
+        .heap_offset;
+    deref(deref(push.regions).data[region_index])
+        .chunks[chunk_index]
+        .heap_offset = 0;
+
+    shader_free(heap_offset);
+
+    for(daxa_u32 palette_id = 0; palette_id < PALETTES_SIZE; palette_id++) {
+        deref(deref(push.regions).data[region_index])
+            .chunks[chunk_index]
+            .palettes[palette_id]
+            .information = VOID;
+    }
+
+    deref(deref(push.regions).data[region_index])
+        .chunks[chunk_index]
+        .palette_count = 0;
+    deref(deref(push.regions).data[region_index])
+        .chunks[chunk_index]
+        .index_bits = 0;
+
+    //the chunk owns its 8 bricks, the write pass sets them again
+    daxa_u32vec3 chunk_origin = one_d_to_three_d(chunk_index, REGION_MAXIMUM) * AXIS_CHUNK_SIZE;
+
+    for(daxa_u32 i = 0; i < 8; i++) {
+        daxa_u32 brick_bit = occupancy_bit(chunk_origin + one_d_to_three_d(i, daxa_u32vec3(2)) * 4, 4);
+
+        deref(deref(push.regions).data[region_index]).occupancy.voxels[brick_bit * 2] = 0;
+        deref(deref(push.regions).data[region_index]).occupancy.voxels[brick_bit * 2 + 1] = 0;
+        atomicAnd(deref(deref(push.regions).data[region_index]).occupancy.bricks[brick_bit / 32], ~(1u << (brick_bit % 32)));
+    }
+}
+#endif
+
+#if defined(COMPRESSOR_ALLOCATE) || defined(COMPRESSOR_FUSED)
+//returns the heap offset, a chunk without a blob reads as its first palette
+daxa_u32 compressor_allocate_chunk(daxa_u32 region_index, daxa_u32 chunk_index, daxa_u32 palette_count) {
+    daxa_u32 u32_bits = 32;
+    daxa_u32 index_bits = COMPRESSOR_INDEX_BITS(palette_count);
 
     daxa_u32 blob_size = daxa_u32(
         ceil(
@@ -88,48 +137,301 @@ void main() {
             / daxa_f32(u32_bits)  
         )
     );
+
+    daxa_u32 heap_offset = shader_malloc(blob_size, ALLOCATOR_OWNER(region_index, chunk_index));
+
+    if(heap_offset == 0) {
+        index_bits = 0;
+    }
     
     deref(deref(push.regions).data[region_index])
         .chunks[chunk_index]
-        .heap_offset = shader_malloc(blob_size);
+        .heap_offset = heap_offset;
+    deref(deref(push.regions).data[region_index])
+        .chunks[chunk_index]
+        .index_bits = index_bits;
+
+    return heap_offset;
+}
+#endif
+
+#if defined(COMPRESSOR_WRITE) || defined(COMPRESSOR_FUSED)
+//the sorted palettes of the chunk and the palette id of every voxel
+shared daxa_u32 write_palettes[PALETTES_SIZE];
+shared daxa_u32 write_palette_ids[CHUNK_SIZE];
+
+//palettes are sorted by COMPRESSOR_PALETTIZE, ids without one, past the
+//first PALETTES_SIZE, fall back to the last palette so that query() never
+//indexes past it
+daxa_u32 compressor_palette_id(daxa_u32 palette_count, daxa_u32 information) {
+    daxa_u32 low = 0;
+    daxa_u32 high = palette_count;
+
+    while(low < high) {
+        daxa_u32 middle = (low + high) / 2;
+
+        if(write_palettes[middle] < information) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low < palette_count && write_palettes[low] == information ? low : palette_count - 1;
+}
+
+//only the first voxel into a word walks up the tree, so each brick and node
+//bit costs a handful of atomics instead of one per voxel
+void compressor_occupy(daxa_u32 region_index, daxa_u32vec3 position) {
+    daxa_u32 voxel_bit = occupancy_bit(position, 1);
+    daxa_u32 old_voxels = atomicOr(deref(deref(push.regions).data[region_index]).occupancy.voxels[voxel_bit / 32], 1u << (voxel_bit % 32));
+
+    if(old_voxels != 0) {
+        return;
+    }
+
+    daxa_u32 brick_bit = occupancy_bit(position, 4);
+    daxa_u32 old_bricks = atomicOr(deref(deref(push.regions).data[region_index]).occupancy.bricks[brick_bit / 32], 1u << (brick_bit % 32));
+
+    if((old_bricks & (1u << (brick_bit % 32))) != 0) {
+        return;
+    }
+
+    daxa_u32 node_bit = occupancy_bit(position, 16);
+    atomicOr(deref(deref(push.regions).data[region_index]).occupancy.nodes[node_bit / 32], 1u << (node_bit % 32));
+}
+
+//one word of the blob from write_palette_ids, words never straddle voxels
+//of another word so neighbouring invocations store independently
+daxa_u32 compressor_pack_word(daxa_u32 word_index, daxa_u32 index_bits) {
+    daxa_u32 u32_bits = 32;
+    daxa_u32 first_bit = word_index * u32_bits;
+    daxa_u32 word = 0;
+
+    for(daxa_u32 i = first_bit / index_bits; i * index_bits < first_bit + u32_bits; i++) {
+        daxa_i32 shift = daxa_i32(i * index_bits) - daxa_i32(first_bit);
+        daxa_u32 palette_id = write_palette_ids[i];
+
+        word |= shift >= 0 ? palette_id << shift : palette_id >> -shift;
+    }
+
+    return word;
+}
+#endif
+
+#ifdef COMPRESSOR_PALETTIZE
+//Deduplicates the ids of the chunk in shared memory, then every distinct id
+//finds its rank among the others and writes its own palette. Palettes come out
+//sorted by id and each one is stored exactly once, without global atomics.
+void main() {
+    WORKSPACE_PRELUDE
+
+    if(workspace_chunk_index >= deref(push.specs).spec_count) {
+        return;
+    }
+
+    palettize_hash[workspace_local_index] = VOID;
+
+    if(workspace_local_index == 0) {
+        palettize_id_count = 0;
+    }
+
+    barrier();
+
+    COMPRESSOR_LOAD_INFORMATION
+
+    compressor_palettize_insert(information);
+
+    barrier();
+
+    daxa_u32 id_count = palettize_id_count;
+
+    if(workspace_local_index == 0) {
+        //ids past PALETTES_SIZE get no palette, same as before
+        deref(deref(push.regions).data[region_index])
+            .chunks[chunk_index]
+            .palette_count = min(id_count, daxa_u32(PALETTES_SIZE));
+    }
+
+    if(workspace_local_index >= id_count) {
+        return;
+    }
+
+    daxa_u32 id = palettize_ids[workspace_local_index];
+    daxa_u32 palette_id = compressor_palettize_rank(id, id_count);
+
+    if(palette_id < PALETTES_SIZE) {
+        deref(deref(push.regions).data[region_index])
+            .chunks[chunk_index]
+            .palettes[palette_id]
+            .information = id;
+    }
+}
+#elif defined(COMPRESSOR_ALLOCATE)
+void main() {
+    ALLOCATOR_PRELUDE
+
+    if(workspace_chunk_index >= deref(push.specs).spec_count) {
+        return;
+    }
+
+    compressor_allocate_chunk(
+        region_index,
+        chunk_index,
+        deref(deref(push.regions).data[region_index]).chunks[chunk_index].palette_count
+    );
+}
+#elif defined(COMPRESSOR_FREE)
+void main() {
+    ALLOCATOR_PRELUDE
+
+    if(workspace_chunk_index >= deref(push.specs).spec_count) {
+        return;
+    }
+
+    compressor_free_chunk(region_index, chunk_index);
 }
 #elif defined(COMPRESSOR_WRITE)
+//The workgroup maps its voxels to palette ids in shared memory, then every
+//word of the blob is assembled by one invocation and stored whole. The blob
+//is written without atomics and without relying on a zeroed heap, and the
+//stores of neighbouring invocations land on neighbouring words.
 void main() {
     WORKSPACE_PRELUDE
 
+    if(workspace_chunk_index >= deref(push.specs).spec_count) {
+        return;
+    }
+
     COMPRESSOR_BITS
 
     COMPRESSOR_LOAD_INFORMATION
 
+    if(information != VOID && information != BLOCK_ID_AIR) {
+        compressor_occupy(region_index, one_d_to_three_d(chunk_index, REGION_MAXIMUM) * AXIS_CHUNK_SIZE + workspace_local_position);
+    }
+
     daxa_u32 palette_count = deref(deref(push.regions).data[region_index])
         .chunks[chunk_index]
         .palette_count;
-    
-    if(palette_count == 0) {
+    daxa_u32 heap_offset = deref(deref(push.regions).data[region_index]).chunks[chunk_index].heap_offset;
+
+    //the same for the whole workgroup
+    if(palette_count == 0 || heap_offset == 0 || index_bits == 0) {
         return;
     }
 
-    daxa_u32 palette_id = 0;
+    if(workspace_local_index < palette_count) {
+        write_palettes[workspace_local_index] = deref(deref(push.regions).data[region_index])
+            .chunks[chunk_index]
+            .palettes[workspace_local_index]
+            .information;
+    }
+
+    barrier();
 
-    for(; palette_id < palette_count; palette_id++) {
-		daxa_u32 palette_information =
+    write_palette_ids[workspace_local_index] = compressor_palette_id(palette_count, information);
+
+    barrier();
+
+    //CHUNK_SIZE * index_bits is a whole number of words for any width
+    daxa_u32 word_count = CHUNK_SIZE * index_bits / u32_bits;
+
+    if(workspace_local_index >= word_count) {
+        return;
+    }
+
+    deref(deref(push.allocator).heap[heap_offset + workspace_local_index]) = compressor_pack_word(workspace_local_index, index_bits);
+}
+#elif defined(COMPRESSOR_FUSED)
+
+#include <hexane/terrain.inl>
+
+//the voxels of the chunk, in place of the workspace
+shared daxa_u32 fused_voxels[CHUNK_SIZE];
+shared daxa_u32 fused_heap_offset;
+
+//Brush, palettize, allocate and write of one chunk in one workgroup.
+//The voxels never leave shared memory, so there is no workspace image to
+//store to and load from and no barrier between dispatches. The chunks are
+//freed by COMPRESSOR_FREE in the dispatch before, shader_malloc must not
+//race shader_free.
+void main() {
+    ALLOCATOR_PRELUDE
+
+    if(workspace_chunk_index >= deref(push.specs).spec_count) {
+        return;
+    }
+
+    daxa_u32vec3 local_position = gl_LocalInvocationID;
+    daxa_u32 local_index = three_d_to_one_d(local_position, CHUNK_MAXIMUM);
+
+    if(local_index == 0) {
+        palettize_id_count = 0;
+    }
+
+    palettize_hash[local_index] = VOID;
+
+    daxa_i32vec3 position = daxa_i32vec3(local_position)
+        + AXIS_CHUNK_SIZE * daxa_i32vec3(one_d_to_three_d(chunk_index, REGION_MAXIMUM))
+        + AXIS_CHUNK_SIZE * AXIS_REGION_SIZE * deref(push.specs).spec[workspace_chunk_index].origin;
+
+    daxa_u32 information = world_gen_base(position);
+
+    barrier();
+
+    compressor_palettize_insert(information);
+
+    barrier();
+
+    daxa_u32 id_count = palettize_id_count;
+    //ids past PALETTES_SIZE get no palette, same as COMPRESSOR_PALETTIZE
+    daxa_u32 palette_count = min(id_count, daxa_u32(PALETTES_SIZE));
+
+    if(local_index < id_count) {
+        daxa_u32 id = palettize_ids[local_index];
+        daxa_u32 palette_id = compressor_palettize_rank(id, id_count);
+
+        if(palette_id < PALETTES_SIZE) {
+            write_palettes[palette_id] = id;
             deref(deref(push.regions).data[region_index])
                 .chunks[chunk_index]
                 .palettes[palette_id]
-                .information;
+                .information = id;
+        }
+    }
 
-        if(information == palette_information) {
-            break;
-		}
-	}
+    if(local_index == 0) {
+        deref(deref(push.regions).data[region_index])
+            .chunks[chunk_index]
+            .palette_count = palette_count;
+        fused_heap_offset = compressor_allocate_chunk(region_index, chunk_index, palette_count);
+    }
 
-    for(daxa_u32 bit = 0; bit < index_bits; bit++) {
-        daxa_u32 bit_index = workspace_local_index * index_bits
-            + bit
-            + u32_bits * deref(deref(push.regions).data[region_index]).chunks[chunk_index].heap_offset;
-        daxa_u32 heap_offset = bit_index / u32_bits;
-        daxa_u32 bit_offset = bit_index % u32_bits;
-        atomicOr(deref(deref(push.allocator).heap[heap_offset]), ((palette_id >> bit) & 1) << bit_offset);             
+    if(information != VOID && information != BLOCK_ID_AIR) {
+        compressor_occupy(region_index, one_d_to_three_d(chunk_index, REGION_MAXIMUM) * AXIS_CHUNK_SIZE + local_position);
     }
+
+    barrier();
+
+    daxa_u32 heap_offset = fused_heap_offset;
+    daxa_u32 index_bits = COMPRESSOR_INDEX_BITS(palette_count);
+
+    //the same for the whole workgroup
+    if(palette_count == 0 || heap_offset == 0 || index_bits == 0) {
+        return;
+    }
+
+    write_palette_ids[local_index] = compressor_palette_id(palette_count, information);
+
+    barrier();
+
+    daxa_u32 word_count = CHUNK_SIZE * index_bits / 32;
+
+    if(local_index >= word_count) {
+        return;
+    }
+
+    deref(deref(push.allocator).heap[heap_offset + local_index]) = compressor_pack_word(local_index, index_bits);
 }
 #endif
\ No newline at end of file
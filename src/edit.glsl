@@ -0,0 +1,170 @@
+#include <hexane/shared.inl>
+#include <hexane/information.inl>
+
+#include <daxa/daxa.inl>
+
+layout(push_constant, scalar) uniform Push
+{
+    EditPush push;
+};
+
+#ifdef EDIT_QUEUE
+
+#define EDIT_INVOKE_SIZE 512
+#define EDIT_UNIFORMITY_AXIS ((AXIS_REGION_SIZE * AXIS_CHUNK_SIZE) / UNIFORMITY_BLOCK_SIZE)
+
+layout(
+    local_size_x = EDIT_INVOKE_SIZE,
+    local_size_y = 1,
+    local_size_z = 1
+) in;
+
+//view cell * REGION_SIZE + chunk index of every spec, for finding duplicates
+shared daxa_u32 chunk_keys[EDIT_CHUNKS_PER_FRAME];
+shared daxa_u32 chunk_count;
+//uniformity blocks to rebuild per view cell
+shared daxa_u32 block_masks[VIEW_SIZE];
+shared daxa_u32 unispec_count;
+
+//Lists every generated chunk in the bounds of the edits once, in one
+//workgroup. The host never uploads edits whose bounds hold more than
+//EDIT_CHUNKS_PER_FRAME chunks together, so the workspace can not overflow.
+void main() {
+    daxa_u32 invocation = gl_LocalInvocationIndex;
+
+    if(invocation == 0) {
+        deref(push.specs).volume = push.volume;
+        deref(push.specs).visible_region_count = 0;
+        deref(push.unispecs).volume = push.volume;
+        chunk_count = 0;
+        unispec_count = 0;
+    }
+
+    for(daxa_u32 cell_index = invocation; cell_index < VIEW_SIZE; cell_index += EDIT_INVOKE_SIZE) {
+        block_masks[cell_index] = 0;
+    }
+
+    barrier();
+
+    daxa_u32vec3 window_origin = deref(push.volume).window_origin;
+
+    for(daxa_u32 edit_index = 0; edit_index < deref(push.edits).edit_count; edit_index++) {
+        Edit edit = deref(push.edits).edit[edit_index];
+        daxa_u32vec3 minimum = edit_chunk_minimum(edit);
+        daxa_u32 candidate_count = edit_chunk_count(edit);
+        daxa_u32vec3 size = max(edit_chunk_maximum(edit), minimum) - minimum;
+
+        //the chunks of one edit are distinct, only earlier edits can have listed them
+        daxa_u32 known_count = chunk_count;
+
+        barrier();
+
+        for(daxa_u32 i = invocation; i < candidate_count; i += EDIT_INVOKE_SIZE) {
+            daxa_u32vec3 chunk = minimum + one_d_to_three_d(i, size);
+            daxa_u32vec3 region_position = chunk / AXIS_REGION_SIZE;
+
+            if(!view_contains(window_origin, region_position)) {
+                continue;
+            }
+
+            daxa_u32 cell_index = view_cell_index(region_position);
+            daxa_u32 slot = deref(push.volume).region_indices[cell_index];
+            daxa_u32vec3 chunk_position = chunk % AXIS_REGION_SIZE;
+            daxa_u32 chunk_index = three_d_to_one_d(chunk_position, REGION_MAXIMUM);
+
+            //chunks the queue has not handed out yet are generated afterwards
+            if(slot == 0 || chunk_index >= deref(deref(push.regions).data[slot]).chunk_count) {
+                continue;
+            }
+
+            daxa_u32 key = cell_index * REGION_SIZE + chunk_index;
+            bool known = false;
+
+            for(daxa_u32 j = 0; j < known_count && !known; j++) {
+                known = chunk_keys[j] == key;
+            }
+
+            if(known) {
+                continue;
+            }
+
+            daxa_u32 spec_index = atomicAdd(chunk_count, 1);
+            chunk_keys[spec_index] = key;
+            deref(push.specs).spec[spec_index] = Spec(
+                cell_index,
+                chunk_index,
+                daxa_i32vec3(region_position)
+            );
+
+            //regions the queue has not built the uniformity of yet get all of it later
+            if(deref(deref(push.regions).data[slot]).uniformity_queued != 0) {
+                daxa_u32vec3 block = chunk_position * AXIS_CHUNK_SIZE / UNIFORMITY_BLOCK_SIZE;
+                atomicOr(block_masks[cell_index], 1u << three_d_to_one_d(block, daxa_u32vec3(EDIT_UNIFORMITY_AXIS)));
+            }
+        }
+
+        barrier();
+    }
+
+    for(daxa_u32 cell_index = invocation; cell_index < VIEW_SIZE; cell_index += EDIT_INVOKE_SIZE) {
+        if(block_masks[cell_index] != 0) {
+            deref(push.unispecs).spec[atomicAdd(unispec_count, 1)] = UniSpec(cell_index, block_masks[cell_index]);
+        }
+    }
+
+    barrier();
+
+    if(invocation == 0) {
+        deref(push.specs).spec_count = chunk_count;
+        deref(push.unispecs).spec_count = unispec_count;
+        deref(push.dispatch).generation = DispatchIndirect(chunk_count, 1, 1);
+        deref(push.dispatch).uniformity = DispatchIndirect(
+            EDIT_UNIFORMITY_AXIS,
+            EDIT_UNIFORMITY_AXIS,
+            EDIT_UNIFORMITY_AXIS * unispec_count
+        );
+    }
+}
+
+#elif defined(EDIT_APPLY)
+
+layout(
+    local_size_x = AXIS_CHUNK_SIZE,
+    local_size_y = AXIS_CHUNK_SIZE,
+    local_size_z = AXIS_CHUNK_SIZE
+) in;
+
+//one workgroup per listed chunk, dispatched from QueueDispatch::generation
+void main() {
+    WORKSPACE_PRELUDE
+
+    if(workspace_chunk_index >= deref(push.specs).spec_count) {
+        return;
+    }
+
+    daxa_i32vec3 position = daxa_i32vec3(workspace_local_position)
+        + AXIS_CHUNK_SIZE * daxa_i32vec3(one_d_to_three_d(chunk_index, REGION_MAXIMUM))
+        + AXIS_CHUNK_SIZE * AXIS_REGION_SIZE * deref(push.specs).spec[workspace_chunk_index].origin;
+
+    Query q;
+    q.volume = push.volume;
+    q.regions = push.regions;
+    q.allocator = push.allocator;
+    q.position = daxa_u32vec3(position);
+
+    query(q);
+
+    daxa_u32 information = q.information;
+
+    for(daxa_u32 edit_index = 0; edit_index < deref(push.edits).edit_count; edit_index++) {
+        Edit edit = deref(push.edits).edit[edit_index];
+
+        if(edit_contains(edit, position)) {
+            information = edit.block_id;
+        }
+    }
+
+    imageStore(push.workspace, daxa_i32vec3(workspace_position), daxa_u32vec4(information, 0, 0, 0));
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "edit_queue.hpp"
+
+#include <stdexcept>
+#include <string>
+
+void EditQueue::push(Edit const &edit) {
+  if (edit_chunk_count(edit) > EDIT_CHUNKS_PER_FRAME) {
+    throw std::invalid_argument(
+        "edit covers " + std::to_string(edit_chunk_count(edit)) +
+        " chunks, a frame edits " + std::to_string(EDIT_CHUNKS_PER_FRAME));
+  }
+
+  pending.push_back({.edit = edit, .pushed_at = Clock::now()});
+}
+
+void EditQueue::voxel(daxa_i32vec3 position, daxa_u32 block_id) {
+  push({
+      .shape = EDIT_SHAPE_BOX,
+      .block_id = block_id,
+      .center = position,
+      .extent = {0, 0, 0},
+  });
+}
+
+void EditQueue::box(daxa_i32vec3 center, daxa_u32vec3 extent,
+                    daxa_u32 block_id) {
+  push({
+      .shape = EDIT_SHAPE_BOX,
+      .block_id = block_id,
+      .center = center,
+      .extent = extent,
+  });
+}
+
+void EditQueue::sphere(daxa_i32vec3 center, daxa_u32 radius,
+                       daxa_u32 block_id) {
+  push({
+      .shape = EDIT_SHAPE_SPHERE,
+      .block_id = block_id,
+      .center = center,
+      .extent = {radius, radius, radius},
+  });
+}
+
+void EditQueue::take_frame(Edits &edits,
+                           std::vector<Clock::time_point> &pushed_at) {
+  edits.edit_count = 0;
+  pushed_at.clear();
+
+  // edit_chunk_count() bounds the chunks EDIT_QUEUE lists for an edit
+  daxa_u32 chunk_count = 0;
+  while (!pending.empty() && edits.edit_count < EDITS_PER_FRAME &&
+         chunk_count + edit_chunk_count(pending.front().edit) <=
+             EDIT_CHUNKS_PER_FRAME) {
+    chunk_count += edit_chunk_count(pending.front().edit);
+    edits.edit[edits.edit_count++] = pending.front().edit;
+    pushed_at.push_back(pending.front().pushed_at);
+    pending.pop_front();
+  }
+}
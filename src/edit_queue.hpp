@@ -0,0 +1,35 @@
+#pragma once
+
+#include <hexane/shared.inl>
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+// Edits pushed by the host, waiting for the frame that uploads them. A frame
+// takes at most EDITS_PER_FRAME of them, covering EDIT_CHUNKS_PER_FRAME chunks
+// or less, the rest stay queued in order for the frames after.
+
+struct EditQueue {
+  using Clock = std::chrono::steady_clock;
+
+  // Throws std::invalid_argument for an edit whose bounds hold more than
+  // EDIT_CHUNKS_PER_FRAME chunks, it could never be uploaded.
+  void push(Edit const &edit);
+  void voxel(daxa_i32vec3 position, daxa_u32 block_id);
+  void box(daxa_i32vec3 center, daxa_u32vec3 extent, daxa_u32 block_id);
+  void sphere(daxa_i32vec3 center, daxa_u32 radius, daxa_u32 block_id);
+
+  // Moves the edits of the next frame into edits, and the times they were
+  // pushed at into pushed_at.
+  void take_frame(Edits &edits, std::vector<Clock::time_point> &pushed_at);
+
+  bool empty() const { return pending.empty(); }
+
+  struct Pending {
+    Edit edit;
+    Clock::time_point pushed_at;
+  };
+
+  std::deque<Pending> pending;
+};
@@ -0,0 +1,42 @@
+#include "generation_budget.hpp"
+
+#include <hexane/edit.inl>
+
+#include <algorithm>
+#include <cmath>
+
+GenerationBudget::GenerationBudget(GenerationBudgetInfo const &info)
+    : info(info),
+      chunk_budget(std::clamp(info.initial_budget, daxa_u32(1),
+                              info.maximum_budget)) {}
+
+void GenerationBudget::record(daxa_f32 gpu_ms, daxa_u32 spec_count) {
+  if (info.target_ms <= 0 || spec_count == 0 || std::isnan(gpu_ms) ||
+      gpu_ms <= 0) {
+    return;
+  }
+
+  daxa_f32 sample = gpu_ms / daxa_f32(spec_count);
+  if (ms_per_chunk == 0) {
+    ms_per_chunk = sample;
+  } else {
+    ms_per_chunk += GENERATION_BUDGET_SMOOTHING * (sample - ms_per_chunk);
+  }
+
+  // a layer at least, the fixed cost of the dispatches makes tiny frames
+  // look expensive per chunk
+  daxa_f32 budget = std::min(info.target_ms / ms_per_chunk,
+                             2.0f * daxa_f32(chunk_budget));
+  daxa_u32 minimum_budget =
+      std::min(daxa_u32(WORKSPACE_LAYER_SIZE), info.maximum_budget);
+  chunk_budget =
+      std::clamp(daxa_u32(budget), minimum_budget, info.maximum_budget);
+}
+
+daxa_u32 workspace_capacity(daxa_u32 chunk_budget) {
+  daxa_u32 capacity =
+      std::clamp(chunk_budget, daxa_u32(EDIT_CHUNKS_PER_FRAME),
+                 daxa_u32(WORKSPACE_SIZE));
+  return (capacity + WORKSPACE_LAYER_SIZE - 1) / WORKSPACE_LAYER_SIZE *
+         WORKSPACE_LAYER_SIZE;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <hexane/shared.inl>
+
+// The chunks the queue hands out per frame. With a target it follows the GPU
+// time the generation tasks of finished frames took: the cost of a chunk is
+// smoothed over frames and the budget is what fits in the target, growing at
+// most twice as large per frame and shrinking right away.
+
+// weight of the newest frame in GenerationBudget::ms_per_chunk
+#define GENERATION_BUDGET_SMOOTHING 0.25f
+
+struct GenerationBudgetInfo {
+  // GPU milliseconds per frame to spend on generation, 0 keeps the budget at
+  // initial_budget
+  daxa_f32 target_ms = 0;
+  daxa_u32 initial_budget = CHUNKS_PER_FRAME;
+  // the chunks the workspace holds, WORKSPACE_SIZE at most
+  daxa_u32 maximum_budget = CHUNKS_PER_FRAME;
+};
+
+struct GenerationBudget {
+  explicit GenerationBudget(GenerationBudgetInfo const &info);
+
+  // Feeds back a finished frame that queued spec_count chunks and spent
+  // gpu_ms generating them. Frames without chunks change nothing.
+  void record(daxa_f32 gpu_ms, daxa_u32 spec_count);
+
+  GenerationBudgetInfo info;
+  // QueuePush::chunk_budget of the next frame
+  daxa_u32 chunk_budget;
+  // 0 until the first frame with chunks
+  daxa_f32 ms_per_chunk = 0;
+};
+
+// Chunks the workspace has to hold for budgets up to chunk_budget, whole
+// layers and never fewer than the edits of a frame cover.
+daxa_u32 workspace_capacity(daxa_u32 chunk_budget);
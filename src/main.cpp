@@ -4,8 +4,11 @@
 #include <daxa/utils/math_operators.hpp>
 #include <daxa/utils/pipeline_manager.hpp>
 #include <daxa/utils/task_list.hpp>
+#include <deque>
 #include <iostream>
+#include <optional>
 #include <span>
+#include <string>
 #include <variant>
 
 #define GLM_SWIZZLE
@@ -56,10 +59,55 @@ struct WindowInfo {
 
 #include <hexane/shared.inl>
 
-void upload_allocator_task(daxa::Device &device, daxa::CommandList &cmd_list,
+#include "benchmark.hpp"
+#include "edit_queue.hpp"
+#include "generation_budget.hpp"
+#include "upload_ring.hpp"
+
+struct Options {
+  bool headless = false;
+  daxa_u32 frame_count = 600;
+  daxa_u32 warmup_frame_count = 10;
+  std::string output = "benchmark";
+  // compile the compressor with PALETTE_INDEX_POW2
+  bool pow2_index_bits = false;
+  // chunks queued per frame, clamped to WORKSPACE_SIZE, or the first frame's
+  // with a generation target
+  daxa_u32 chunk_budget = CHUNKS_PER_FRAME;
+  // GPU ms per frame for the generation tasks, the chunk budget follows it up
+  // to max_chunk_budget and 0 keeps chunk_budget
+  daxa_f32 generation_target_ms = 0;
+  daxa_u32 max_chunk_budget = WORKSPACE_SIZE;
+  // queue regions in the view frustum and near the camera first
+  bool streaming = true;
+  // compile every shader with VOLUME_HASH
+  bool region_hash = false;
+  // trace through RegionUniformity instead of RegionOccupancy
+  bool uniformity_traversal = false;
+  // draw a ray traced cube per region instead of one fullscreen trace
+  bool raster_regions = false;
+  // RAYTRACE_DEBUG_STEPS, steps and regions crossed per pixel
+  bool debug_steps = false;
+  // print the tasks of every task list and the barriers they imply
+  bool dump_task_lists = false;
+  // carve a sphere in front of the camera every N frames, 0 never does
+  daxa_u32 edit_interval = 0;
+  // generate queued chunks with COMPRESSOR_FUSED instead of the brush and
+  // the four compressor passes, edits keep going through the passes
+  bool fused_generation = false;
+  // record the generation ahead of the render in one submission, the order
+  // before the render went first, to compare frame times against
+  bool generate_before_render = false;
+};
+
+Options parse_options(int argc, char *argv[]);
+
+void upload_allocator_task(UploadRing &upload_ring,
+                           daxa::CommandList &cmd_list,
                            daxa::BufferId buffer_id,
-                           daxa::BufferDeviceAddress heap_id);
-void upload_regions_task(daxa::Device &device, daxa::CommandList &cmd_list,
+                           daxa::BufferDeviceAddress heap_id,
+                           daxa_u32 heap_size);
+void upload_regions_task(UploadRing &upload_ring, daxa::CommandList &cmd_list,
                          daxa::BufferId buffer_id,
                          daxa::BufferDeviceAddress regions_id);
 void raytrace_prepare_task(
@@ -76,43 +124,79 @@ void raytrace_draw_task(
     daxa::BufferId raytrace_specs_id, daxa::BufferId allocator_id,
     daxa::ImageId swapchain_image, daxa::ImageId depth_image, daxa::u32 width,
     daxa::u32 height);
-void upload_perframe_task(daxa::Device &device, daxa::CommandList &cmd_list,
-                          daxa::BufferId buffer_id, Perframe perframe);
+void raytrace_trace_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &trace_pipeline,
+    daxa::BufferId volume_id, daxa::BufferId regions_id,
+    daxa::BufferId perframe_id, daxa::BufferId allocator_id,
+    daxa::ImageId render_image, daxa::u32 width, daxa::u32 height,
+    daxa_u32 debug_view);
+void upload_perframe_task(UploadRing &upload_ring, daxa::CommandList &cmd_list,
+                          daxa::BufferId buffer_id, Perframe const &perframe);
+void upload_edits_task(UploadRing &upload_ring, daxa::CommandList &cmd_list,
+                       daxa::BufferId buffer_id, Edits const &edits);
+void edit_queue_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &edit_queue_pipeline,
+    daxa::BufferId edits_id, daxa::BufferId volume_id,
+    daxa::BufferId regions_id, daxa::BufferId specs_id,
+    daxa::BufferId unispecs_id, daxa::BufferId dispatch_id);
+void edit_apply_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &edit_apply_pipeline,
+    daxa::BufferId edits_id, daxa::BufferId volume_id,
+    daxa::BufferId regions_id, daxa::BufferId allocator_id,
+    daxa::BufferId specs_id, daxa::BufferId dispatch_id,
+    daxa::ImageId workspace_id);
 void queue_task(daxa::Device &device, daxa::CommandList &cmd_list,
                 std::shared_ptr<daxa::ComputePipeline> &queue_pipeline,
-                daxa::BufferId regions_id, daxa::BufferId volume_id,
-                daxa::BufferId allocator_id, daxa::BufferId specs_id,
-                daxa::BufferId unispecs_id);
+                daxa::BufferId perframe_id, daxa::BufferId regions_id,
+                daxa::BufferId volume_id, daxa::BufferId allocator_id,
+                daxa::BufferId specs_id, daxa::BufferId unispecs_id,
+                daxa::BufferId dispatch_id, daxa_u32 chunk_budget,
+                bool streaming);
 void brush_task(daxa::Device &device, daxa::CommandList &cmd_list,
                 std::shared_ptr<daxa::ComputePipeline> &brush_pipeline,
-                daxa::BufferId volume_id, daxa::BufferId allocator_id,
-                daxa::BufferId specs_id, daxa::ImageId workspace_id);
+                daxa::BufferId specs_id, daxa::BufferId dispatch_id,
+                daxa::ImageId workspace_id);
 void uniformity_task(
     daxa::Device &device, daxa::CommandList &cmd_list,
-    const std::shared_ptr<daxa::ComputePipeline> *uniformity_pipelines,
+    std::shared_ptr<daxa::ComputePipeline> &uniformity_pipeline,
     daxa::BufferId regions_id, daxa::BufferId unispecs_id,
+    daxa::BufferId allocator_id, daxa::BufferId dispatch_id);
+void compressor_free_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &compressor_free_pipeline,
+    daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id);
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id);
+void compact_task(daxa::Device &device, daxa::CommandList &cmd_list,
+                  std::shared_ptr<daxa::ComputePipeline> &compact_pipeline,
+                  daxa::BufferId regions_id, daxa::BufferId allocator_id);
 void compressor_palettize_task(
     daxa::Device &device, daxa::CommandList &cmd_list,
     std::shared_ptr<daxa::ComputePipeline> &compressor_palettize_pipeline,
     daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id);
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id);
 void compressor_allocate_task(
     daxa::Device &device, daxa::CommandList &cmd_list,
     std::shared_ptr<daxa::ComputePipeline> &compressor_allocate_pipeline,
     daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id);
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id);
 void compressor_write_task(
     daxa::Device &device, daxa::CommandList &cmd_list,
     std::shared_ptr<daxa::ComputePipeline> &compressor_write_pipeline,
     daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id);
-void clear_workspace_task(daxa::Device &device, daxa::CommandList &cmd_list,
-                          daxa::ImageId workspace_id);
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id);
+void compressor_fused_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &compressor_fused_pipeline,
+    daxa::BufferId regions_id, daxa::BufferId volume_id,
+    daxa::BufferId allocator_id, daxa::BufferId specs_id,
+    daxa::BufferId dispatch_id);
 void create_images(daxa::Device &device, daxa::u32 width, daxa::u32 height,
                    daxa::ImageId &color_image, daxa::ImageId &depth_image,
                    daxa::ImageId &motion_vectors_image);
@@ -135,8 +219,6 @@ static void cursor_position_callback(GLFWwindow *window, double x_pos,
   last_y_pos = y_pos;
 }
 
-#define GIGABYTE daxa_u32(1e+9)
-
 void mouse_button_callback(GLFWwindow *window, int button, int action,
                            int mods) {
   if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
@@ -145,27 +227,31 @@ void mouse_button_callback(GLFWwindow *window, int button, int action,
   }
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+  auto options = parse_options(argc, argv);
+
   auto window_info = WindowInfo{.width = 800, .height = 600};
-  glfwInit();
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  auto glfw_window_ptr = glfwCreateWindow(
-      static_cast<daxa::i32>(window_info.width),
-      static_cast<daxa::i32>(window_info.height), "Hexane", nullptr, nullptr);
-  glfwSetWindowUserPointer(glfw_window_ptr, &window_info);
-  glfwSetWindowSizeCallback(glfw_window_ptr, [](GLFWwindow *glfw_window,
-                                                int width, int height) {
-    auto &window_info_ref =
-        *reinterpret_cast<WindowInfo *>(glfwGetWindowUserPointer(glfw_window));
-    window_info_ref.swapchain_out_of_date = true;
-    window_info_ref.width = static_cast<daxa::u32>(width);
-    window_info_ref.height = static_cast<daxa::u32>(height);
-  });
-  if (glfwRawMouseMotionSupported())
-    glfwSetInputMode(glfw_window_ptr, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
-  glfwSetCursorPosCallback(glfw_window_ptr, cursor_position_callback);
-  glfwSetMouseButtonCallback(glfw_window_ptr, mouse_button_callback);
-  auto native_window_handle = get_native_handle(glfw_window_ptr);
+  GLFWwindow *glfw_window_ptr = nullptr;
+  if (!options.headless) {
+    glfwInit();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfw_window_ptr = glfwCreateWindow(
+        static_cast<daxa::i32>(window_info.width),
+        static_cast<daxa::i32>(window_info.height), "Hexane", nullptr, nullptr);
+    glfwSetWindowUserPointer(glfw_window_ptr, &window_info);
+    glfwSetWindowSizeCallback(glfw_window_ptr, [](GLFWwindow *glfw_window,
+                                                  int width, int height) {
+      auto &window_info_ref = *reinterpret_cast<WindowInfo *>(
+          glfwGetWindowUserPointer(glfw_window));
+      window_info_ref.swapchain_out_of_date = true;
+      window_info_ref.width = static_cast<daxa::u32>(width);
+      window_info_ref.height = static_cast<daxa::u32>(height);
+    });
+    if (glfwRawMouseMotionSupported())
+      glfwSetInputMode(glfw_window_ptr, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+    glfwSetCursorPosCallback(glfw_window_ptr, cursor_position_callback);
+    glfwSetMouseButtonCallback(glfw_window_ptr, mouse_button_callback);
+  }
 
   daxa::Context context = daxa::create_context({.enable_validation = false});
 
@@ -192,22 +278,39 @@ int main() {
       .debug_name = "my device",
   });
 
-  daxa::Swapchain swapchain = device.create_swapchain({
-      .native_window = native_window_handle,
-      .native_window_platform = get_native_platform(glfw_window_ptr),
-      .surface_format_selector =
-          [](daxa::Format format) {
-            switch (format) {
-            case daxa::Format::R8G8B8A8_UINT:
-              return 100;
-            default:
-              return daxa::default_format_score(format);
-            }
-          },
-      .present_mode = daxa::PresentMode::IMMEDIATE,
-      .image_usage = daxa::ImageUsageFlagBits::TRANSFER_DST,
-      .debug_name = "my swapchain",
-  });
+  // headless runs render straight into display_image, so they work on
+  // devices without any presentation support (lavapipe on build machines)
+  std::optional<daxa::Swapchain> swapchain;
+  if (!options.headless) {
+    swapchain = device.create_swapchain({
+        .native_window = get_native_handle(glfw_window_ptr),
+        .native_window_platform = get_native_platform(glfw_window_ptr),
+        .surface_format_selector =
+            [](daxa::Format format) {
+              switch (format) {
+              case daxa::Format::R8G8B8A8_UINT:
+                return 100;
+              default:
+                return daxa::default_format_score(format);
+              }
+            },
+        .present_mode = daxa::PresentMode::IMMEDIATE,
+        .image_usage = daxa::ImageUsageFlagBits::TRANSFER_DST,
+        .debug_name = "my swapchain",
+    });
+  }
+
+  auto render_format = swapchain.has_value() ? swapchain->get_format()
+                                             : daxa::Format::R16G16B16A16_SFLOAT;
+
+  // every pipeline inherits these, INDICES has to agree between them
+  std::vector<daxa::ShaderDefine> shader_defines;
+  if (options.region_hash) {
+    shader_defines.push_back(daxa::ShaderDefine{"VOLUME_HASH"});
+  }
+  if (options.uniformity_traversal) {
+    shader_defines.push_back(daxa::ShaderDefine{"RAYTRACE_UNIFORMITY"});
+  }
 
   auto pipeline_manager = daxa::PipelineManager({
       .device = device,
@@ -221,6 +324,7 @@ int main() {
                   },
               .language = daxa::ShaderLanguage::GLSL,
               .enable_debug_info = false,
+              .defines = shader_defines,
           },
       .debug_name = "my pipeline manager",
   });
@@ -257,7 +361,7 @@ int main() {
              {.source = daxa::ShaderFile{"raytrace.glsl"},
               .compile_options = {.defines = {daxa::ShaderDefine{
                                       "RAYTRACE_FRAG"}}}},
-         .color_attachments = {{.format = swapchain.get_format()}},
+         .color_attachments = {{.format = render_format}},
          .depth_test =
              {
                  .depth_attachment_format = daxa::Format::D32_SFLOAT,
@@ -286,7 +390,7 @@ int main() {
              {.source = daxa::ShaderFile{"raytrace.glsl"},
               .compile_options = {.defines = {daxa::ShaderDefine{
                                       "RAYTRACE_FRAG"}}}},
-         .color_attachments = {{.format = swapchain.get_format()}},
+         .color_attachments = {{.format = render_format}},
          .depth_test =
              {
                  .depth_attachment_format = daxa::Format::D32_SFLOAT,
@@ -308,29 +412,19 @@ int main() {
     raytrace_back_pipeline = result.value();
   }
 
-  std::shared_ptr<daxa::ComputePipeline> uniformity_pipelines[5];
-  for (daxa_u32 i = 0; i < 5; i++) {
-    daxa_u32 uniformity_size = pow(2, i + 1);
-    daxa_u32 uniformity_invoke_size =
-        std::clamp(uniformity_size, daxa_u32(2), daxa_u32(8));
+  // every lod level in one pass
+  std::shared_ptr<daxa::ComputePipeline> uniformity_pipeline;
+  {
     auto result = pipeline_manager.add_compute_pipeline({
-        .shader_info = {.source = daxa::ShaderFile{"uniformity.glsl"},
-                        .compile_options =
-                            {.defines = {daxa::ShaderDefine{
-                                             "UNIFORMITY_SIZE",
-                                             std::to_string(uniformity_size)},
-                                         daxa::ShaderDefine{
-                                             "UNIFORMITY_INVOKE_SIZE",
-                                             std::to_string(
-                                                 uniformity_invoke_size)}}}},
-        .push_constant_size = sizeof(RaytracePreparePush),
+        .shader_info = {.source = daxa::ShaderFile{"uniformity.glsl"}},
+        .push_constant_size = sizeof(UniformityPush),
         .debug_name = "uniformity_pipeline",
     });
     if (result.is_err()) {
       std::cerr << result.message() << std::endl;
       return -1;
     }
-    uniformity_pipelines[i] = result.value();
+    uniformity_pipeline = result.value();
   }
 
   std::shared_ptr<daxa::ComputePipeline> prepare_back_pipeline;
@@ -364,6 +458,22 @@ int main() {
     prepare_front_pipeline = result.value();
   }
 
+  std::shared_ptr<daxa::ComputePipeline> trace_pipeline;
+  {
+    auto result = pipeline_manager.add_compute_pipeline({
+        .shader_info = {.source = daxa::ShaderFile{"raytrace.glsl"},
+                        .compile_options = {.defines = {daxa::ShaderDefine{
+                                                "RAYTRACE_TRACE"}}}},
+        .push_constant_size = sizeof(RaytraceTracePush),
+        .debug_name = "trace_pipeline",
+    });
+    if (result.is_err()) {
+      std::cerr << result.message() << std::endl;
+      return -1;
+    }
+    trace_pipeline = result.value();
+  }
+
   std::shared_ptr<daxa::ComputePipeline> queue_pipeline;
   {
     auto result = pipeline_manager.add_compute_pipeline({
@@ -392,6 +502,22 @@ int main() {
     brush_pipeline = result.value();
   }
 
+  std::shared_ptr<daxa::ComputePipeline> compressor_free_pipeline;
+  {
+    auto result = pipeline_manager.add_compute_pipeline({
+        .shader_info = {.source = daxa::ShaderFile{"compressor.glsl"},
+                        .compile_options = {.defines = {daxa::ShaderDefine{
+                                                "COMPRESSOR_FREE"}}}},
+        .push_constant_size = sizeof(CompressorPush),
+        .debug_name = "compressor_free_pipeline",
+    });
+    if (result.is_err()) {
+      std::cerr << result.message() << std::endl;
+      return -1;
+    }
+    compressor_free_pipeline = result.value();
+  }
+
   std::shared_ptr<daxa::ComputePipeline> compressor_palettize_pipeline;
   {
     auto result = pipeline_manager.add_compute_pipeline({
@@ -408,12 +534,21 @@ int main() {
     compressor_palettize_pipeline = result.value();
   }
 
+  // allocate and write have to agree on the palette index width
+  auto compressor_defines = [&](char const *pass) {
+    std::vector<daxa::ShaderDefine> defines = {daxa::ShaderDefine{pass}};
+    if (options.pow2_index_bits) {
+      defines.push_back(daxa::ShaderDefine{"PALETTE_INDEX_POW2"});
+    }
+    return defines;
+  };
+
   std::shared_ptr<daxa::ComputePipeline> compressor_allocate_pipeline;
   {
     auto result = pipeline_manager.add_compute_pipeline({
         .shader_info = {.source = daxa::ShaderFile{"compressor.glsl"},
-                        .compile_options = {.defines = {daxa::ShaderDefine{
-                                                "COMPRESSOR_ALLOCATE"}}}},
+                        .compile_options = {.defines = compressor_defines(
+                                                "COMPRESSOR_ALLOCATE")}},
         .push_constant_size = sizeof(CompressorPush),
         .debug_name = "compressor_allocate_pipeline",
     });
@@ -428,8 +563,8 @@ int main() {
   {
     auto result = pipeline_manager.add_compute_pipeline({
         .shader_info = {.source = daxa::ShaderFile{"compressor.glsl"},
-                        .compile_options = {.defines = {daxa::ShaderDefine{
-                                                "COMPRESSOR_WRITE"}}}},
+                        .compile_options = {.defines = compressor_defines(
+                                                "COMPRESSOR_WRITE")}},
         .push_constant_size = sizeof(CompressorPush),
         .debug_name = "compressor_write_pipeline",
     });
@@ -440,95 +575,347 @@ int main() {
     compressor_write_pipeline = result.value();
   }
 
+  std::shared_ptr<daxa::ComputePipeline> compressor_fused_pipeline;
+  if (options.fused_generation) {
+    auto result = pipeline_manager.add_compute_pipeline({
+        .shader_info = {.source = daxa::ShaderFile{"compressor.glsl"},
+                        .compile_options = {.defines = compressor_defines(
+                                                "COMPRESSOR_FUSED")}},
+        .push_constant_size = sizeof(CompressorPush),
+        .debug_name = "compressor_fused_pipeline",
+    });
+    if (result.is_err()) {
+      std::cerr << result.message() << std::endl;
+      return -1;
+    }
+    compressor_fused_pipeline = result.value();
+  }
+
+  std::shared_ptr<daxa::ComputePipeline> compact_pipeline;
+  {
+    auto result = pipeline_manager.add_compute_pipeline({
+        .shader_info = {.source = daxa::ShaderFile{"compact.glsl"}},
+        .push_constant_size = sizeof(CompactPush),
+        .debug_name = "compact_pipeline",
+    });
+    if (result.is_err()) {
+      std::cerr << result.message() << std::endl;
+      return -1;
+    }
+    compact_pipeline = result.value();
+  }
+
+  std::shared_ptr<daxa::ComputePipeline> edit_queue_pipeline;
+  {
+    auto result = pipeline_manager.add_compute_pipeline({
+        .shader_info = {.source = daxa::ShaderFile{"edit.glsl"},
+                        .compile_options = {.defines = {daxa::ShaderDefine{
+                                                "EDIT_QUEUE"}}}},
+        .push_constant_size = sizeof(EditPush),
+        .debug_name = "edit_queue_pipeline",
+    });
+    if (result.is_err()) {
+      std::cerr << result.message() << std::endl;
+      return -1;
+    }
+    edit_queue_pipeline = result.value();
+  }
+
+  std::shared_ptr<daxa::ComputePipeline> edit_apply_pipeline;
+  {
+    auto result = pipeline_manager.add_compute_pipeline({
+        .shader_info = {.source = daxa::ShaderFile{"edit.glsl"},
+                        .compile_options = {.defines = {daxa::ShaderDefine{
+                                                "EDIT_APPLY"}}}},
+        .push_constant_size = sizeof(EditPush),
+        .debug_name = "edit_apply_pipeline",
+    });
+    if (result.is_err()) {
+      std::cerr << result.message() << std::endl;
+      return -1;
+    }
+    edit_apply_pipeline = result.value();
+  }
+
+  // every per frame host to device write goes through here
+  auto upload_ring = UploadRing({.device = device});
+
   // TODO Create buffers
-  auto perframe_buffer = device.create_buffer({
+  auto perframe_buffer = benchmark_create_buffer(device, {
       .size = sizeof(Perframe),
       .debug_name = "perframe",
   });
 
-  auto volume_buffer = device.create_buffer({
+  auto volume_buffer = benchmark_create_buffer(device, {
       .size = sizeof(Volume),
       .debug_name = "volume",
   });
 
-  auto allocator_buffer = device.create_buffer({
+  auto allocator_buffer = benchmark_create_buffer(device, {
       .size = sizeof(Allocator),
       .debug_name = "allocator",
   });
 
-  auto heap_buffer = device.create_buffer({
+  auto heap_buffer = benchmark_create_buffer(device, {
       .size = GIGABYTE / 2,
       .debug_name = "heap",
   });
 
   auto heap_id = device.get_device_address(heap_buffer);
+  daxa_u32 heap_size = (GIGABYTE / 2) / sizeof(daxa_u32);
+
+  // Frames copy what the host reads back into the slot of the upload ring
+  // they were recorded in, and the host reads a slot once the frame in it is
+  // done, so nothing waits for the device in the frame loop.
+  daxa_u32 slot_count = upload_ring.info.frame_count;
+
+  // shader_malloc statistics, copied back at the end of every frame
+  auto allocator_readback_buffer = benchmark_create_buffer(device, {
+      .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+      .size = slot_count * sizeof(Allocator),
+      .debug_name = "allocator readback",
+  });
+
+  // Specs::visible_region_count, for time to first visible terrain,
+  // Specs::spec_count, to tell generating frames from idle ones, and
+  // UniSpecs::spec_count, for the cost of a uniformity region
+  auto specs_readback_buffer = benchmark_create_buffer(device, {
+      .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+      .size = slot_count * 3 * sizeof(daxa_u32),
+      .debug_name = "specs readback",
+  });
+  static_assert(offsetof(Specs, spec_count) ==
+                offsetof(Specs, visible_region_count) + sizeof(daxa_u32));
 
-  auto regions_buffer = device.create_buffer({
+  auto regions_buffer = benchmark_create_buffer(device, {
       .size = sizeof(Regions),
       .debug_name = "regions",
   });
 
-  auto regions_array_buffer = device.create_buffer({
-      .size = GIGABYTE / 2,
+  // one region per view cell after the void region
+  auto regions_array_buffer = benchmark_create_buffer(device, {
+      .size = sizeof(Region) * (VIEW_SIZE + 1),
       .debug_name = "regions_array",
   });
 
   auto regions_array_id = device.get_device_address(regions_array_buffer);
 
-  auto specs_buffer = device.create_buffer({
+  auto specs_buffer = benchmark_create_buffer(device, {
       .size = sizeof(Specs),
       .debug_name = "specs",
   });
 
-  auto unispecs_buffer = device.create_buffer({
+  auto dispatch_buffer = benchmark_create_buffer(device, {
+      .size = sizeof(QueueDispatch),
+      .debug_name = "dispatch",
+  });
+
+  auto unispecs_buffer = benchmark_create_buffer(device, {
       .size = sizeof(UniSpecs),
       .debug_name = "unispecs",
   });
 
-  auto raytrace_specs_buffer = device.create_buffer({
+  // the edits of a frame and the chunks and uniformity blocks they touch,
+  // kept apart from the queue's so both go through the compressor each frame
+  auto edits_buffer = benchmark_create_buffer(device, {
+      .size = sizeof(Edits),
+      .debug_name = "edits",
+  });
+
+  auto edit_specs_buffer = benchmark_create_buffer(device, {
+      .size = sizeof(Specs),
+      .debug_name = "edit_specs",
+  });
+
+  auto edit_unispecs_buffer = benchmark_create_buffer(device, {
+      .size = sizeof(UniSpecs),
+      .debug_name = "edit_unispecs",
+  });
+
+  auto edit_dispatch_buffer = benchmark_create_buffer(device, {
+      .size = sizeof(QueueDispatch),
+      .debug_name = "edit_dispatch",
+  });
+
+  auto raytrace_specs_buffer = benchmark_create_buffer(device, {
       .size = sizeof(RaytraceSpecs),
       .debug_name = "raytrace_pecs",
   });
 
-  auto write_indirect_buffer = device.create_buffer({
+  auto write_indirect_buffer = benchmark_create_buffer(device, {
       .size = sizeof(DrawIndirect),
       .debug_name = "write_indirect",
   });
 
-  auto indirect_buffer = device.create_buffer({
+  auto indirect_buffer = benchmark_create_buffer(device, {
       .size = sizeof(DrawIndirect),
       .debug_name = "indirect",
   });
 
+  // as deep as the largest budget of the run needs, so a fixed budget keeps
+  // the smallest workspace
+  daxa_u32 workspace_size = workspace_capacity(
+      options.generation_target_ms > 0 ? options.max_chunk_budget
+                                       : options.chunk_budget);
+  auto generation_budget = GenerationBudget({
+      .target_ms = options.generation_target_ms,
+      .initial_budget = options.chunk_budget,
+      .maximum_budget = workspace_size,
+  });
+
   auto workspace_image = device.create_image({
       .dimensions = 3,
       .format = daxa::Format::R32_UINT,
       .size = {AXIS_WORKSPACE_SIZE * AXIS_CHUNK_SIZE,
                AXIS_WORKSPACE_SIZE * AXIS_CHUNK_SIZE,
-               AXIS_WORKSPACE_SIZE * AXIS_CHUNK_SIZE},
+               workspace_size / WORKSPACE_LAYER_SIZE * AXIS_CHUNK_SIZE},
       .usage = daxa::ImageUsageFlagBits::SHADER_READ_WRITE |
                daxa::ImageUsageFlagBits::TRANSFER_DST,
       .debug_name = "workspace",
   });
 
+  // Allocator::heap and Regions::data never change after startup, so they
+  // are written once here instead of at the front of every frame. The free
+  // lists, statistics and compaction state, the view window and every
+  // Chunk::heap_offset start out as zeros, which create_buffer does not
+  // promise, so those buffers are cleared first.
+  {
+    auto init_task_list = daxa::TaskList({
+        .device = device,
+        .debug_name = "init task list",
+    });
+    auto init_benchmark = Benchmark({.device = device});
+
+    auto task_allocator_buffer = init_task_list.create_task_buffer(
+        {.debug_name = "init allocator buffer"});
+    init_task_list.add_runtime_buffer(task_allocator_buffer, allocator_buffer);
+
+    auto task_regions_buffer = init_task_list.create_task_buffer(
+        {.debug_name = "init regions buffer"});
+    init_task_list.add_runtime_buffer(task_regions_buffer, regions_buffer);
+
+    auto task_volume_buffer = init_task_list.create_task_buffer(
+        {.debug_name = "init volume buffer"});
+    init_task_list.add_runtime_buffer(task_volume_buffer, volume_buffer);
+
+    auto task_regions_array_buffer = init_task_list.create_task_buffer(
+        {.debug_name = "init regions array buffer"});
+    init_task_list.add_runtime_buffer(task_regions_array_buffer,
+                                      regions_array_buffer);
+
+    init_benchmark.add_task(init_task_list, {
+        .used_buffers = {{task_allocator_buffer,
+                          daxa::TaskBufferAccess::TRANSFER_WRITE},
+                         {task_volume_buffer,
+                          daxa::TaskBufferAccess::TRANSFER_WRITE},
+                         {task_regions_array_buffer,
+                          daxa::TaskBufferAccess::TRANSFER_WRITE}},
+        .task =
+            [task_allocator_buffer, task_volume_buffer,
+             task_regions_array_buffer](
+                daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              cmd_list.clear_buffer({
+                  .buffer = task_runtime.get_buffers(task_allocator_buffer)[0],
+                  .offset = 0,
+                  .size = sizeof(Allocator),
+                  .clear_value = 0,
+              });
+              cmd_list.clear_buffer({
+                  .buffer = task_runtime.get_buffers(task_volume_buffer)[0],
+                  .offset = 0,
+                  .size = sizeof(Volume),
+                  .clear_value = 0,
+              });
+              cmd_list.clear_buffer({
+                  .buffer =
+                      task_runtime.get_buffers(task_regions_array_buffer)[0],
+                  .offset = 0,
+                  .size = sizeof(Region) * (VIEW_SIZE + 1),
+                  .clear_value = 0,
+              });
+            },
+        .debug_name = "clear buffers task",
+    });
+
+    init_benchmark.add_task(init_task_list, {
+        .used_buffers = {{task_regions_buffer,
+                          daxa::TaskBufferAccess::TRANSFER_WRITE},
+                         {task_allocator_buffer,
+                          daxa::TaskBufferAccess::TRANSFER_WRITE}},
+        .task =
+            [task_regions_buffer, task_allocator_buffer, regions_array_id,
+             heap_id, heap_size,
+             &upload_ring](daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              upload_allocator_task(
+                  upload_ring, cmd_list,
+                  task_runtime.get_buffers(task_allocator_buffer)[0], heap_id,
+                  heap_size);
+              upload_regions_task(
+                  upload_ring, cmd_list,
+                  task_runtime.get_buffers(task_regions_buffer)[0],
+                  regions_array_id);
+            },
+        .debug_name = "upload allocator and regions task",
+    });
+
+    init_task_list.submit({});
+    init_task_list.complete({});
+    init_task_list.execute({});
+    device.wait_idle();
+    upload_ring.begin_frame();
+
+    if (options.dump_task_lists) {
+      std::cout << "init task list" << std::endl;
+      init_benchmark.write_task_list(std::cout);
+    }
+  }
+
   auto loop_task_list = daxa::TaskList({
       .device = device,
       .swapchain = swapchain,
       .debug_name = "my task list",
   });
 
-  daxa::Fsr2Context fsr2_context({.device = device});
+  std::optional<daxa::Fsr2Context> fsr2_context;
+  if (!options.headless) {
+    fsr2_context.emplace(daxa::Fsr2ContextInfo{.device = device});
 
-  fsr2_context.resize({
-      .render_size_x = window_info.width / PREPASS_SCALE,
-      .render_size_y = window_info.height / PREPASS_SCALE,
-      .display_size_x = window_info.width,
-      .display_size_y = window_info.height,
+    fsr2_context->resize({
+        .render_size_x = window_info.width / PREPASS_SCALE,
+        .render_size_y = window_info.height / PREPASS_SCALE,
+        .display_size_x = window_info.width,
+        .display_size_y = window_info.height,
+    });
+  }
+
+  auto benchmark = Benchmark({
+      .device = device,
+      .enabled = options.headless,
+      .warmup_frame_count = options.warmup_frame_count,
+      .output = options.output,
+      .slot_count = slot_count,
   });
 
+  // the number of frames the device is done with, the frame loop waits on it
+  // before it records into a slot of the upload ring again
+  auto frame_semaphore = device.create_timeline_semaphore({
+      .initial_value = 0,
+      .debug_name = "frame semaphore",
+  });
+  std::vector<std::pair<daxa::TimelineSemaphore, daxa::u64>> frame_signals = {
+      {frame_semaphore, 0},
+  };
+
+  // the draw target, display_image stands in for it when headless
   auto task_swapchain_image = loop_task_list.create_task_image(
-      {.swapchain_image = true, .debug_name = "my task swapchain image"});
-  auto swapchain_image = daxa::ImageId{};
+      {.swapchain_image = !options.headless,
+       .debug_name = "my task swapchain image"});
+  auto swapchain_image =
+      options.headless ? display_image : daxa::ImageId{};
   loop_task_list.add_runtime_image(task_swapchain_image, swapchain_image);
 
   auto task_color_image = loop_task_list.create_task_image(
@@ -559,24 +946,50 @@ int main() {
        .debug_name = "my task buffer"});
   loop_task_list.add_runtime_buffer(task_specs_buffer, specs_buffer);
 
+  auto task_dispatch_buffer = loop_task_list.create_task_buffer(
+      {.debug_name = "my task buffer"});
+  loop_task_list.add_runtime_buffer(task_dispatch_buffer, dispatch_buffer);
+
   auto task_unispecs_buffer = loop_task_list.create_task_buffer(
       {.initial_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
        .debug_name = "my task buffer"});
   loop_task_list.add_runtime_buffer(task_unispecs_buffer, unispecs_buffer);
 
+  auto task_edits_buffer = loop_task_list.create_task_buffer(
+      {.initial_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+       .debug_name = "my task buffer"});
+  loop_task_list.add_runtime_buffer(task_edits_buffer, edits_buffer);
+
+  auto task_edit_specs_buffer = loop_task_list.create_task_buffer(
+      {.initial_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+       .debug_name = "my task buffer"});
+  loop_task_list.add_runtime_buffer(task_edit_specs_buffer, edit_specs_buffer);
+
+  auto task_edit_unispecs_buffer = loop_task_list.create_task_buffer(
+      {.initial_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+       .debug_name = "my task buffer"});
+  loop_task_list.add_runtime_buffer(task_edit_unispecs_buffer,
+                                    edit_unispecs_buffer);
+
+  auto task_edit_dispatch_buffer = loop_task_list.create_task_buffer(
+      {.debug_name = "my task buffer"});
+  loop_task_list.add_runtime_buffer(task_edit_dispatch_buffer,
+                                    edit_dispatch_buffer);
+
   auto task_raytrace_specs_buffer = loop_task_list.create_task_buffer(
       {.initial_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
        .debug_name = "my task buffer"});
   loop_task_list.add_runtime_buffer(task_raytrace_specs_buffer,
                                     raytrace_specs_buffer);
 
+  // the init task list wrote these last
   auto task_allocator_buffer = loop_task_list.create_task_buffer(
-      {.initial_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+      {.initial_access = daxa::AccessConsts::TRANSFER_WRITE,
        .debug_name = "my task buffer"});
   loop_task_list.add_runtime_buffer(task_allocator_buffer, allocator_buffer);
 
   auto task_regions_buffer = loop_task_list.create_task_buffer(
-      {.initial_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+      {.initial_access = daxa::AccessConsts::TRANSFER_WRITE,
        .debug_name = "my task buffer"});
   loop_task_list.add_runtime_buffer(task_regions_buffer, regions_buffer);
 
@@ -600,402 +1013,777 @@ int main() {
   loop_task_list.add_runtime_image(task_depth_image, depth_image);
 
   Perframe perframe;
+  EditQueue edit_queue;
+  // the edits of the current frame and when each was pushed
+  Edits edits = {};
+  std::vector<EditQueue::Clock::time_point> edits_pushed_at;
+  // those of the frame before, which the current frame renders
+  std::vector<EditQueue::Clock::time_point> rendered_edits_pushed_at;
+
+  // the render and the queue both look through the camera, so perframe goes
+  // up first
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_perframe_buffer,
+                        daxa::TaskBufferAccess::TRANSFER_WRITE}},
+      .task =
+          [task_perframe_buffer, &perframe,
+           &upload_ring](daxa::TaskRuntimeInterface task_runtime) {
+            auto cmd_list = task_runtime.get_command_list();
 
-  loop_task_list.add_task({
-      .used_buffers = {{task_regions_buffer,
-                        daxa::TaskBufferAccess::TRANSFER_WRITE},
-                       {task_allocator_buffer,
+            upload_perframe_task(
+                upload_ring, cmd_list,
+                task_runtime.get_buffers(task_perframe_buffer)[0], perframe);
+          },
+      .debug_name = "upload perframe task",
+  });
+
+  // The render reads what the generation submissions of earlier frames
+  // published. It goes first by default, so present only waits for it and
+  // the queue and the passes after it prepare the next frame while this one
+  // is on screen, the task list orders the next render after them.
+  // --generate-before-render adds it after the generation instead.
+  auto add_render_tasks = [&]() {
+    if (!options.raster_regions) {
+      benchmark.add_task(loop_task_list, {
+          .used_buffers =
+              {{task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_volume_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_regions_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_allocator_buffer,
+                daxa::TaskBufferAccess::SHADER_READ_ONLY}},
+          .used_images = {{task_display_image,
+                           daxa::TaskImageAccess::SHADER_WRITE_ONLY,
+                           daxa::ImageMipArraySlice{}}},
+          .task =
+              [task_perframe_buffer, task_volume_buffer, task_regions_buffer,
+               task_allocator_buffer, task_display_image, &trace_pipeline,
+               &window_info,
+               &options](daxa::TaskRuntimeInterface task_runtime) {
+                auto cmd_list = task_runtime.get_command_list();
+
+                raytrace_trace_task(
+                    task_runtime.get_device(), cmd_list, trace_pipeline,
+                    task_runtime.get_buffers(task_volume_buffer)[0],
+                    task_runtime.get_buffers(task_regions_buffer)[0],
+                    task_runtime.get_buffers(task_perframe_buffer)[0],
+                    task_runtime.get_buffers(task_allocator_buffer)[0],
+                    task_runtime.get_images(task_display_image)[0],
+                    window_info.width / PREPASS_SCALE,
+                    window_info.height / PREPASS_SCALE,
+                    options.debug_steps ? RAYTRACE_DEBUG_STEPS
+                                        : RAYTRACE_DEBUG_NONE);
+              },
+          .debug_name = "raytrace trace task",
+      });
+
+      // headless runs read display_image directly
+      if (!options.headless) {
+        benchmark.add_task(loop_task_list, {
+            .used_images =
+                {{task_display_image, daxa::TaskImageAccess::TRANSFER_READ,
+                  daxa::ImageMipArraySlice{}},
+                 {task_swapchain_image, daxa::TaskImageAccess::TRANSFER_WRITE,
+                  daxa::ImageMipArraySlice{}}},
+            .task =
+                [task_display_image, task_swapchain_image,
+                 &window_info](daxa::TaskRuntimeInterface task_runtime) {
+                  auto cmd_list = task_runtime.get_command_list();
+
+                  std::array<daxa::Offset3D, 2> render_area = {
+                      daxa::Offset3D{0, 0, 0},
+                      daxa::Offset3D{
+                          static_cast<daxa_i32>(window_info.width /
+                                                PREPASS_SCALE),
+                          static_cast<daxa_i32>(window_info.height /
+                                                PREPASS_SCALE),
+                          1}};
+
+                  cmd_list.blit_image_to_image({
+                      .src_image =
+                          task_runtime.get_images(task_display_image)[0],
+                      .src_image_layout =
+                          daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+                      .dst_image =
+                          task_runtime.get_images(task_swapchain_image)[0],
+                      .dst_image_layout =
+                          daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+                      .src_slice = {.image_aspect =
+                                        daxa::ImageAspectFlagBits::COLOR},
+                      .src_offsets = render_area,
+                      .dst_slice = {.image_aspect =
+                                        daxa::ImageAspectFlagBits::COLOR},
+                      .dst_offsets = render_area,
+                  });
+                },
+            .debug_name = "blit trace to swapchain",
+        });
+      }
+    } else {
+      benchmark.add_task(loop_task_list, {
+          .used_buffers =
+              {
+                  {task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+                  {task_write_indirect_buffer,
+                   daxa::TaskBufferAccess::SHADER_WRITE_ONLY},
+                  {task_volume_buffer,
+                   daxa::TaskBufferAccess::SHADER_READ_ONLY},
+                  {task_regions_buffer,
+                   daxa::TaskBufferAccess::SHADER_READ_ONLY},
+                  {task_raytrace_specs_buffer,
+                   daxa::TaskBufferAccess::SHADER_READ_WRITE},
+              },
+          .task =
+              [task_write_indirect_buffer, task_regions_buffer,
+               task_perframe_buffer, task_volume_buffer, task_raytrace_specs_buffer,
+               &prepare_front_pipeline,
+               &window_info](daxa::TaskRuntimeInterface task_runtime) {
+                auto cmd_list = task_runtime.get_command_list();
+
+                raytrace_prepare_task(
+                    task_runtime.get_device(), cmd_list, prepare_front_pipeline,
+                    task_runtime.get_buffers(task_regions_buffer)[0],
+                    task_runtime.get_buffers(task_perframe_buffer)[0],
+                    task_runtime.get_buffers(task_volume_buffer)[0],
+                    task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
+                    task_runtime.get_buffers(task_write_indirect_buffer)[0]);
+              },
+          .debug_name = "raytrace prepare task",
+      });
+
+      benchmark.add_task(loop_task_list, {
+          .used_buffers = {{task_write_indirect_buffer,
+                            daxa::TaskBufferAccess::TRANSFER_READ},
+                           {task_indirect_buffer,
+                            daxa::TaskBufferAccess::TRANSFER_WRITE}},
+          .task =
+              [task_write_indirect_buffer, task_indirect_buffer,
+               &window_info](daxa::TaskRuntimeInterface task_runtime) {
+                auto cmd_list = task_runtime.get_command_list();
+
+                cmd_list.copy_buffer_to_buffer({
+                    .src_buffer =
+                        task_runtime.get_buffers(task_write_indirect_buffer)[0],
+                    .dst_buffer = task_runtime.get_buffers(task_indirect_buffer)[0],
+                    .size = sizeof(DrawIndirect),
+                });
+              },
+          .debug_name = "copy write_indirect to indirect",
+      });
+
+      benchmark.add_task(loop_task_list, {
+          .used_buffers =
+              {{task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_raytrace_specs_buffer,
+                daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_regions_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_allocator_buffer,
+                daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_indirect_buffer,
+                daxa::TaskBufferAccess::SHADER_READ_ONLY}},
+          .used_images =
+              {
+                  {task_swapchain_image,
+                   daxa::TaskImageAccess::COLOR_ATTACHMENT,
+                   daxa::ImageMipArraySlice{}},
+                  {task_depth_image,
+                   daxa::TaskImageAccess::DEPTH_ATTACHMENT,
+                   daxa::ImageMipArraySlice{.image_aspect = daxa::ImageAspectFlagBits::DEPTH}},
+              },
+          .task =
+              [task_swapchain_image, task_regions_buffer, task_perframe_buffer,
+               task_indirect_buffer, task_depth_image,
+               task_raytrace_specs_buffer, task_allocator_buffer,
+               &raytrace_front_pipeline,
+               &window_info](daxa::TaskRuntimeInterface task_runtime) {
+                auto cmd_list = task_runtime.get_command_list();
+
+                raytrace_draw_task(
+                    task_runtime.get_device(), cmd_list,
+                    raytrace_front_pipeline,
+                    daxa::AttachmentLoadOp::CLEAR,
+                    task_runtime.get_buffers(task_regions_buffer)[0],
+                    task_runtime.get_buffers(task_indirect_buffer)[0],
+                    task_runtime.get_buffers(task_perframe_buffer)[0],
+                    task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
+                    task_runtime.get_buffers(task_allocator_buffer)[0],
+                    task_runtime.get_images(task_swapchain_image)[0],
+                    task_runtime.get_images(task_depth_image)[0],
+                    window_info.width / PREPASS_SCALE,
+                    window_info.height / PREPASS_SCALE);
+              },
+          .debug_name = "raytrace draw task",
+      });
+      benchmark.add_task(loop_task_list, {
+          .used_buffers =
+              {
+                  {task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+                  {task_write_indirect_buffer,
+                   daxa::TaskBufferAccess::SHADER_WRITE_ONLY},
+                  {task_regions_buffer,
+                   daxa::TaskBufferAccess::SHADER_READ_ONLY},
+                  {task_volume_buffer,
+                   daxa::TaskBufferAccess::SHADER_READ_ONLY},
+                  {task_raytrace_specs_buffer,
+                   daxa::TaskBufferAccess::SHADER_READ_WRITE},
+              },
+          .task =
+              [task_write_indirect_buffer, task_regions_buffer,
+               task_perframe_buffer, task_volume_buffer, task_raytrace_specs_buffer,
+               &prepare_back_pipeline,
+               &window_info](daxa::TaskRuntimeInterface task_runtime) {
+                auto cmd_list = task_runtime.get_command_list();
+
+                raytrace_prepare_task(
+                    task_runtime.get_device(), cmd_list, prepare_back_pipeline,
+                    task_runtime.get_buffers(task_regions_buffer)[0],
+                    task_runtime.get_buffers(task_perframe_buffer)[0],
+                    task_runtime.get_buffers(task_volume_buffer)[0],
+                    task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
+                    task_runtime.get_buffers(task_write_indirect_buffer)[0]);
+              },
+          .debug_name = "raytrace prepare task (2nd)",
+      });
+
+      benchmark.add_task(loop_task_list, {
+          .used_buffers = {{task_write_indirect_buffer,
+                            daxa::TaskBufferAccess::TRANSFER_READ},
+                           {task_indirect_buffer,
+                            daxa::TaskBufferAccess::TRANSFER_WRITE}},
+          .task =
+              [task_write_indirect_buffer, task_indirect_buffer,
+               &window_info](daxa::TaskRuntimeInterface task_runtime) {
+                auto cmd_list = task_runtime.get_command_list();
+
+                cmd_list.copy_buffer_to_buffer({
+                    .src_buffer =
+                        task_runtime.get_buffers(task_write_indirect_buffer)[0],
+                    .dst_buffer = task_runtime.get_buffers(task_indirect_buffer)[0],
+                    .size = sizeof(DrawIndirect),
+                });
+              },
+          .debug_name = "copy write_indirect to indirect (2nd)",
+      });
+
+      benchmark.add_task(loop_task_list, {
+          .used_buffers =
+              {{task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_raytrace_specs_buffer,
+                daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_regions_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_allocator_buffer,
+                daxa::TaskBufferAccess::SHADER_READ_ONLY},
+               {task_indirect_buffer,
+                daxa::TaskBufferAccess::SHADER_READ_ONLY}},
+          .used_images =
+              {
+                  {task_swapchain_image,
+                   daxa::TaskImageAccess::COLOR_ATTACHMENT,
+                   daxa::ImageMipArraySlice{}},
+                  {task_depth_image,
+                   daxa::TaskImageAccess::DEPTH_ATTACHMENT,
+                   daxa::ImageMipArraySlice{.image_aspect = daxa::ImageAspectFlagBits::DEPTH}},
+              },
+          .task =
+              [task_swapchain_image, task_regions_buffer, task_perframe_buffer,
+               task_indirect_buffer, task_depth_image,
+               task_raytrace_specs_buffer, task_allocator_buffer,
+               &raytrace_back_pipeline,
+               &window_info](daxa::TaskRuntimeInterface task_runtime) {
+                auto cmd_list = task_runtime.get_command_list();
+
+                raytrace_draw_task(
+                    task_runtime.get_device(), cmd_list, raytrace_back_pipeline,
+                    daxa::AttachmentLoadOp::LOAD,
+                    task_runtime.get_buffers(task_regions_buffer)[0],
+                    task_runtime.get_buffers(task_indirect_buffer)[0],
+                    task_runtime.get_buffers(task_perframe_buffer)[0],
+                    task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
+                    task_runtime.get_buffers(task_allocator_buffer)[0],
+                    task_runtime.get_images(task_swapchain_image)[0],
+                    task_runtime.get_images(task_depth_image)[0],
+                    window_info.width / PREPASS_SCALE,
+                    window_info.height / PREPASS_SCALE);
+              },
+          .debug_name = "raytrace draw (2nd)",
+      });
+    }
+  };
+
+  if (!options.generate_before_render) {
+    add_render_tasks();
+    loop_task_list.submit({});
+    if (!options.headless) {
+      loop_task_list.present({});
+    }
+    benchmark.mark_present();
+  }
+
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_edits_buffer,
                         daxa::TaskBufferAccess::TRANSFER_WRITE}},
       .task =
-          [task_regions_buffer, task_allocator_buffer, regions_array_id,
-           heap_id](daxa::TaskRuntimeInterface task_runtime) {
+          [task_edits_buffer, &edits,
+           &upload_ring](daxa::TaskRuntimeInterface task_runtime) {
             auto cmd_list = task_runtime.get_command_list();
 
-            upload_allocator_task(
-                task_runtime.get_device(), cmd_list,
-                task_runtime.get_buffers(task_allocator_buffer)[0], heap_id);
-            upload_regions_task(
-                task_runtime.get_device(), cmd_list,
-                task_runtime.get_buffers(task_regions_buffer)[0],
-                regions_array_id);
+            upload_edits_task(upload_ring, cmd_list,
+                              task_runtime.get_buffers(task_edits_buffer)[0],
+                              edits);
           },
-      .debug_name = "upload allocator and regions task",
+      .debug_name = "upload edits task",
   });
 
-  loop_task_list.add_task({
-      .used_buffers = {{task_volume_buffer,
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_perframe_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_volume_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
                        {task_regions_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                       {task_allocator_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
                        {task_specs_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_WRITE_ONLY},
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
                        {task_unispecs_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                       {task_dispatch_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE}},
       .task =
-          [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
-           task_specs_buffer, task_workspace_image, task_unispecs_buffer,
-           &queue_pipeline](daxa::TaskRuntimeInterface task_runtime) {
+          [task_perframe_buffer, task_volume_buffer, task_regions_buffer,
+           task_allocator_buffer, task_specs_buffer, task_workspace_image,
+           task_unispecs_buffer, task_dispatch_buffer, &queue_pipeline,
+           &options,
+           &generation_budget](daxa::TaskRuntimeInterface task_runtime) {
             auto cmd_list = task_runtime.get_command_list();
 
             queue_task(task_runtime.get_device(), cmd_list, queue_pipeline,
+                       task_runtime.get_buffers(task_perframe_buffer)[0],
                        task_runtime.get_buffers(task_regions_buffer)[0],
                        task_runtime.get_buffers(task_volume_buffer)[0],
                        task_runtime.get_buffers(task_allocator_buffer)[0],
                        task_runtime.get_buffers(task_specs_buffer)[0],
-                       task_runtime.get_buffers(task_unispecs_buffer)[0]);
+                       task_runtime.get_buffers(task_unispecs_buffer)[0],
+                       task_runtime.get_buffers(task_dispatch_buffer)[0],
+                       generation_budget.chunk_budget, options.streaming);
           },
       .debug_name = "queue task",
   });
 
-  loop_task_list.add_task({
-      .used_images =
-          {
-              {task_workspace_image, daxa::TaskImageAccess::TRANSFER_WRITE,
-               daxa::ImageMipArraySlice{}},
-          },
-      .task =
-          [task_workspace_image](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            clear_workspace_task(
-                task_runtime.get_device(), cmd_list,
-                task_runtime.get_images(task_workspace_image)[0]);
-          },
-      .debug_name = "clear workspace task",
+  // the generation tasks run between the two timestamps, written once the
+  // queue is done and once the compressor is. Every frame has its own pair
+  // of queries and its own Specs::spec_count word, in the slot of the upload
+  // ring, so the budget is fed from one finished frame at a time.
+  auto generation_query_pool = device.create_timeline_query_pool({
+      .query_count = 2 * slot_count,
+      .debug_name = "generation query pool",
   });
 
-  loop_task_list.add_task({
-      .used_buffers = {{task_specs_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY}},
-      .used_images =
-          {
-              {task_workspace_image,
-               daxa::TaskImageAccess::COMPUTE_SHADER_READ_WRITE,
-               daxa::ImageMipArraySlice{}},
-          },
-      .task =
-          [task_volume_buffer, task_allocator_buffer, task_specs_buffer,
-           task_workspace_image,
-           &brush_pipeline](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            brush_task(task_runtime.get_device(), cmd_list, brush_pipeline,
-                       task_runtime.get_buffers(task_volume_buffer)[0],
-                       task_runtime.get_buffers(task_allocator_buffer)[0],
-                       task_runtime.get_buffers(task_specs_buffer)[0],
-                       task_runtime.get_images(task_workspace_image)[0]);
-          },
-      .debug_name = "brush task",
+  auto generation_readback_buffer = benchmark_create_buffer(device, {
+      .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+      .size = slot_count * sizeof(daxa_u32),
+      .debug_name = "generation readback",
   });
 
-  loop_task_list.add_task({
-      .used_buffers = {{task_volume_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
-                       {task_regions_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
-                       {task_specs_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY}},
-      .used_images =
-          {
-              {task_workspace_image,
-               daxa::TaskImageAccess::COMPUTE_SHADER_READ_ONLY,
-               daxa::ImageMipArraySlice{}},
-          },
+  benchmark.add_task(loop_task_list, {
       .task =
-          [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
-           task_specs_buffer, task_workspace_image,
-           &compressor_palettize_pipeline](
-              daxa::TaskRuntimeInterface task_runtime) {
+          [generation_query_pool,
+           &upload_ring](daxa::TaskRuntimeInterface task_runtime) {
             auto cmd_list = task_runtime.get_command_list();
 
-            compressor_palettize_task(
-                task_runtime.get_device(), cmd_list,
-                compressor_palettize_pipeline,
-                task_runtime.get_buffers(task_regions_buffer)[0],
-                task_runtime.get_buffers(task_volume_buffer)[0],
-                task_runtime.get_buffers(task_allocator_buffer)[0],
-                task_runtime.get_buffers(task_specs_buffer)[0],
-                task_runtime.get_images(task_workspace_image)[0]);
+            cmd_list.reset_timestamps({
+                .query_pool = generation_query_pool,
+                .start_index = 2 * upload_ring.frame_index,
+                .count = 2,
+            });
+            cmd_list.write_timestamp({
+                .query_pool = generation_query_pool,
+                .pipeline_stage = daxa::PipelineStageFlagBits::BOTTOM_OF_PIPE,
+                .query_index = 2 * upload_ring.frame_index,
+            });
           },
-      .debug_name = "compressor palettize task",
+      .debug_name = "generation begin timestamp task",
   });
 
-  loop_task_list.add_task({
-      .used_buffers = {{task_volume_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
-                       {task_regions_buffer,
+  if (!options.fused_generation) {
+    benchmark.add_task(loop_task_list, {
+        .used_buffers = {{task_specs_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_dispatch_buffer,
+                          daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
+        .used_images =
+            {
+                {task_workspace_image,
+                 daxa::TaskImageAccess::COMPUTE_SHADER_READ_WRITE,
+                 daxa::ImageMipArraySlice{}},
+            },
+        .task =
+            [task_specs_buffer, task_dispatch_buffer, task_workspace_image,
+             &brush_pipeline](daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              brush_task(task_runtime.get_device(), cmd_list, brush_pipeline,
+                         task_runtime.get_buffers(task_specs_buffer)[0],
+                         task_runtime.get_buffers(task_dispatch_buffer)[0],
+                         task_runtime.get_images(task_workspace_image)[0]);
+            },
+        .debug_name = "brush task",
+    });
+  }
+
+  // shader_free and shader_malloc never run in the same dispatch, see
+  // shader_malloc.inl, so the free pass stays on its own in front of both the
+  // regular compressor passes and the fused one
+  auto add_compressor_free_task = [&](auto task_specs_buffer,
+                                      auto task_dispatch_buffer,
+                                      std::string const &prefix) {
+    benchmark.add_task(loop_task_list, {
+        .used_buffers = {{task_volume_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_regions_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_allocator_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_specs_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_dispatch_buffer,
+                          daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
+        .task =
+            [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
+             task_specs_buffer, task_dispatch_buffer, task_workspace_image,
+             &compressor_free_pipeline](
+                daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              compressor_free_task(
+                  task_runtime.get_device(), cmd_list, compressor_free_pipeline,
+                  task_runtime.get_buffers(task_regions_buffer)[0],
+                  task_runtime.get_buffers(task_volume_buffer)[0],
+                  task_runtime.get_buffers(task_allocator_buffer)[0],
+                  task_runtime.get_buffers(task_specs_buffer)[0],
+                  task_runtime.get_buffers(task_dispatch_buffer)[0],
+                  task_runtime.get_images(task_workspace_image)[0]);
+            },
+        .debug_name = prefix + "compressor free task",
+    });
+  };
+
+  // the queued chunks and the edited ones go through the same passes, each
+  // with its own specs and dispatch
+  auto add_compressor_tasks = [&](auto task_specs_buffer,
+                                  auto task_dispatch_buffer,
+                                  std::string const &prefix) {
+    add_compressor_free_task(task_specs_buffer, task_dispatch_buffer, prefix);
+
+    benchmark.add_task(loop_task_list, {
+        .used_buffers = {{task_volume_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_regions_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_specs_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_dispatch_buffer,
+                          daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
+        .used_images =
+            {
+                {task_workspace_image,
+                 daxa::TaskImageAccess::COMPUTE_SHADER_READ_ONLY,
+                 daxa::ImageMipArraySlice{}},
+            },
+        .task =
+            [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
+             task_specs_buffer, task_dispatch_buffer, task_workspace_image,
+             &compressor_palettize_pipeline](
+                daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              compressor_palettize_task(
+                  task_runtime.get_device(), cmd_list,
+                  compressor_palettize_pipeline,
+                  task_runtime.get_buffers(task_regions_buffer)[0],
+                  task_runtime.get_buffers(task_volume_buffer)[0],
+                  task_runtime.get_buffers(task_allocator_buffer)[0],
+                  task_runtime.get_buffers(task_specs_buffer)[0],
+                  task_runtime.get_buffers(task_dispatch_buffer)[0],
+                  task_runtime.get_images(task_workspace_image)[0]);
+            },
+        .debug_name = prefix + "compressor palettize task",
+    });
+
+    benchmark.add_task(loop_task_list, {
+        .used_buffers = {{task_volume_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_regions_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_allocator_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_specs_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_dispatch_buffer,
+                          daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
+        .used_images =
+            {
+                {task_workspace_image,
+                 daxa::TaskImageAccess::COMPUTE_SHADER_READ_ONLY,
+                 daxa::ImageMipArraySlice{}},
+            },
+        .task =
+            [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
+             task_specs_buffer, task_dispatch_buffer, task_workspace_image,
+             &compressor_allocate_pipeline](
+                daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              compressor_allocate_task(
+                  task_runtime.get_device(), cmd_list,
+                  compressor_allocate_pipeline,
+                  task_runtime.get_buffers(task_regions_buffer)[0],
+                  task_runtime.get_buffers(task_volume_buffer)[0],
+                  task_runtime.get_buffers(task_allocator_buffer)[0],
+                  task_runtime.get_buffers(task_specs_buffer)[0],
+                  task_runtime.get_buffers(task_dispatch_buffer)[0],
+                  task_runtime.get_images(task_workspace_image)[0]);
+            },
+        .debug_name = prefix + "compressor allocate task (part 2)",
+    });
+    benchmark.add_task(loop_task_list, {
+        .used_buffers = {{task_volume_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_regions_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_allocator_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_specs_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_dispatch_buffer,
+                          daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
+        .used_images =
+            {
+                {task_workspace_image,
+                 daxa::TaskImageAccess::COMPUTE_SHADER_READ_ONLY,
+                 daxa::ImageMipArraySlice{}},
+            },
+        .task =
+            [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
+             task_specs_buffer, task_dispatch_buffer, task_workspace_image,
+             &compressor_write_pipeline](
+                daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              compressor_write_task(
+                  task_runtime.get_device(), cmd_list,
+                  compressor_write_pipeline,
+                  task_runtime.get_buffers(task_regions_buffer)[0],
+                  task_runtime.get_buffers(task_volume_buffer)[0],
+                  task_runtime.get_buffers(task_allocator_buffer)[0],
+                  task_runtime.get_buffers(task_specs_buffer)[0],
+                  task_runtime.get_buffers(task_dispatch_buffer)[0],
+                  task_runtime.get_images(task_workspace_image)[0]);
+            },
+        .debug_name = prefix + "compressor write task (part 3)",
+    });
+  };
+
+  if (options.fused_generation) {
+    add_compressor_free_task(task_specs_buffer, task_dispatch_buffer, "");
+
+    // one dispatch after the free, the workspace image is left to the edits
+    benchmark.add_task(loop_task_list, {
+        .used_buffers = {{task_volume_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_regions_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_allocator_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                         {task_specs_buffer,
+                          daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                         {task_dispatch_buffer,
+                          daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
+        .task =
+            [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
+             task_specs_buffer, task_dispatch_buffer,
+             &compressor_fused_pipeline](
+                daxa::TaskRuntimeInterface task_runtime) {
+              auto cmd_list = task_runtime.get_command_list();
+
+              compressor_fused_task(
+                  task_runtime.get_device(), cmd_list,
+                  compressor_fused_pipeline,
+                  task_runtime.get_buffers(task_regions_buffer)[0],
+                  task_runtime.get_buffers(task_volume_buffer)[0],
+                  task_runtime.get_buffers(task_allocator_buffer)[0],
+                  task_runtime.get_buffers(task_specs_buffer)[0],
+                  task_runtime.get_buffers(task_dispatch_buffer)[0]);
+            },
+        .debug_name = "compressor fused task",
+    });
+  } else {
+    add_compressor_tasks(task_specs_buffer, task_dispatch_buffer, "");
+  }
+
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_specs_buffer,
+                        daxa::TaskBufferAccess::TRANSFER_READ}},
+      .task =
+          [task_specs_buffer, generation_query_pool, generation_readback_buffer,
+           &upload_ring](daxa::TaskRuntimeInterface task_runtime) {
+            auto cmd_list = task_runtime.get_command_list();
+
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = task_runtime.get_buffers(task_specs_buffer)[0],
+                .src_offset = offsetof(Specs, spec_count),
+                .dst_buffer = generation_readback_buffer,
+                .dst_offset = upload_ring.frame_index * sizeof(daxa_u32),
+                .size = sizeof(daxa_u32),
+            });
+            cmd_list.write_timestamp({
+                .query_pool = generation_query_pool,
+                .pipeline_stage = daxa::PipelineStageFlagBits::BOTTOM_OF_PIPE,
+                .query_index = 2 * upload_ring.frame_index + 1,
+            });
+          },
+      .debug_name = "generation end timestamp task",
+  });
+
+  // edits apply to chunks that are compressed by now, including the ones
+  // written above
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_edits_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_volume_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_regions_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_edit_specs_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
-                       {task_allocator_buffer,
+                       {task_edit_unispecs_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
-                       {task_specs_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY}},
-      .used_images =
-          {
-              {task_workspace_image,
-               daxa::TaskImageAccess::COMPUTE_SHADER_READ_ONLY,
-               daxa::ImageMipArraySlice{}},
-          },
+                       {task_edit_dispatch_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE}},
       .task =
-          [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
-           task_specs_buffer, task_workspace_image,
-           &compressor_allocate_pipeline](
-              daxa::TaskRuntimeInterface task_runtime) {
+          [task_edits_buffer, task_volume_buffer, task_regions_buffer,
+           task_edit_specs_buffer, task_edit_unispecs_buffer,
+           task_edit_dispatch_buffer,
+           &edit_queue_pipeline](daxa::TaskRuntimeInterface task_runtime) {
             auto cmd_list = task_runtime.get_command_list();
 
-            compressor_allocate_task(
-                task_runtime.get_device(), cmd_list,
-                compressor_allocate_pipeline,
-                task_runtime.get_buffers(task_regions_buffer)[0],
+            edit_queue_task(
+                task_runtime.get_device(), cmd_list, edit_queue_pipeline,
+                task_runtime.get_buffers(task_edits_buffer)[0],
                 task_runtime.get_buffers(task_volume_buffer)[0],
-                task_runtime.get_buffers(task_allocator_buffer)[0],
-                task_runtime.get_buffers(task_specs_buffer)[0],
-                task_runtime.get_images(task_workspace_image)[0]);
+                task_runtime.get_buffers(task_regions_buffer)[0],
+                task_runtime.get_buffers(task_edit_specs_buffer)[0],
+                task_runtime.get_buffers(task_edit_unispecs_buffer)[0],
+                task_runtime.get_buffers(task_edit_dispatch_buffer)[0]);
           },
-      .debug_name = "compressor allocate task (part 2)",
+      .debug_name = "edit queue task",
   });
-  loop_task_list.add_task({
-      .used_buffers = {{task_volume_buffer,
+
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_edits_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_volume_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
                        {task_regions_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
                        {task_allocator_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_WRITE_ONLY},
-                       {task_specs_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY}},
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_edit_specs_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_edit_dispatch_buffer,
+                        daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
       .used_images =
           {
               {task_workspace_image,
-               daxa::TaskImageAccess::COMPUTE_SHADER_READ_ONLY,
+               daxa::TaskImageAccess::COMPUTE_SHADER_WRITE_ONLY,
                daxa::ImageMipArraySlice{}},
           },
       .task =
-          [task_volume_buffer, task_regions_buffer, task_allocator_buffer,
-           task_specs_buffer, task_workspace_image, &compressor_write_pipeline](
-              daxa::TaskRuntimeInterface task_runtime) {
+          [task_edits_buffer, task_volume_buffer, task_regions_buffer,
+           task_allocator_buffer, task_edit_specs_buffer,
+           task_edit_dispatch_buffer, task_workspace_image,
+           &edit_apply_pipeline](daxa::TaskRuntimeInterface task_runtime) {
             auto cmd_list = task_runtime.get_command_list();
 
-            compressor_write_task(
-                task_runtime.get_device(), cmd_list, compressor_write_pipeline,
-                task_runtime.get_buffers(task_regions_buffer)[0],
+            edit_apply_task(
+                task_runtime.get_device(), cmd_list, edit_apply_pipeline,
+                task_runtime.get_buffers(task_edits_buffer)[0],
                 task_runtime.get_buffers(task_volume_buffer)[0],
+                task_runtime.get_buffers(task_regions_buffer)[0],
                 task_runtime.get_buffers(task_allocator_buffer)[0],
-                task_runtime.get_buffers(task_specs_buffer)[0],
+                task_runtime.get_buffers(task_edit_specs_buffer)[0],
+                task_runtime.get_buffers(task_edit_dispatch_buffer)[0],
                 task_runtime.get_images(task_workspace_image)[0]);
           },
-      .debug_name = "compressor write task (part 3)",
+      .debug_name = "edit apply task",
   });
-  loop_task_list.add_task({
+
+  add_compressor_tasks(task_edit_specs_buffer, task_edit_dispatch_buffer,
+                       "edit ");
+  // one bounded compaction slice per frame, a no-op until the heap fragments
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_regions_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                       {task_allocator_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE}},
+      .task =
+          [task_regions_buffer, task_allocator_buffer,
+           &compact_pipeline](daxa::TaskRuntimeInterface task_runtime) {
+            auto cmd_list = task_runtime.get_command_list();
+
+            compact_task(task_runtime.get_device(), cmd_list, compact_pipeline,
+                         task_runtime.get_buffers(task_regions_buffer)[0],
+                         task_runtime.get_buffers(task_allocator_buffer)[0]);
+          },
+      .debug_name = "compact heap task",
+  });
+  benchmark.add_task(loop_task_list, {
       .used_buffers = {{task_unispecs_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
                        {task_regions_buffer,
                         daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
                        {task_allocator_buffer,
-                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY}},
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_dispatch_buffer,
+                        daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
       .task =
           [task_unispecs_buffer, task_regions_buffer, task_allocator_buffer,
-           task_specs_buffer, task_workspace_image,
-           uniformity_pipelines](daxa::TaskRuntimeInterface task_runtime) {
+           task_dispatch_buffer,
+           &uniformity_pipeline](daxa::TaskRuntimeInterface task_runtime) {
             auto cmd_list = task_runtime.get_command_list();
 
             uniformity_task(task_runtime.get_device(), cmd_list,
-                            &*uniformity_pipelines,
+                            uniformity_pipeline,
                             task_runtime.get_buffers(task_regions_buffer)[0],
                             task_runtime.get_buffers(task_unispecs_buffer)[0],
                             task_runtime.get_buffers(task_allocator_buffer)[0],
-                            task_runtime.get_buffers(task_specs_buffer)[0],
-                            task_runtime.get_images(task_workspace_image)[0]);
+                            task_runtime.get_buffers(task_dispatch_buffer)[0]);
           },
       .debug_name = "uniformity task",
   });
-
-  loop_task_list.add_task({
-      .used_buffers = {{task_perframe_buffer,
-                        daxa::TaskBufferAccess::TRANSFER_WRITE}},
-      .task =
-          [task_perframe_buffer,
-           &perframe](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            upload_perframe_task(
-                task_runtime.get_device(), cmd_list,
-                task_runtime.get_buffers(task_perframe_buffer)[0], perframe);
-          },
-      .debug_name = "upload perframe task",
-  });
-
-  loop_task_list.add_task({
-      .used_buffers =
-          {
-              {task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-              {task_write_indirect_buffer,
-               daxa::TaskBufferAccess::SHADER_WRITE_ONLY},
-              {task_volume_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-              {task_regions_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-              {task_raytrace_specs_buffer,
-               daxa::TaskBufferAccess::SHADER_READ_WRITE},
-          },
-      .task =
-          [task_write_indirect_buffer, task_regions_buffer,
-           task_perframe_buffer, task_volume_buffer, task_raytrace_specs_buffer,
-           &prepare_front_pipeline,
-           &window_info](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            raytrace_prepare_task(
-                task_runtime.get_device(), cmd_list, prepare_front_pipeline,
-                task_runtime.get_buffers(task_regions_buffer)[0],
-                task_runtime.get_buffers(task_perframe_buffer)[0],
-                task_runtime.get_buffers(task_volume_buffer)[0],
-                task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
-                task_runtime.get_buffers(task_write_indirect_buffer)[0]);
-          },
-      .debug_name = "raytrace prepare task",
-  });
-
-  loop_task_list.add_task({
-      .used_buffers = {{task_write_indirect_buffer,
-                        daxa::TaskBufferAccess::TRANSFER_READ},
-                       {task_indirect_buffer,
-                        daxa::TaskBufferAccess::TRANSFER_WRITE}},
-      .task =
-          [task_write_indirect_buffer, task_indirect_buffer,
-           &window_info](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            cmd_list.copy_buffer_to_buffer({
-                .src_buffer =
-                    task_runtime.get_buffers(task_write_indirect_buffer)[0],
-                .dst_buffer = task_runtime.get_buffers(task_indirect_buffer)[0],
-                .size = sizeof(DrawIndirect),
-            });
-          },
-      .debug_name = "copy write_indirect to indirect",
-  });
-
-  loop_task_list.add_task({
-      .used_buffers =
-          {{task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_raytrace_specs_buffer,
-            daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_regions_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_allocator_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_indirect_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY}},
-      .used_images =
-          {
-              {task_swapchain_image, daxa::TaskImageAccess::COLOR_ATTACHMENT,
-               daxa::ImageMipArraySlice{}},
-              {task_depth_image,
-               daxa::TaskImageAccess::DEPTH_ATTACHMENT,
-               daxa::ImageMipArraySlice{.image_aspect = daxa::ImageAspectFlagBits::DEPTH}},
-          },
-      .task =
-          [task_swapchain_image, task_regions_buffer, task_perframe_buffer,
-           task_indirect_buffer, task_depth_image, task_raytrace_specs_buffer,
-           task_allocator_buffer, &raytrace_front_pipeline,
-           &window_info](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            raytrace_draw_task(
-                task_runtime.get_device(), cmd_list, raytrace_front_pipeline,
-                daxa::AttachmentLoadOp::CLEAR,
-                task_runtime.get_buffers(task_regions_buffer)[0],
-                task_runtime.get_buffers(task_indirect_buffer)[0],
-                task_runtime.get_buffers(task_perframe_buffer)[0],
-                task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
-                task_runtime.get_buffers(task_allocator_buffer)[0],
-                task_runtime.get_images(task_swapchain_image)[0],
-                task_runtime.get_images(task_depth_image)[0],
-                window_info.width / PREPASS_SCALE,
-                window_info.height / PREPASS_SCALE);
-          },
-      .debug_name = "raytrace draw task",
-  });
-  loop_task_list.add_task({
-      .used_buffers =
-          {
-              {task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-              {task_write_indirect_buffer,
-               daxa::TaskBufferAccess::SHADER_WRITE_ONLY},
-              {task_regions_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-              {task_volume_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-              {task_raytrace_specs_buffer,
-               daxa::TaskBufferAccess::SHADER_READ_WRITE},
-          },
-      .task =
-          [task_write_indirect_buffer, task_regions_buffer,
-           task_perframe_buffer, task_volume_buffer, task_raytrace_specs_buffer,
-           &prepare_back_pipeline,
-           &window_info](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            raytrace_prepare_task(
-                task_runtime.get_device(), cmd_list, prepare_back_pipeline,
-                task_runtime.get_buffers(task_regions_buffer)[0],
-                task_runtime.get_buffers(task_perframe_buffer)[0],
-                task_runtime.get_buffers(task_volume_buffer)[0],
-                task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
-                task_runtime.get_buffers(task_write_indirect_buffer)[0]);
-          },
-      .debug_name = "raytrace prepare task (2nd)",
-  });
-
-  loop_task_list.add_task({
-      .used_buffers = {{task_write_indirect_buffer,
-                        daxa::TaskBufferAccess::TRANSFER_READ},
-                       {task_indirect_buffer,
-                        daxa::TaskBufferAccess::TRANSFER_WRITE}},
-      .task =
-          [task_write_indirect_buffer, task_indirect_buffer,
-           &window_info](daxa::TaskRuntimeInterface task_runtime) {
-            auto cmd_list = task_runtime.get_command_list();
-
-            cmd_list.copy_buffer_to_buffer({
-                .src_buffer =
-                    task_runtime.get_buffers(task_write_indirect_buffer)[0],
-                .dst_buffer = task_runtime.get_buffers(task_indirect_buffer)[0],
-                .size = sizeof(DrawIndirect),
-            });
-          },
-      .debug_name = "copy write_indirect to indirect (2nd)",
-  });
-
-  loop_task_list.add_task({
-      .used_buffers =
-          {{task_perframe_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_raytrace_specs_buffer,
-            daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_regions_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_allocator_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY},
-           {task_indirect_buffer, daxa::TaskBufferAccess::SHADER_READ_ONLY}},
-      .used_images =
-          {
-              {task_swapchain_image, daxa::TaskImageAccess::COLOR_ATTACHMENT,
-               daxa::ImageMipArraySlice{}},
-              {task_depth_image,
-               daxa::TaskImageAccess::DEPTH_ATTACHMENT,
-               daxa::ImageMipArraySlice{.image_aspect = daxa::ImageAspectFlagBits::DEPTH}},
-          },
+  // only the blocks around the edited chunks
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_edit_unispecs_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_regions_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_WRITE},
+                       {task_allocator_buffer,
+                        daxa::TaskBufferAccess::COMPUTE_SHADER_READ_ONLY},
+                       {task_edit_dispatch_buffer,
+                        daxa::TaskBufferAccess::DRAW_INDIRECT_INFO_READ}},
       .task =
-          [task_swapchain_image, task_regions_buffer, task_perframe_buffer,
-           task_indirect_buffer, task_depth_image, task_raytrace_specs_buffer,
-           task_allocator_buffer, &raytrace_back_pipeline,
-           &window_info](daxa::TaskRuntimeInterface task_runtime) {
+          [task_edit_unispecs_buffer, task_regions_buffer,
+           task_allocator_buffer, task_edit_dispatch_buffer,
+           &uniformity_pipeline](daxa::TaskRuntimeInterface task_runtime) {
             auto cmd_list = task_runtime.get_command_list();
 
-            raytrace_draw_task(
-                task_runtime.get_device(), cmd_list, raytrace_back_pipeline,
-                daxa::AttachmentLoadOp::LOAD,
+            uniformity_task(
+                task_runtime.get_device(), cmd_list, uniformity_pipeline,
                 task_runtime.get_buffers(task_regions_buffer)[0],
-                task_runtime.get_buffers(task_indirect_buffer)[0],
-                task_runtime.get_buffers(task_perframe_buffer)[0],
-                task_runtime.get_buffers(task_raytrace_specs_buffer)[0],
+                task_runtime.get_buffers(task_edit_unispecs_buffer)[0],
                 task_runtime.get_buffers(task_allocator_buffer)[0],
-                task_runtime.get_images(task_swapchain_image)[0],
-                task_runtime.get_images(task_depth_image)[0],
-                window_info.width / PREPASS_SCALE,
-                window_info.height / PREPASS_SCALE);
+                task_runtime.get_buffers(task_edit_dispatch_buffer)[0]);
           },
-      .debug_name = "raytrace draw (2nd)",
+      .debug_name = "edit uniformity task",
   });
 
   daxa_f32 delta_time = 0.0;
@@ -1078,10 +1866,74 @@ int main() {
         .debug_name = "Blit Task (display to swapchain)",
     });*/
 
-  loop_task_list.submit({});
-  loop_task_list.present({});
+  if (options.generate_before_render) {
+    add_render_tasks();
+  }
+
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_allocator_buffer,
+                        daxa::TaskBufferAccess::TRANSFER_READ}},
+      .task =
+          [task_allocator_buffer, allocator_readback_buffer,
+           &upload_ring](daxa::TaskRuntimeInterface task_runtime) {
+            auto cmd_list = task_runtime.get_command_list();
+
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = task_runtime.get_buffers(task_allocator_buffer)[0],
+                .dst_buffer = allocator_readback_buffer,
+                .dst_offset = upload_ring.frame_index * sizeof(Allocator),
+                .size = sizeof(Allocator),
+            });
+          },
+      .debug_name = "readback allocator task",
+  });
+
+  benchmark.add_task(loop_task_list, {
+      .used_buffers = {{task_specs_buffer,
+                        daxa::TaskBufferAccess::TRANSFER_READ},
+                       {task_unispecs_buffer,
+                        daxa::TaskBufferAccess::TRANSFER_READ}},
+      .task =
+          [task_specs_buffer, task_unispecs_buffer, specs_readback_buffer,
+           &upload_ring](daxa::TaskRuntimeInterface task_runtime) {
+            auto cmd_list = task_runtime.get_command_list();
+            daxa_u32 dst_offset =
+                upload_ring.frame_index * 3 * sizeof(daxa_u32);
+
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = task_runtime.get_buffers(task_specs_buffer)[0],
+                .src_offset = offsetof(Specs, visible_region_count),
+                .dst_buffer = specs_readback_buffer,
+                .dst_offset = dst_offset,
+                .size = 2 * sizeof(daxa_u32),
+            });
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = task_runtime.get_buffers(task_unispecs_buffer)[0],
+                .src_offset = offsetof(UniSpecs, spec_count),
+                .dst_buffer = specs_readback_buffer,
+                .dst_offset = dst_offset + 2 * sizeof(daxa_u32),
+                .size = sizeof(daxa_u32),
+            });
+          },
+      .debug_name = "readback specs task",
+  });
+
+  // signals the frame done, see frame_semaphore
+  loop_task_list.submit(
+      {.additional_signal_timeline_semaphores = &frame_signals});
+  if (options.generate_before_render) {
+    if (!options.headless) {
+      loop_task_list.present({});
+    }
+    benchmark.mark_present();
+  }
   loop_task_list.complete({});
 
+  if (options.dump_task_lists) {
+    std::cout << "loop task list" << std::endl;
+    benchmark.write_task_list(std::cout);
+  }
+
   glm::vec3 translation = glm::vec3(0.0, 0.0, 3);
   glm::vec2 rotation = glm::vec2(0.0);
 
@@ -1091,75 +1943,155 @@ int main() {
 
   daxa_u32 cpu_framecount = 0;
 
-  while (true) {
-    std::cout << "frame" << std::endl;
-    std::chrono::milliseconds current_tick =
-        duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch());
-
-    delta_time = daxa_f32((current_tick - last_tick).count()) / 1000;
+  auto stream_start = std::chrono::steady_clock::now();
+  bool terrain_visible = false;
+  bool edit_key_held = false;
+
+  // what the host reads back of a frame once the device is done with it
+  struct FrameInFlight {
+    daxa_u32 slot;
+    daxa_u32 chunk_budget;
+    std::vector<EditQueue::Clock::time_point> rendered_edits_pushed_at;
+  };
+  // oldest first
+  std::deque<FrameInFlight> frames_in_flight;
+  daxa_u64 finished_frame_count = 0;
+
+  // reads back every frame up to frame_count in the order they were recorded,
+  // the device must be done with them
+  auto finish_frames = [&](daxa_u64 frame_count) {
+    while (finished_frame_count < frame_count) {
+      auto const &frame = frames_in_flight.front();
+
+      // pairs of (timestamp, availability)
+      auto results =
+          generation_query_pool.get_query_results(2 * frame.slot, 2);
+      if (results[1] != 0 && results[3] != 0 && results[2] >= results[0]) {
+        daxa_f32 generation_ms =
+            daxa_f32(results[2] - results[0]) *
+            device.properties().limits.timestamp_period / 1e6f;
+        generation_budget.record(
+            generation_ms, device.get_host_address_as<daxa_u32>(
+                               generation_readback_buffer)[frame.slot]);
+      }
 
-    last_tick = current_tick;
+      auto const &allocator = device.get_host_address_as<Allocator>(
+          allocator_readback_buffer)[frame.slot];
+      auto specs_readback =
+          device.get_host_address_as<daxa_u32>(specs_readback_buffer) +
+          3 * frame.slot;
+
+      benchmark.end_frame(frame.slot);
+      benchmark.record_heap(allocator);
+      benchmark.record_specs(specs_readback[0], specs_readback[1],
+                             specs_readback[2]);
+      benchmark.record_budget(frame.chunk_budget);
+      benchmark.record_edits(frame.rendered_edits_pushed_at);
+
+      if (!options.headless && finished_frame_count % 600 == 0) {
+        std::cout << heap_summary(allocator) << std::endl;
+      }
 
-    if (delta_time == 0) {
-      continue;
-    }
+      if (!options.headless && !terrain_visible && specs_readback[0] != 0) {
+        terrain_visible = true;
+        std::cout << "first visible terrain after "
+                  << std::chrono::duration<daxa_f32, std::milli>(
+                         std::chrono::steady_clock::now() - stream_start)
+                         .count()
+                  << " ms (frame " << finished_frame_count << ")"
+                  << std::endl;
+      }
 
-    glfwPollEvents();
-    if (glfwWindowShouldClose(glfw_window_ptr)) {
-      break;
+      frames_in_flight.pop_front();
+      finished_frame_count++;
     }
+  };
 
-    { jitter = fsr2_context.get_jitter(cpu_framecount); }
-    {
-      if (glfwGetKey(glfw_window_ptr, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        locked = false;
-        glfwSetInputMode(glfw_window_ptr, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+  while (true) {
+    if (options.headless) {
+      if (cpu_framecount >= options.frame_count) {
+        break;
       }
 
-      daxa_f32 sensitivity = 2e-3;
+      // fixed time step and scripted camera so runs are comparable
+      delta_time = 1.0f / 60.0f;
 
-      rotation.x -= sensitivity * daxa_f32(x_move);
-      rotation.y -= sensitivity * daxa_f32(y_move);
-      rotation.y = std::clamp(rotation.y, daxa_f32(0.0), daxa_f32(2.0 * M_PI));
-      x_move = 0;
-      y_move = 0;
-    }
+      auto camera_path_point =
+          benchmark_camera_path(cpu_framecount, options.frame_count);
+      translation = glm::vec3(camera_path_point.translation.x,
+                              camera_path_point.translation.y,
+                              camera_path_point.translation.z);
+      rotation = glm::vec2(camera_path_point.rotation.x,
+                           camera_path_point.rotation.y);
+    } else {
+      std::chrono::milliseconds current_tick =
+          duration_cast<std::chrono::milliseconds>(
+              std::chrono::system_clock::now().time_since_epoch());
 
-    {
-      bool forward = false, backward = false, left = false, right = false,
-           up = false, down = false;
-
-      if (locked) {
-        forward = glfwGetKey(glfw_window_ptr, GLFW_KEY_W) == GLFW_PRESS;
-        backward = glfwGetKey(glfw_window_ptr, GLFW_KEY_S) == GLFW_PRESS;
-        left = glfwGetKey(glfw_window_ptr, GLFW_KEY_A) == GLFW_PRESS;
-        right = glfwGetKey(glfw_window_ptr, GLFW_KEY_D) == GLFW_PRESS;
-        up = glfwGetKey(glfw_window_ptr, GLFW_KEY_SPACE) == GLFW_PRESS;
-        down = glfwGetKey(glfw_window_ptr, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+      delta_time = daxa_f32((current_tick - last_tick).count()) / 1000;
+
+      last_tick = current_tick;
+
+      if (delta_time == 0) {
+        continue;
       }
 
-      glm::vec3 direction = glm::vec3(daxa_f32(right) - daxa_f32(left),
-                                      daxa_f32(forward) - daxa_f32(backward),
-                                      daxa_f32(up) - daxa_f32(down));
+      glfwPollEvents();
+      if (glfwWindowShouldClose(glfw_window_ptr)) {
+        break;
+      }
 
-      glm::mat4 swivel =
-          glm::rotate(glm::mat4(1.0), rotation.x, glm::vec3(0.0f, 0.0f, 1.0f));
+      { jitter = fsr2_context->get_jitter(cpu_framecount); }
+      {
+        if (glfwGetKey(glfw_window_ptr, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+          locked = false;
+          glfwSetInputMode(glfw_window_ptr, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        }
 
-      glm::vec3 movement =
-          (swivel * glm::vec4(direction.x, direction.y, 0.0, 0.0)).xyz;
+        daxa_f32 sensitivity = 2e-3;
 
-      if (glm::length(movement) != 0) {
-        movement = glm::normalize(movement);
+        rotation.x -= sensitivity * daxa_f32(x_move);
+        rotation.y -= sensitivity * daxa_f32(y_move);
+        rotation.y = std::clamp(rotation.y, daxa_f32(0.0), daxa_f32(2.0 * M_PI));
+        x_move = 0;
+        y_move = 0;
       }
 
-      movement.z = direction.z;
+      {
+        bool forward = false, backward = false, left = false, right = false,
+             up = false, down = false;
+
+        if (locked) {
+          forward = glfwGetKey(glfw_window_ptr, GLFW_KEY_W) == GLFW_PRESS;
+          backward = glfwGetKey(glfw_window_ptr, GLFW_KEY_S) == GLFW_PRESS;
+          left = glfwGetKey(glfw_window_ptr, GLFW_KEY_A) == GLFW_PRESS;
+          right = glfwGetKey(glfw_window_ptr, GLFW_KEY_D) == GLFW_PRESS;
+          up = glfwGetKey(glfw_window_ptr, GLFW_KEY_SPACE) == GLFW_PRESS;
+          down = glfwGetKey(glfw_window_ptr, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+        }
+
+        glm::vec3 direction = glm::vec3(daxa_f32(right) - daxa_f32(left),
+                                        daxa_f32(forward) - daxa_f32(backward),
+                                        daxa_f32(up) - daxa_f32(down));
+
+        glm::mat4 swivel =
+            glm::rotate(glm::mat4(1.0), rotation.x, glm::vec3(0.0f, 0.0f, 1.0f));
 
-      daxa_f32 speed = 1.0;
+        glm::vec3 movement =
+            (swivel * glm::vec4(direction.x, direction.y, 0.0, 0.0)).xyz;
 
-      movement *= speed * delta_time;
+        if (glm::length(movement) != 0) {
+          movement = glm::normalize(movement);
+        }
+
+        movement.z = direction.z;
+
+        daxa_f32 speed = 1.0;
 
-      translation += movement;
+        movement *= speed * delta_time;
+
+        translation += movement;
+      }
     }
 
     {
@@ -1196,6 +2128,22 @@ int main() {
               std::span<daxa_f32, 16>{glm::value_ptr(view), 16}),
           .transform = daxa::math_operators::mat_from_span<daxa_f32, 4, 4>(
               std::span<daxa_f32, 16>{glm::value_ptr(transform), 16})};
+
+      // rows of the view projection combine into the clip planes, with
+      // depth in [0, 1] the near plane is the z row alone
+      glm::mat4 view_projection = glm::transpose(projection * view);
+      glm::vec4 frustum_planes[FRUSTUM_PLANE_COUNT] = {
+          view_projection[3] + view_projection[0],
+          view_projection[3] - view_projection[0],
+          view_projection[3] + view_projection[1],
+          view_projection[3] - view_projection[1],
+          view_projection[2],
+      };
+      for (daxa_u32 i = 0; i < FRUSTUM_PLANE_COUNT; i++) {
+        perframe.camera.frustum_planes[i] = {
+            frustum_planes[i].x, frustum_planes[i].y, frustum_planes[i].z,
+            frustum_planes[i].w};
+      }
     }
 
     if (window_info.swapchain_out_of_date) {
@@ -1228,8 +2176,8 @@ int main() {
           .debug_name = "display_image",
       });
       loop_task_list.add_runtime_image(task_display_image, display_image);
-      swapchain.resize();
-      fsr2_context.resize({
+      swapchain->resize();
+      fsr2_context->resize({
           .render_size_x = window_info.width / PREPASS_SCALE,
           .render_size_y = window_info.height / PREPASS_SCALE,
           .display_size_x = window_info.width,
@@ -1238,25 +2186,91 @@ int main() {
       window_info.swapchain_out_of_date = false;
     }
 
-    loop_task_list.remove_runtime_image(task_swapchain_image, swapchain_image);
+    if (!options.headless) {
+      loop_task_list.remove_runtime_image(task_swapchain_image,
+                                          swapchain_image);
 
-    swapchain_image = swapchain.acquire_next_image();
+      swapchain_image = swapchain->acquire_next_image();
 
-    loop_task_list.add_runtime_image(task_swapchain_image, swapchain_image);
-    if (swapchain_image.is_empty()) {
-      continue;
+      loop_task_list.add_runtime_image(task_swapchain_image, swapchain_image);
+      if (swapchain_image.is_empty()) {
+        continue;
+      }
     }
 
+    // E carves a sphere a region ahead of the camera, --edit-interval does
+    // the same on a schedule for benchmark runs
+    {
+      bool edit_key = !options.headless && locked &&
+                      glfwGetKey(glfw_window_ptr, GLFW_KEY_E) == GLFW_PRESS;
+      bool scheduled = options.edit_interval != 0 &&
+                       cpu_framecount % options.edit_interval == 0;
+
+      if ((edit_key && !edit_key_held) || scheduled) {
+        glm::mat4 orientation = glm::rotate(glm::mat4(1.0f), rotation.x,
+                                            glm::vec3(0.0f, 0.0f, 1.0f));
+        orientation =
+            glm::rotate(orientation, rotation.y, glm::vec3(1.0f, 0.0f, 0.0f));
+        glm::vec3 forward =
+            (orientation * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)).xyz;
+        glm::vec3 center = (translation + forward) *
+                           daxa_f32(AXIS_REGION_SIZE * AXIS_CHUNK_SIZE);
+
+        edit_queue.sphere({daxa_i32(center.x), daxa_i32(center.y),
+                           daxa_i32(center.z)},
+                          AXIS_CHUNK_SIZE, BLOCK_ID_AIR);
+      }
+
+      edit_key_held = edit_key;
+    }
+
+    edit_queue.take_frame(edits, edits_pushed_at);
+
+    // the slot of the upload ring this frame records into was last used
+    // slot_count frames ago, so that frame has to be done, and every frame
+    // done by now is read back
+    if (cpu_framecount >= slot_count) {
+      frame_semaphore.wait_for_value(cpu_framecount - slot_count + 1);
+    }
+    finish_frames(frame_semaphore.value());
+
+    upload_ring.begin_frame();
+    benchmark.begin_frame(upload_ring.frame_index);
+    // the render only shows the edits of this frame when it comes after the
+    // generation
+    frames_in_flight.push_back({
+        .slot = upload_ring.frame_index,
+        .chunk_budget = generation_budget.chunk_budget,
+        .rendered_edits_pushed_at = options.generate_before_render
+                                        ? edits_pushed_at
+                                        : rendered_edits_pushed_at,
+    });
+    frame_signals[0].second = cpu_framecount + 1;
+
     loop_task_list.execute({});
+    benchmark.end_frame_submit();
+
+    rendered_edits_pushed_at = edits_pushed_at;
 
     cpu_framecount++;
   }
 
   device.wait_idle();
+  finish_frames(cpu_framecount);
+  benchmark.finish();
+  benchmark.write_report();
   device.destroy_buffer(perframe_buffer);
   device.destroy_buffer(volume_buffer);
   device.destroy_buffer(specs_buffer);
+  device.destroy_buffer(dispatch_buffer);
+  device.destroy_buffer(edits_buffer);
+  device.destroy_buffer(edit_specs_buffer);
+  device.destroy_buffer(edit_unispecs_buffer);
+  device.destroy_buffer(edit_dispatch_buffer);
   device.destroy_buffer(allocator_buffer);
+  device.destroy_buffer(allocator_readback_buffer);
+  device.destroy_buffer(specs_readback_buffer);
+  device.destroy_buffer(generation_readback_buffer);
   device.destroy_buffer(write_indirect_buffer);
   device.destroy_buffer(indirect_buffer);
   device.destroy_image(workspace_image);
@@ -1264,6 +2278,68 @@ int main() {
   device.collect_garbage();
 }
 
+Options parse_options(int argc, char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) {
+        std::cerr << "missing value for " << arg << std::endl;
+        std::exit(-1);
+      }
+      return argv[++i];
+    };
+
+    if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg == "--frames") {
+      options.frame_count = std::stoul(value());
+    } else if (arg == "--warmup") {
+      options.warmup_frame_count = std::stoul(value());
+    } else if (arg == "--output") {
+      options.output = value();
+    } else if (arg == "--pow2-indices") {
+      options.pow2_index_bits = true;
+    } else if (arg == "--chunk-budget") {
+      options.chunk_budget = std::stoul(value());
+    } else if (arg == "--generation-target-ms") {
+      options.generation_target_ms = std::stof(value());
+    } else if (arg == "--max-chunk-budget") {
+      options.max_chunk_budget = std::stoul(value());
+    } else if (arg == "--no-streaming") {
+      options.streaming = false;
+    } else if (arg == "--region-hash") {
+      options.region_hash = true;
+    } else if (arg == "--uniformity-traversal") {
+      options.uniformity_traversal = true;
+    } else if (arg == "--raster-regions") {
+      options.raster_regions = true;
+    } else if (arg == "--debug-steps") {
+      options.debug_steps = true;
+    } else if (arg == "--dump-task-lists") {
+      options.dump_task_lists = true;
+    } else if (arg == "--edit-interval") {
+      options.edit_interval = std::stoul(value());
+    } else if (arg == "--fused-generation") {
+      options.fused_generation = true;
+    } else if (arg == "--generate-before-render") {
+      options.generate_before_render = true;
+    } else {
+      std::cerr << "usage: hexane [--headless] [--frames N] [--warmup N] "
+                   "[--output PATH] [--pow2-indices] [--chunk-budget N] "
+                   "[--generation-target-ms MS] [--max-chunk-budget N] "
+                   "[--no-streaming] [--region-hash] "
+                   "[--uniformity-traversal] [--raster-regions] "
+                   "[--debug-steps] [--dump-task-lists] "
+                   "[--edit-interval N] [--fused-generation] "
+                   "[--generate-before-render]"
+                << std::endl;
+      std::exit(-1);
+    }
+  }
+  return options;
+}
+
 void create_images(daxa::Device &device, daxa::u32 width, daxa::u32 height,
                    daxa::ImageId &color_image, daxa::ImageId &depth_image,
                    daxa::ImageId &motion_vectors_image) {
@@ -1346,122 +2422,172 @@ void raytrace_draw_task(
   cmd_list.end_renderpass();
 }
 
-void upload_allocator_task(daxa::Device &device, daxa::CommandList &cmd_list,
-                           daxa::BufferId buffer_id,
-                           daxa::BufferDeviceAddress heap_id) {
-  auto staging_buffer_id = device.create_buffer({
-      .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-      .size = sizeof(daxa::BufferDeviceAddress),
-      .debug_name = "my staging buffer",
+void raytrace_trace_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &trace_pipeline,
+    daxa::BufferId volume_id, daxa::BufferId regions_id,
+    daxa::BufferId perframe_id, daxa::BufferId allocator_id,
+    daxa::ImageId render_image, daxa::u32 width, daxa::u32 height,
+    daxa_u32 debug_view) {
+
+  cmd_list.set_pipeline(*trace_pipeline);
+  cmd_list.push_constant(RaytraceTracePush{
+      .volume = device.get_device_address(volume_id),
+      .regions = device.get_device_address(regions_id),
+      .perframe = device.get_device_address(perframe_id),
+      .allocator = device.get_device_address(allocator_id),
+      .render = render_image,
+      .resolution = {width, height},
+      .debug_view = debug_view,
   });
+  cmd_list.dispatch((width + 7) / 8, (height + 7) / 8, 1);
+}
 
-  cmd_list.destroy_buffer_deferred(staging_buffer_id);
-
-  auto *buffer_ptr =
-      device.get_host_address_as<daxa::BufferDeviceAddress>(staging_buffer_id);
-  *buffer_ptr = heap_id;
-
-  cmd_list.copy_buffer_to_buffer({.src_buffer = staging_buffer_id,
-                                  .dst_buffer = buffer_id,
-                                  .dst_offset = offsetof(Allocator, heap),
-                                  .size = sizeof(daxa::BufferDeviceAddress)});
+void upload_allocator_task(UploadRing &upload_ring,
+                           daxa::CommandList &cmd_list,
+                           daxa::BufferId buffer_id,
+                           daxa::BufferDeviceAddress heap_id,
+                           daxa_u32 heap_size) {
+  upload_ring.upload(cmd_list, heap_id, buffer_id, offsetof(Allocator, heap));
+  upload_ring.upload(cmd_list, heap_size, buffer_id,
+                     offsetof(Allocator, heap_size));
 }
 
-void upload_regions_task(daxa::Device &device, daxa::CommandList &cmd_list,
+void upload_regions_task(UploadRing &upload_ring, daxa::CommandList &cmd_list,
                          daxa::BufferId buffer_id,
                          daxa::BufferDeviceAddress regions_id) {
-  auto staging_buffer_id = device.create_buffer({
-      .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-      .size = sizeof(daxa::BufferDeviceAddress),
-      .debug_name = "my staging buffer",
-  });
-
-  cmd_list.destroy_buffer_deferred(staging_buffer_id);
-
-  auto *buffer_ptr =
-      device.get_host_address_as<daxa::BufferDeviceAddress>(staging_buffer_id);
-  *buffer_ptr = regions_id;
-
-  cmd_list.copy_buffer_to_buffer({.src_buffer = staging_buffer_id,
-                                  .dst_buffer = buffer_id,
-                                  .dst_offset = offsetof(Regions, data),
-                                  .size = sizeof(daxa::BufferDeviceAddress)});
+  upload_ring.upload(cmd_list, regions_id, buffer_id, offsetof(Regions, data));
 }
 
-void upload_perframe_task(daxa::Device &device, daxa::CommandList &cmd_list,
-                          daxa::BufferId buffer_id, Perframe perframe) {
-  auto staging_buffer_id = device.create_buffer({
-      .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-      .size = sizeof(Perframe),
-      .debug_name = "my staging buffer",
-  });
-
-  cmd_list.destroy_buffer_deferred(staging_buffer_id);
+void upload_perframe_task(UploadRing &upload_ring, daxa::CommandList &cmd_list,
+                          daxa::BufferId buffer_id, Perframe const &perframe) {
+  upload_ring.upload(cmd_list, perframe, buffer_id);
+}
 
-  auto *buffer_ptr = device.get_host_address_as<Perframe>(staging_buffer_id);
-  *buffer_ptr = perframe;
+void upload_edits_task(UploadRing &upload_ring, daxa::CommandList &cmd_list,
+                       daxa::BufferId buffer_id, Edits const &edits) {
+  // the count and the edits in use, EDIT_QUEUE reads no further
+  upload_ring.upload(cmd_list, &edits,
+                     static_cast<daxa_u32>(offsetof(Edits, edit) +
+                                           edits.edit_count * sizeof(Edit)),
+                     buffer_id);
+}
 
-  cmd_list.copy_buffer_to_buffer({
-      .src_buffer = staging_buffer_id,
-      .dst_buffer = buffer_id,
-      .size = sizeof(Perframe),
+void edit_queue_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &edit_queue_pipeline,
+    daxa::BufferId edits_id, daxa::BufferId volume_id,
+    daxa::BufferId regions_id, daxa::BufferId specs_id,
+    daxa::BufferId unispecs_id, daxa::BufferId dispatch_id) {
+  cmd_list.set_pipeline(*edit_queue_pipeline);
+  cmd_list.push_constant(EditPush{
+      .edits = device.get_device_address(edits_id),
+      .volume = device.get_device_address(volume_id),
+      .regions = device.get_device_address(regions_id),
+      .specs = device.get_device_address(specs_id),
+      .unispecs = device.get_device_address(unispecs_id),
+      .dispatch = device.get_device_address(dispatch_id),
   });
+  cmd_list.dispatch(1, 1, 1);
 }
 
-void clear_workspace_task(daxa::Device &device, daxa::CommandList &cmd_list,
-                          daxa::ImageId workspace_id) {
-  cmd_list.clear_image({.clear_value = std::array<daxa_u32, 4>({0, 0, 0, 0}),
-                        .dst_image = workspace_id});
+void edit_apply_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &edit_apply_pipeline,
+    daxa::BufferId edits_id, daxa::BufferId volume_id,
+    daxa::BufferId regions_id, daxa::BufferId allocator_id,
+    daxa::BufferId specs_id, daxa::BufferId dispatch_id,
+    daxa::ImageId workspace_id) {
+  cmd_list.set_pipeline(*edit_apply_pipeline);
+  cmd_list.push_constant(EditPush{
+      .workspace = workspace_id,
+      .edits = device.get_device_address(edits_id),
+      .volume = device.get_device_address(volume_id),
+      .regions = device.get_device_address(regions_id),
+      .allocator = device.get_device_address(allocator_id),
+      .specs = device.get_device_address(specs_id),
+  });
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, generation)});
 }
 
 void queue_task(daxa::Device &device, daxa::CommandList &cmd_list,
                 std::shared_ptr<daxa::ComputePipeline> &queue_pipeline,
-                daxa::BufferId regions_id, daxa::BufferId volume_id,
-                daxa::BufferId allocator_id, daxa::BufferId specs_id,
-                daxa::BufferId unispecs_id) {
+                daxa::BufferId perframe_id, daxa::BufferId regions_id,
+                daxa::BufferId volume_id, daxa::BufferId allocator_id,
+                daxa::BufferId specs_id, daxa::BufferId unispecs_id,
+                daxa::BufferId dispatch_id, daxa_u32 chunk_budget,
+                bool streaming) {
   cmd_list.set_pipeline(*queue_pipeline);
   cmd_list.push_constant(QueuePush{
+      .perframe = device.get_device_address(perframe_id),
       .volume = device.get_device_address(volume_id),
       .regions = device.get_device_address(regions_id),
+      .allocator = device.get_device_address(allocator_id),
       .specs = device.get_device_address(specs_id),
       .unispecs = device.get_device_address(unispecs_id),
+      .dispatch = device.get_device_address(dispatch_id),
+      .chunk_budget = std::min(chunk_budget, daxa_u32(WORKSPACE_SIZE)),
+      .streaming = streaming,
   });
   cmd_list.dispatch(1, 1, 1);
 }
 
 void brush_task(daxa::Device &device, daxa::CommandList &cmd_list,
                 std::shared_ptr<daxa::ComputePipeline> &brush_pipeline,
-                daxa::BufferId volume_id, daxa::BufferId allocator_id,
-                daxa::BufferId specs_id, daxa::ImageId workspace_id) {
+                daxa::BufferId specs_id, daxa::BufferId dispatch_id,
+                daxa::ImageId workspace_id) {
 
   cmd_list.set_pipeline(*brush_pipeline);
   cmd_list.push_constant(BrushPush{
       .workspace = workspace_id,
       .specs = device.get_device_address(specs_id),
   });
-  cmd_list.dispatch(AXIS_WORKSPACE_SIZE, AXIS_WORKSPACE_SIZE,
-                    AXIS_WORKSPACE_SIZE);
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, generation)});
 }
 
 void uniformity_task(
     daxa::Device &device, daxa::CommandList &cmd_list,
-    const std::shared_ptr<daxa::ComputePipeline> *uniformity_pipelines,
+    std::shared_ptr<daxa::ComputePipeline> &uniformity_pipeline,
     daxa::BufferId regions_id, daxa::BufferId unispecs_id,
+    daxa::BufferId allocator_id, daxa::BufferId dispatch_id) {
+  // one workgroup per UNIFORMITY_BLOCK_SIZE block of every region the queue
+  // handed over, none once they are all done
+  cmd_list.set_pipeline(*uniformity_pipeline);
+  cmd_list.push_constant(
+      UniformityPush{.unispecs = device.get_device_address(unispecs_id),
+                     .regions = device.get_device_address(regions_id),
+                     .allocator = device.get_device_address(allocator_id)});
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, uniformity)});
+}
+
+void compressor_free_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &compressor_free_pipeline,
+    daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id) {
-  for (daxa_u32 i = 0; i < 5; i++) {
-    daxa_u32 uniformity_invoke_size =
-        std::clamp(daxa_u32(pow(2, i + 1)), daxa_u32(2), daxa_u32(8));
-    cmd_list.set_pipeline(*uniformity_pipelines[i]);
-    cmd_list.push_constant(
-        UniformityPush{.unispecs = device.get_device_address(unispecs_id),
-                       .regions = device.get_device_address(regions_id),
-                       .allocator = device.get_device_address(allocator_id)});
-    cmd_list.dispatch(
-        AXIS_REGION_SIZE * AXIS_CHUNK_SIZE / uniformity_invoke_size,
-        AXIS_REGION_SIZE * AXIS_CHUNK_SIZE / uniformity_invoke_size,
-        AXIS_REGION_SIZE * AXIS_CHUNK_SIZE / uniformity_invoke_size);
-  }
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id) {
+  cmd_list.set_pipeline(*compressor_free_pipeline);
+  cmd_list.push_constant(
+      CompressorPush{.workspace = workspace_id,
+                     .specs = device.get_device_address(specs_id),
+                     .volume = device.get_device_address(volume_id),
+                     .regions = device.get_device_address(regions_id),
+                     .allocator = device.get_device_address(allocator_id)});
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, generation)});
+}
+
+void compact_task(daxa::Device &device, daxa::CommandList &cmd_list,
+                  std::shared_ptr<daxa::ComputePipeline> &compact_pipeline,
+                  daxa::BufferId regions_id, daxa::BufferId allocator_id) {
+  cmd_list.set_pipeline(*compact_pipeline);
+  cmd_list.push_constant(CompactPush{
+      .regions = device.get_device_address(regions_id),
+      .allocator = device.get_device_address(allocator_id)});
+  cmd_list.dispatch(1, 1, 1);
 }
 
 void compressor_palettize_task(
@@ -1469,7 +2595,7 @@ void compressor_palettize_task(
     std::shared_ptr<daxa::ComputePipeline> &compressor_palettize_pipeline,
     daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id) {
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id) {
   cmd_list.set_pipeline(*compressor_palettize_pipeline);
   cmd_list.push_constant(
       CompressorPush{.workspace = workspace_id,
@@ -1477,8 +2603,8 @@ void compressor_palettize_task(
                      .volume = device.get_device_address(volume_id),
                      .regions = device.get_device_address(regions_id),
                      .allocator = device.get_device_address(allocator_id)});
-  cmd_list.dispatch(AXIS_WORKSPACE_SIZE, AXIS_WORKSPACE_SIZE,
-                    AXIS_WORKSPACE_SIZE);
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, generation)});
 }
 
 void compressor_allocate_task(
@@ -1486,7 +2612,7 @@ void compressor_allocate_task(
     std::shared_ptr<daxa::ComputePipeline> &compressor_allocate_pipeline,
     daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id) {
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id) {
 
   cmd_list.set_pipeline(*compressor_allocate_pipeline);
   cmd_list.push_constant(
@@ -1495,8 +2621,8 @@ void compressor_allocate_task(
                      .volume = device.get_device_address(volume_id),
                      .regions = device.get_device_address(regions_id),
                      .allocator = device.get_device_address(allocator_id)});
-  cmd_list.dispatch(AXIS_WORKSPACE_SIZE, AXIS_WORKSPACE_SIZE,
-                    AXIS_WORKSPACE_SIZE);
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, generation)});
 }
 
 void compressor_write_task(
@@ -1504,7 +2630,7 @@ void compressor_write_task(
     std::shared_ptr<daxa::ComputePipeline> &compressor_write_pipeline,
     daxa::BufferId regions_id, daxa::BufferId volume_id,
     daxa::BufferId allocator_id, daxa::BufferId specs_id,
-    daxa::ImageId workspace_id) {
+    daxa::BufferId dispatch_id, daxa::ImageId workspace_id) {
   cmd_list.set_pipeline(*compressor_write_pipeline);
   cmd_list.push_constant(
       CompressorPush{.workspace = workspace_id,
@@ -1512,6 +2638,24 @@ void compressor_write_task(
                      .volume = device.get_device_address(volume_id),
                      .regions = device.get_device_address(regions_id),
                      .allocator = device.get_device_address(allocator_id)});
-  cmd_list.dispatch(AXIS_WORKSPACE_SIZE, AXIS_WORKSPACE_SIZE,
-                    AXIS_WORKSPACE_SIZE);
-}
\ No newline at end of file
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, generation)});
+}
+
+void compressor_fused_task(
+    daxa::Device &device, daxa::CommandList &cmd_list,
+    std::shared_ptr<daxa::ComputePipeline> &compressor_fused_pipeline,
+    daxa::BufferId regions_id, daxa::BufferId volume_id,
+    daxa::BufferId allocator_id, daxa::BufferId specs_id,
+    daxa::BufferId dispatch_id) {
+  // the voxels stay in shared memory, no workspace is bound
+  cmd_list.set_pipeline(*compressor_fused_pipeline);
+  cmd_list.push_constant(
+      CompressorPush{.workspace = {},
+                     .specs = device.get_device_address(specs_id),
+                     .volume = device.get_device_address(volume_id),
+                     .regions = device.get_device_address(regions_id),
+                     .allocator = device.get_device_address(allocator_id)});
+  cmd_list.dispatch_indirect({.indirect_buffer = dispatch_id,
+                              .offset = offsetof(QueueDispatch, generation)});
+}
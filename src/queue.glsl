@@ -7,59 +7,341 @@ layout(push_constant, scalar) uniform Push
     QueuePush push;
 };
 
+#include <hexane/shader_malloc.inl>
+
 layout(
-    local_size_x = 1, 
+    local_size_x = QUEUE_INVOKE_SIZE, 
     local_size_y = 1, 
     local_size_z = 1
 ) in;
 
+//Schedules the next chunk_budget chunks in one workgroup. The view window is
+//moved with the camera first and the regions that left it are evicted. Every
+//view cell then gets a key of (priority, cell index), its remaining chunks are
+//counted under that key and a prefix sum over all keys gives each cell its
+//range of workspace slots, so one workspace can mix chunks from several
+//regions.
+
+#define QUEUE_KEY_COUNT (QUEUE_PRIORITY_COUNT * VIEW_SIZE)
+#define QUEUE_KEYS_PER_INVOCATION (QUEUE_KEY_COUNT / QUEUE_INVOKE_SIZE)
+
+//inclusive prefix sum of the chunks queued under each key
+shared daxa_u32 key_end[QUEUE_KEY_COUNT];
+shared daxa_u32 partial_sum[QUEUE_INVOKE_SIZE];
+shared daxa_u32 region_key[VIEW_SIZE];
+shared daxa_u32 region_chunk_count[VIEW_SIZE];
+//keys of the completed regions handed to the uniformity pass, lowest first
+shared daxa_u32 uniformity_keys[UNIFORMITY_REGIONS_PER_FRAME];
+//key of a completed region still missing its uniformity, QUEUE_KEY_COUNT otherwise
+shared daxa_u32 uniformity_candidate_key[VIEW_SIZE];
+shared daxa_u32vec3 window_origin;
+shared daxa_u32 evicted_cells[VIEW_SIZE];
+shared daxa_u32 evicted_count;
+shared daxa_u32 residency_changed;
+
+bool queue_visible(daxa_u32vec3 origin) {
+    daxa_f32vec3 center = daxa_f32vec3(origin) + 0.5;
+
+    for(daxa_u32 i = 0; i < FRUSTUM_PLANE_COUNT; i++) {
+        daxa_f32vec4 plane = deref(push.perframe).camera.frustum_planes[i];
+
+        if(dot(plane.xyz, center) + plane.w < -QUEUE_REGION_RADIUS * length(plane.xyz)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//lower goes first, regions in the frustum before the rest and each bucketed
+//by their distance to the camera
+daxa_u32 queue_priority(daxa_u32vec3 origin) {
+    if(push.streaming == 0) {
+        return 0;
+    }
+
+    daxa_f32vec3 camera_position = deref(push.perframe).camera.transform[3].xyz;
+    daxa_f32 distance = length(daxa_f32vec3(origin) + 0.5 - camera_position);
+    daxa_u32 priority = min(daxa_u32(distance), QUEUE_DISTANCE_PRIORITY_COUNT - 1);
+
+    return queue_visible(origin) ? priority : priority + QUEUE_DISTANCE_PRIORITY_COUNT;
+}
+
+//the window only moves once the camera gets within VIEW_MARGIN regions of
+//its side, and then recenters on the camera
+daxa_u32vec3 queue_window_origin(daxa_u32vec3 origin) {
+    daxa_i32vec3 camera_region = daxa_i32vec3(floor(deref(push.perframe).camera.transform[3].xyz));
+    daxa_i32vec3 camera_offset = camera_region - daxa_i32vec3(origin);
+    daxa_u32vec3 centered = daxa_u32vec3(max(camera_region - AXIS_VIEW_SIZE / 2, 0));
+
+    bvec3 moved = bvec3(
+        camera_offset.x < VIEW_MARGIN || camera_offset.x >= AXIS_VIEW_SIZE - VIEW_MARGIN,
+        camera_offset.y < VIEW_MARGIN || camera_offset.y >= AXIS_VIEW_SIZE - VIEW_MARGIN,
+        camera_offset.z < VIEW_MARGIN || camera_offset.z >= AXIS_VIEW_SIZE - VIEW_MARGIN
+    );
+
+    return mix(origin, centered, moved);
+}
+
+//returns the heap of every chunk and clears the lods and the occupancy, run by
+//the whole workgroup
+void queue_evict(daxa_u32 slot, daxa_u32 invocation) {
+    for(daxa_u32 chunk_index = invocation; chunk_index < REGION_SIZE; chunk_index += QUEUE_INVOKE_SIZE) {
+        daxa_u32 heap_offset = deref(deref(push.regions).data[slot]).chunks[chunk_index].heap_offset;
+
+        deref(deref(push.regions).data[slot]).chunks[chunk_index].heap_offset = 0;
+        deref(deref(push.regions).data[slot]).chunks[chunk_index].index_bits = 0;
+
+        shader_free(heap_offset);
+    }
+
+    for(daxa_u32 i = invocation; i < 1024; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).uniformity.lod_x2[i] = 0;
+    }
+    for(daxa_u32 i = invocation; i < 256; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).uniformity.lod_x4[i] = 0;
+    }
+    for(daxa_u32 i = invocation; i < 64; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).uniformity.lod_x8[i] = 0;
+    }
+    for(daxa_u32 i = invocation; i < 16; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).uniformity.lod_x16[i] = 0;
+    }
+    for(daxa_u32 i = invocation; i < 4; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).uniformity.lod_x32[i] = 0;
+    }
+
+    for(daxa_u32 i = invocation; i < 8192; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).occupancy.voxels[i] = 0;
+    }
+    for(daxa_u32 i = invocation; i < 128; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).occupancy.bricks[i] = 0;
+    }
+    for(daxa_u32 i = invocation; i < 2; i += QUEUE_INVOKE_SIZE) {
+        deref(deref(push.regions).data[slot]).occupancy.nodes[i] = 0;
+    }
+}
+
+void queue_hash_insert(daxa_u32vec3 region_position, daxa_u32 slot) {
+    daxa_u32 entry_index = volume_hash_start(region_position);
+
+    for(daxa_u32 probe = 0; probe < VOLUME_HASH_SIZE; probe++) {
+        if(atomicCompSwap(deref(push.volume).region_hash[entry_index].slot, 0, slot) == 0) {
+            deref(push.volume).region_hash[entry_index].position = region_position;
+            return;
+        }
+
+        entry_index = (entry_index + 1) & (VOLUME_HASH_SIZE - 1);
+    }
+}
+
 void main() {
-    deref(push.specs).spec_count = 0;
-    deref(push.unispecs).spec_count = 0;
+    daxa_u32 invocation = gl_LocalInvocationIndex;
+
+    if(invocation == 0) {
+        deref(push.specs).volume = push.volume;
+        deref(push.unispecs).volume = push.volume;
+        deref(push.specs).visible_region_count = 0;
+        deref(push.volume).descriptor.bounds = daxa_u32vec3(AXIS_VIEW_SIZE);
+
+        //every cell owns the slot after its index, slot 0 is a void region so
+        //cells that are not generated yet render nothing
+        deref(push.regions).region_count = VIEW_SIZE + 1;
+
+        window_origin = queue_window_origin(deref(push.volume).window_origin);
+        deref(push.volume).window_origin = window_origin;
+
+        evicted_count = 0;
+        residency_changed = 0;
+    }
+
+    for(daxa_u32 i = 0; i < QUEUE_KEYS_PER_INVOCATION; i++) {
+        key_end[invocation * QUEUE_KEYS_PER_INVOCATION + i] = 0;
+    }
+
+    if(invocation < UNIFORMITY_REGIONS_PER_FRAME) {
+        uniformity_keys[invocation] = QUEUE_KEY_COUNT;
+    }
+
+    barrier();
+
+    //a cell whose region is not the one the window places there is evicted
+    for(daxa_u32 cell_index = invocation; cell_index < VIEW_SIZE; cell_index += QUEUE_INVOKE_SIZE) {
+        daxa_u32 slot = deref(push.volume).region_indices[cell_index];
 
-    deref(push.unispecs).volume = push.volume;
-    deref(push.specs).volume = push.volume;
+        if(slot != 0 && deref(deref(push.regions).data[slot]).position != view_cell_position(window_origin, cell_index)) {
+            evicted_cells[atomicAdd(evicted_count, 1)] = cell_index;
+            residency_changed = 1;
+            deref(push.volume).region_indices[cell_index] = 0;
+            atomicAdd(deref(push.volume).region_count, -1);
+        }
+    }
+
+    barrier();
+
+    for(daxa_u32 i = 0; i < evicted_count; i++) {
+        queue_evict(evicted_cells[i] + 1, invocation);
+    }
+
+    for(daxa_u32 cell_index = invocation; cell_index < VIEW_SIZE; cell_index += QUEUE_INVOKE_SIZE) {
+        daxa_u32vec3 region_position = view_cell_position(window_origin, cell_index);
+        daxa_u32 key = queue_priority(region_position) * VIEW_SIZE + cell_index;
+        daxa_u32 slot = deref(push.volume).region_indices[cell_index];
+        daxa_u32 chunk_count = 0;
+        daxa_u32 candidate_key = QUEUE_KEY_COUNT;
+
+        if(slot != 0) {
+            chunk_count = deref(deref(push.regions).data[slot]).chunk_count;
+
+            //a region is handed to the uniformity pass the frame after its last chunk was compressed
+            if(chunk_count >= REGION_SIZE && deref(deref(push.regions).data[slot]).uniformity_queued == 0) {
+                candidate_key = key;
+            }
+        }
+
+        region_key[cell_index] = key;
+        uniformity_candidate_key[cell_index] = candidate_key;
+        region_chunk_count[cell_index] = chunk_count;
+        key_end[key] = min(REGION_SIZE - chunk_count, WORKSPACE_SIZE);
+    }
+
+    barrier();
 
-    if(deref(push.volume).region_count == 0) {
-        //making 0 a void region prevents regions that are unitialized from rendering the first region generated
-        atomicAdd(deref(push.regions).region_count, 1);
+    daxa_u32 sum = 0;
+    for(daxa_u32 i = 0; i < QUEUE_KEYS_PER_INVOCATION; i++) {
+        sum += key_end[invocation * QUEUE_KEYS_PER_INVOCATION + i];
+        key_end[invocation * QUEUE_KEYS_PER_INVOCATION + i] = sum;
+    }
+    partial_sum[invocation] = sum;
+
+    barrier();
+
+    for(daxa_u32 offset = 1; offset < QUEUE_INVOKE_SIZE; offset *= 2) {
+        daxa_u32 value = invocation >= offset ? partial_sum[invocation - offset] : 0;
+        barrier();
+        partial_sum[invocation] += value;
+        barrier();
+    }
 
-        deref(push.volume).region_indices[0] = atomicAdd(deref(push.regions).region_count, 1);
-        deref(push.volume).region_count = 1;
+    if(invocation > 0) {
+        for(daxa_u32 i = 0; i < QUEUE_KEYS_PER_INVOCATION; i++) {
+            key_end[invocation * QUEUE_KEYS_PER_INVOCATION + i] += partial_sum[invocation - 1];
+        }
     }
 
-    daxa_u32 region_index = deref(push.volume).region_count - 1;
+    barrier();
 
-    for(daxa_u32 i = 0; i < WORKSPACE_SIZE; i++) {
-        daxa_u32 chunk_index;
+    //every round picks the lowest candidate key above the one picked before
+    for(daxa_u32 i = 0; i < UNIFORMITY_REGIONS_PER_FRAME; i++) {
+        daxa_u32 previous_key = i > 0 ? uniformity_keys[i - 1] : 0;
 
-        daxa_u32 axis_region_in_world = AXIS_WORLD_SIZE / (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE);
-        daxa_u32 world_size = axis_region_in_world * axis_region_in_world * axis_region_in_world;
-        deref(push.volume).descriptor.bounds = daxa_u32vec3(axis_region_in_world);
+        for(daxa_u32 cell_index = invocation; cell_index < VIEW_SIZE; cell_index += QUEUE_INVOKE_SIZE) {
+            daxa_u32 candidate_key = uniformity_candidate_key[cell_index];
 
-        if(deref(push.volume).region_count >= world_size) {
-            break;
+            if(candidate_key < QUEUE_KEY_COUNT && (i == 0 || candidate_key > previous_key)) {
+                atomicMin(uniformity_keys[i], candidate_key);
+            }
         }
 
-        if(deref(deref(push.regions).data[deref(push.volume).region_indices[region_index]]).chunk_count >= REGION_SIZE) {
-            deref(push.unispecs).spec[deref(push.unispecs).spec_count].region_index = region_index;
-            deref(push.unispecs).spec_count++;
-            deref(push.volume).region_count += 1;
-            region_index = deref(push.volume).region_count - 1;
-            deref(push.volume).region_indices[region_index] = atomicAdd(deref(push.regions).region_count, 1);
-            chunk_index = 0;
-        } else {
-            chunk_index = deref(deref(push.regions).data[deref(push.volume).region_indices[region_index]]).chunk_count;
-            deref(deref(push.regions).data[deref(push.volume).region_indices[region_index]]).chunk_count++;
+        barrier();
+    }
+
+    daxa_u32 spec_count = min(key_end[QUEUE_KEY_COUNT - 1], min(push.chunk_budget, WORKSPACE_SIZE));
+
+    if(invocation == 0) {
+        deref(push.specs).spec_count = spec_count;
+        deref(push.dispatch).generation = DispatchIndirect(spec_count, 1, 1);
+
+        daxa_u32 unispec_count = 0;
+        while(unispec_count < UNIFORMITY_REGIONS_PER_FRAME && uniformity_keys[unispec_count] < QUEUE_KEY_COUNT) {
+            unispec_count++;
         }
 
-        daxa_i32vec3 origin = daxa_i32vec3(one_d_to_three_d(region_index, daxa_u32vec3(axis_region_in_world)));
+        deref(push.unispecs).spec_count = unispec_count;
+
+        //the blocks of the queued regions are stacked along z
+        daxa_u32 a = (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE) / UNIFORMITY_BLOCK_SIZE;
+        deref(push.dispatch).uniformity = DispatchIndirect(a, a, a * unispec_count);
+    }
+
+    //every workspace slot looks up the key whose range holds it
+    for(daxa_u32 i = invocation; i < spec_count; i += QUEUE_INVOKE_SIZE) {
+        daxa_u32 low = 0;
+        daxa_u32 high = QUEUE_KEY_COUNT - 1;
+
+        while(low < high) {
+            daxa_u32 middle = (low + high) / 2;
+            if(key_end[middle] > i) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+
+        daxa_u32 key_start = low > 0 ? key_end[low - 1] : 0;
+        daxa_u32 cell_index = low % VIEW_SIZE;
 
         deref(push.specs).spec[i] = Spec(
-            region_index,
-            chunk_index,
-            origin
+            cell_index,
+            region_chunk_count[cell_index] + i - key_start,
+            daxa_i32vec3(view_cell_position(window_origin, cell_index))
         );
-        deref(push.specs).spec_count++;
     }
-}
\ No newline at end of file
+
+    for(daxa_u32 cell_index = invocation; cell_index < VIEW_SIZE; cell_index += QUEUE_INVOKE_SIZE) {
+        daxa_u32vec3 region_position = view_cell_position(window_origin, cell_index);
+        daxa_u32 key = region_key[cell_index];
+        daxa_u32 key_start = key > 0 ? key_end[key - 1] : 0;
+        daxa_u32 taken = min(key_end[key], spec_count) - min(key_start, spec_count);
+        daxa_u32 slot = deref(push.volume).region_indices[cell_index];
+
+        if(taken != 0) {
+            if(slot == 0) {
+                slot = cell_index + 1;
+                deref(push.volume).region_indices[cell_index] = slot;
+                atomicAdd(deref(push.volume).region_count, 1);
+
+                deref(deref(push.regions).data[slot]).position = region_position;
+                deref(deref(push.regions).data[slot]).chunk_count = 0;
+                deref(deref(push.regions).data[slot]).uniformity_queued = 0;
+                residency_changed = 1;
+            }
+
+            deref(deref(push.regions).data[slot]).chunk_count += taken;
+        }
+
+        if(slot != 0 && region_chunk_count[cell_index] + taken >= REGION_SIZE
+            && queue_visible(region_position)) {
+            atomicAdd(deref(push.specs).visible_region_count, 1);
+        }
+
+        for(daxa_u32 i = 0; i < UNIFORMITY_REGIONS_PER_FRAME; i++) {
+            if(key == uniformity_keys[i]) {
+                deref(deref(push.regions).data[slot]).uniformity_queued = 1;
+                deref(push.unispecs).spec[i] = UniSpec(cell_index, UNIFORMITY_ALL_BLOCKS);
+            }
+        }
+    }
+
+    barrier();
+
+    //rebuilding the region hash from scratch leaves no tombstones behind
+    if(residency_changed == 0) {
+        return;
+    }
+
+    for(daxa_u32 i = invocation; i < VOLUME_HASH_SIZE; i += QUEUE_INVOKE_SIZE) {
+        deref(push.volume).region_hash[i].slot = 0;
+    }
+
+    memoryBarrierBuffer();
+    barrier();
+
+    for(daxa_u32 cell_index = invocation; cell_index < VIEW_SIZE; cell_index += QUEUE_INVOKE_SIZE) {
+        daxa_u32 slot = deref(push.volume).region_indices[cell_index];
+
+        if(slot != 0) {
+            queue_hash_insert(view_cell_position(window_origin, cell_index), slot);
+        }
+    }
+}
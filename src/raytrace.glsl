@@ -7,6 +7,12 @@ layout(push_constant, scalar) uniform Push
     RaytraceDrawPush push;
 };
 #include <hexane/rtx.inl>
+#elif defined(RAYTRACE_TRACE)
+layout(push_constant, scalar) uniform Push
+{
+    RaytraceTracePush push;
+};
+#include <hexane/rtx.inl>
 #elif defined(RAYTRACE_PREPARE_FRONT) || defined(RAYTRACE_PREPARE_BACK)
 layout(push_constant, scalar) uniform Push
 {
@@ -14,82 +20,107 @@ layout(push_constant, scalar) uniform Push
 };
 #endif
 
-#if defined(RAYTRACE_PREPARE_FRONT)
+#if defined(RAYTRACE_PREPARE_FRONT) || defined(RAYTRACE_PREPARE_BACK)
 
 layout(
-    local_size_x = 1, 
+    local_size_x = PREPARE_INVOKE_SIZE, 
     local_size_y = 1, 
     local_size_z = 1
 ) in;
 
-void main() {
-    deref(push.raytrace_specs).volume = push.volume;
-    deref(push.indirect).vertex_count = 36;
-    deref(push.raytrace_specs).spec_count = 0;
+//Every invocation culls PREPARE_CELLS_PER_INVOCATION view cells and a prefix
+//sum over the survivors gives each its spec, so specs stay in cell order
+//without a serial scan.
 
-    for(daxa_u32 i = 0; i < 8*8; i++) {
-        deref(push.raytrace_specs).spec[deref(push.raytrace_specs).spec_count++].region_index = i;
+shared daxa_u32 partial_sum[PREPARE_INVOKE_SIZE];
+
+#if defined(RAYTRACE_PREPARE_FRONT)
+//cubes of the regions whose bounds touch the frustum
+bool prepare_cull(daxa_u32vec3 origin) {
+    for(daxa_u32 i = 0; i < FRUSTUM_PLANE_COUNT; i++) {
+        daxa_f32vec4 plane = deref(push.perframe).camera.frustum_planes[i];
+        //the corner furthest along the plane normal
+        daxa_f32vec3 corner = daxa_f32vec3(origin) + step(daxa_f32vec3(0), plane.xyz);
+
+        if(dot(plane.xyz, corner) + plane.w < 0) {
+            return false;
+        }
     }
 
-    deref(push.indirect).instance_count = min(deref(push.raytrace_specs).spec_count, deref(push.volume).region_count);
+    return true;
 }
-
-#elif defined(RAYTRACE_PREPARE_BACK)
-
-layout(
-    local_size_x = 1, 
-    local_size_y = 1, 
-    local_size_z = 1
-) in;
-
-void main() {
-    daxa_u32 axis_region_in_world = AXIS_WORLD_SIZE / (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE);
-
+#else
+//the back faces are drawn for the regions that hold a corner of the near
+//plane, their front faces are behind it
+bool prepare_cull(daxa_u32vec3 origin) {
     Camera camera = deref(push.perframe).camera;
 
-#define NEAR_PLANE_CHECK_COUNT 4
-    daxa_f32vec2 near_plane_check[NEAR_PLANE_CHECK_COUNT] = daxa_f32vec2[](
+    daxa_f32vec2 near_plane_check[4] = daxa_f32vec2[](
         daxa_f32vec2(-1.0, -1.0),
         daxa_f32vec2(1.0, -1.0),
         daxa_f32vec2(-1.0, 1.0),
         daxa_f32vec2(1.0, 1.0)
     );
 
-    deref(push.raytrace_specs).spec_count = 0;
-    deref(push.raytrace_specs).volume = push.volume;
-
-    for(daxa_u32 i = 0; i < NEAR_PLANE_CHECK_COUNT; i++) {
+    for(daxa_u32 i = 0; i < 4; i++) {
         //for some reason this works if z is 0.0 and not -1.0 (near plane)
         daxa_f32vec4 near_plane = daxa_f32vec4(near_plane_check[i], 0.0, 1.0);
         daxa_f32vec4 near_plane_view_position = camera.inv_projection * near_plane;
         near_plane_view_position /= near_plane_view_position.w;
         daxa_f32vec3 near_plane_world_position = (camera.transform * near_plane_view_position).xyz;
-        
-        bool inside = all(greaterThanEqual(near_plane_world_position, daxa_f32vec3(0)))
-            && all(lessThan(near_plane_world_position, daxa_f32vec3(axis_region_in_world)));
-
-        if(inside) {
-            daxa_u32 region_index = three_d_to_one_d(daxa_u32vec3(near_plane_world_position), daxa_u32vec3(axis_region_in_world));
-
-            bool cont = false;
-            
-            for(daxa_u32 i = 0; i < deref(push.raytrace_specs).spec_count; i++) {
-                if(deref(push.raytrace_specs).spec[i].region_index == region_index) {
-                    cont = true;
-                    break;
-                }
-            }
-
-            if(cont) {
-                continue;
-            }
-
-            deref(push.raytrace_specs).spec[deref(push.raytrace_specs).spec_count++].region_index = region_index;
+
+        if(all(greaterThanEqual(near_plane_world_position, daxa_f32vec3(origin)))
+            && all(lessThan(near_plane_world_position, daxa_f32vec3(origin + 1)))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+#endif
+
+void main() {
+    daxa_u32 invocation = gl_LocalInvocationID.x;
+    daxa_u32vec3 window_origin = deref(push.volume).window_origin;
+
+    //queue.glsl allocates regions in priority order, so skip the ones it hasn't reached
+    daxa_u32 visible = 0;
+    daxa_u32 count = 0;
+    for(daxa_u32 i = 0; i < PREPARE_CELLS_PER_INVOCATION; i++) {
+        daxa_u32 cell_index = invocation * PREPARE_CELLS_PER_INVOCATION + i;
+
+        if(deref(push.volume).region_indices[cell_index] != 0
+            && prepare_cull(view_cell_position(window_origin, cell_index))) {
+            visible |= 1u << i;
+            count++;
         }
     }
+    partial_sum[invocation] = count;
 
-    deref(push.indirect).vertex_count = 36;
-    deref(push.indirect).instance_count = deref(push.raytrace_specs).spec_count;
+    barrier();
+
+    for(daxa_u32 offset = 1; offset < PREPARE_INVOKE_SIZE; offset *= 2) {
+        daxa_u32 value = invocation >= offset ? partial_sum[invocation - offset] : 0;
+        barrier();
+        partial_sum[invocation] += value;
+        barrier();
+    }
+
+    daxa_u32 spec_index = partial_sum[invocation] - count;
+    for(daxa_u32 i = 0; i < PREPARE_CELLS_PER_INVOCATION; i++) {
+        if((visible & (1u << i)) != 0) {
+            deref(push.raytrace_specs).spec[spec_index++].region_index = invocation * PREPARE_CELLS_PER_INVOCATION + i;
+        }
+    }
+
+    if(invocation == PREPARE_INVOKE_SIZE - 1) {
+        deref(push.raytrace_specs).volume = push.volume;
+        deref(push.raytrace_specs).spec_count = partial_sum[invocation];
+        deref(push.indirect).vertex_count = 36;
+        deref(push.indirect).instance_count = partial_sum[invocation];
+        deref(push.indirect).first_vertex = 0;
+        deref(push.indirect).first_instance = 0;
+    }
 }
 
 #elif defined(RAYTRACE_VERT)
@@ -132,8 +163,8 @@ void main()
 	);
 
     daxa_u32 region_index = deref(push.raytrace_specs).spec[gl_InstanceIndex].region_index;
-    daxa_u32 axis_region_in_world = AXIS_WORLD_SIZE / (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE);
-    origin = daxa_u32vec4(one_d_to_three_d(region_index, daxa_u32vec3(axis_region_in_world)), 1);
+    daxa_u32vec3 window_origin = deref(deref(push.raytrace_specs).volume).window_origin;
+    origin = daxa_u32vec4(view_cell_position(window_origin, region_index), 1);
     local_position = daxa_f32vec4(offsets[indices[gl_VertexIndex]], 1.0);
     world_position = daxa_f32vec4(local_position.xyz + daxa_f32vec3(origin.xyz), 1.0);
 
@@ -199,8 +230,9 @@ void main()
     q.regions = push.regions;
     q.allocator = push.allocator;
 
-    bool outside = any(lessThan(neighbor, daxa_f32vec3(0)))
-		|| any(greaterThanEqual(neighbor, daxa_f32vec3(deref(q.volume).descriptor.bounds *  AXIS_REGION_SIZE * AXIS_CHUNK_SIZE)));
+    daxa_u32vec3 window_origin = deref(q.volume).window_origin;
+    bool outside = any(lessThan(neighbor, daxa_f32vec3(window_origin * AXIS_REGION_SIZE * AXIS_CHUNK_SIZE)))
+		|| any(greaterThanEqual(neighbor, daxa_f32vec3((window_origin + deref(q.volume).descriptor.bounds) * AXIS_REGION_SIZE * AXIS_CHUNK_SIZE)));
 
     if(query(q) && q.information != ray.descriptor.medium && !outside) {
         discard;
@@ -227,4 +259,104 @@ void main()
     daxa_f32 depth = (((100-0.1) * ndc_depth) + 0.1 + 100) / 2.0;
     gl_FragDepth = depth;
 }
+#elif defined(RAYTRACE_TRACE)
+
+layout(
+    local_size_x = 8, 
+    local_size_y = 8, 
+    local_size_z = 1
+) in;
+
+//resident regions the ray has entered, each was a cube fragment of the raster path
+daxa_u32 trace_region_count(daxa_f32vec3 position, inout daxa_u32 last_region_index) {
+    daxa_u32vec3 p = daxa_u32vec3(daxa_i32vec3(position));
+
+    INDICES(push.volume, p)
+
+    if(region_index == last_region_index) {
+        return 0;
+    }
+
+    last_region_index = region_index;
+
+    return region_index != 0 ? 1 : 0;
+}
+
+//a single ray per pixel walks every region of the view window, so each pixel
+//is shaded once instead of once per region cube covering it
+void main() {
+    daxa_u32vec2 pixel = gl_GlobalInvocationID.xy;
+
+    if(any(greaterThanEqual(pixel, push.resolution))) {
+        return;
+    }
+
+    Camera camera = deref(push.perframe).camera;
+
+    daxa_f32vec2 ndc = (daxa_f32vec2(pixel) + 0.5) / daxa_f32vec2(push.resolution) * 2.0 - 1.0;
+    //z of 0.0 lands on the near plane, see RAYTRACE_PREPARE_BACK
+    daxa_f32vec4 view_position = camera.inv_projection * daxa_f32vec4(ndc, 0.0, 1.0);
+    view_position /= view_position.w;
+    daxa_f32vec3 o = camera.transform[3].xyz;
+    daxa_f32vec3 v = (camera.transform * view_position).xyz;
+
+    daxa_u32vec3 window_origin = deref(push.volume).window_origin;
+
+    RayDescriptor desc;
+    desc.volume = push.volume;
+    desc.regions = push.regions;
+    desc.allocator = push.allocator;
+    desc.origin = o * AXIS_CHUNK_SIZE * AXIS_REGION_SIZE;
+    desc.direction = normalize(v - o);
+    desc.max_dist = 1000;
+    desc.minimum = daxa_i32vec3(window_origin) * AXIS_CHUNK_SIZE * AXIS_REGION_SIZE;
+    desc.maximum = daxa_i32vec3(window_origin + AXIS_VIEW_SIZE) * AXIS_CHUNK_SIZE * AXIS_REGION_SIZE;
+    desc.medium = BLOCK_ID_AIR;
+
+    Ray ray;
+
+    ray_cast_start(desc, ray);
+
+    daxa_u32 region_count = 0;
+    daxa_u32 last_region_index = 0;
+
+    if(push.debug_view == RAYTRACE_DEBUG_STEPS) {
+        do {
+            region_count += trace_region_count(ray.position, last_region_index);
+        } while(ray_cast_drive(ray));
+    } else {
+        while(ray_cast_drive(ray)) {}
+    }
+
+    Hit hit;
+
+    ray_cast_complete(ray, hit);
+
+    daxa_f32vec3 color = daxa_f32vec3(0);
+
+    if(push.debug_view == RAYTRACE_DEBUG_STEPS) {
+        //red is the traversal cost, green the overdraw the region cubes had
+        color = daxa_f32vec3(
+            daxa_f32(hit.ray.step_count) / MAX_STEP_COUNT,
+            daxa_f32(region_count) / AXIS_VIEW_SIZE,
+            0
+        );
+    } else if(hit.ray.state_id == RAY_STATE_VOXEL_FOUND) {
+        color = daxa_f32vec3(1);
+
+        if(hit.block_id == BLOCK_ID_STONE) {
+            color = daxa_f32vec3(mod(hit.destination.xyz, AXIS_CHUNK_SIZE) / AXIS_CHUNK_SIZE);
+        }
+
+        if(abs(hit.normal.x) == 1) {
+            color *= 0.5;
+        }
+
+        if(abs(hit.normal.z) == 1) {
+            color *= 0.75;
+        }
+    }
+
+    imageStore(push.render, daxa_i32vec2(pixel), daxa_f32vec4(color, 1));
+}
 #endif
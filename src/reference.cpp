@@ -0,0 +1,1244 @@
+#include <hexane/reference.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+ThreadPool::ThreadPool(daxa_u32 thread_count) {
+  for (daxa_u32 i = 1; i < std::max(thread_count, daxa_u32(1)); i++) {
+    workers.emplace_back([this]() { worker_loop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+static void run_tasks(std::atomic<daxa_u32> &next_task, daxa_u32 task_count,
+                      std::function<void(daxa_u32)> const *task) {
+  for (daxa_u32 i = next_task++; i < task_count; i = next_task++) {
+    (*task)(i);
+  }
+}
+
+void ThreadPool::worker_loop() {
+  daxa_u64 seen_generation = 0;
+  while (true) {
+    std::unique_lock lock(mutex);
+    wake.wait(lock,
+              [&]() { return stopping || generation != seen_generation; });
+    if (stopping) {
+      return;
+    }
+    seen_generation = generation;
+    auto *current_task = task;
+    auto current_task_count = task_count;
+    busy++;
+    lock.unlock();
+
+    run_tasks(next_task, current_task_count, current_task);
+
+    lock.lock();
+    if (--busy == 0) {
+      done.notify_all();
+    }
+  }
+}
+
+void ThreadPool::parallel_for(daxa_u32 count,
+                              std::function<void(daxa_u32)> const &task) {
+  if (workers.empty() || count <= 1) {
+    for (daxa_u32 i = 0; i < count; i++) {
+      task(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard lock(mutex);
+    this->task = &task;
+    task_count = count;
+    next_task = 0;
+    generation++;
+  }
+  wake.notify_all();
+
+  run_tasks(next_task, count, &task);
+
+  std::unique_lock lock(mutex);
+  done.wait(lock, [&]() { return busy == 0; });
+}
+
+ReferenceEngine::ReferenceEngine(ReferenceEngineInfo const &info)
+    : info(info), pool(info.thread_count), volume(std::make_unique<Volume>()),
+      specs(std::make_unique<Specs>()), unispecs(std::make_unique<UniSpecs>()),
+      edit_specs(std::make_unique<Specs>()),
+      edit_unispecs(std::make_unique<UniSpecs>()),
+      workspace(WORKSPACE_SIZE * CHUNK_SIZE) {
+  allocator.heap_size = info.heap_capacity;
+}
+
+void ReferenceEngine::generate(Brush const &brush) {
+  queue();
+  this->brush(brush);
+  compressor_free();
+  compressor_palettize();
+  compressor_allocate();
+  compressor_write();
+  compact_slice();
+  uniformity();
+}
+
+bool ReferenceEngine::generation_complete() const {
+  return volume->region_count != 0 && specs->spec_count == 0 &&
+         unispecs->spec_count == 0;
+}
+
+Region &ReferenceEngine::region(daxa_u32 region_index) {
+  if (region_index >= info.region_capacity) {
+    throw std::runtime_error("reference regions array exhausted");
+  }
+  if (region_index >= region_data.size()) {
+    region_data.resize(region_index + 1);
+  }
+  return region_data[region_index];
+}
+
+Region const &ReferenceEngine::region(daxa_u32 region_index) const {
+  return region_data.at(region_index);
+}
+
+daxa_u32 ReferenceEngine::index_bits(daxa_u32 palette_count) const {
+  return info.pow2_index_bits ? palette_index_bits_pow2(palette_count)
+                              : palette_index_bits(palette_count);
+}
+
+daxa_u32 ReferenceEngine::heap_word(daxa_u32 address) const {
+  return address < heap.size() ? heap[address] : 0;
+}
+
+// Mirrors shader_malloc.inl: blocks framed by their size, owner and a
+// DEADBEEF guard word, recycled through per size class free lists.
+daxa_u32 ReferenceEngine::shader_malloc_block(daxa_u32 address, daxa_u32 size,
+                                              daxa_u32 owner) {
+  heap[address - 2] = size + ALLOCATOR_BLOCK_OVERHEAD;
+  heap[address - 1] = owner;
+  heap[address + size] = ALLOCATOR_GUARD;
+
+  allocator.stats.allocated_words += size + ALLOCATOR_BLOCK_OVERHEAD;
+  allocator.stats.allocation_count++;
+
+  return address;
+}
+
+daxa_u32 ReferenceEngine::shader_malloc(daxa_u32 size, daxa_u32 owner) {
+  daxa_u32 size_class = (size + ALLOCATOR_SIZE_CLASS_GRANULE - 1) /
+                        ALLOCATOR_SIZE_CLASS_GRANULE;
+
+  if (size_class < ALLOCATOR_SIZE_CLASS_COUNT) {
+    size = size_class * ALLOCATOR_SIZE_CLASS_GRANULE;
+
+    daxa_u32 address = allocator.free_heads[size_class];
+    if (address != 0) {
+      allocator.free_heads[size_class] = heap[address];
+
+      allocator.stats.free_words -= size + ALLOCATOR_BLOCK_OVERHEAD;
+      allocator.stats.reuse_count++;
+
+      return shader_malloc_block(address, size, owner);
+    }
+  }
+
+  // the gap a running compaction has opened goes first, see shader_malloc.inl
+  if (allocator.compacting != 0 &&
+      allocator.compact_offset + size + ALLOCATOR_BLOCK_OVERHEAD <=
+          allocator.compact_cursor) {
+    daxa_u32 address = allocator.compact_offset + 2;
+    allocator.compact_offset += size + ALLOCATOR_BLOCK_OVERHEAD;
+
+    return shader_malloc_block(address, size, owner);
+  }
+
+  // heap_offset only moves past blocks that fit
+  daxa_u32 result_address = allocator.heap_offset;
+  if (result_address + size + ALLOCATOR_BLOCK_OVERHEAD > allocator.heap_size) {
+    allocator.stats.failed_count++;
+    return 0;
+  }
+
+  allocator.heap_offset += size + ALLOCATOR_BLOCK_OVERHEAD;
+  if (allocator.heap_offset > heap.size()) {
+    heap.resize(std::max<std::size_t>(allocator.heap_offset, heap.size() * 2));
+  }
+
+  return shader_malloc_block(result_address + 2, size, owner);
+}
+
+void ReferenceEngine::shader_free(daxa_u32 address) {
+  if (address == 0) {
+    return;
+  }
+
+  daxa_u32 block_size = heap[address - 2];
+  heap[address - 2] |= ALLOCATOR_FREE_BIT;
+
+  if ((block_size & ALLOCATOR_FREE_BIT) != 0) {
+    return;
+  }
+
+  allocator.stats.allocated_words -= block_size;
+  allocator.stats.free_count++;
+  allocator.stats.free_words += block_size;
+
+  daxa_u32 size = block_size - ALLOCATOR_BLOCK_OVERHEAD;
+  daxa_u32 size_class = size / ALLOCATOR_SIZE_CLASS_GRANULE;
+
+  if (size % ALLOCATOR_SIZE_CLASS_GRANULE != 0 ||
+      size_class >= ALLOCATOR_SIZE_CLASS_COUNT) {
+    return;
+  }
+
+  if (allocator.compacting != 0 && address >= allocator.compact_offset) {
+    return;
+  }
+
+  heap[address] = allocator.free_heads[size_class];
+  allocator.free_heads[size_class] = address;
+}
+
+// Mirrors compact.glsl, the staging copy makes overlapping moves safe the
+// same way shared memory does there.
+void ReferenceEngine::compact_slice() {
+  if (allocator.compacting == 0 &&
+      allocator.stats.free_words * COMPACT_FREE_RATIO > allocator.heap_offset) {
+    allocator.compacting = 1;
+    allocator.compact_cursor = 0;
+    allocator.compact_offset = 0;
+    allocator.stats.compact_cycles++;
+
+    std::fill(std::begin(allocator.free_heads), std::end(allocator.free_heads),
+              0);
+  }
+
+  if (allocator.compacting == 0) {
+    return;
+  }
+
+  daxa_u32 cursor = allocator.compact_cursor;
+  daxa_u32 offset = allocator.compact_offset;
+  daxa_u32 heap_offset = std::min(allocator.heap_offset, allocator.heap_size);
+  daxa_u32 slice_size = 0;
+
+  std::vector<std::pair<daxa_u32, daxa_u32>> blocks;
+  for (daxa_u32 i = 0; i < COMPACT_SLICE_BLOCKS && cursor < heap_offset; i++) {
+    daxa_u32 size_word = heap_word(cursor);
+    daxa_u32 block_size = size_word & ~ALLOCATOR_FREE_BIT;
+
+    // not a block, the cycle stays parked here, see compact.glsl
+    if (block_size == 0 || block_size > heap_offset - cursor) {
+      break;
+    }
+
+    if ((size_word & ALLOCATOR_FREE_BIT) != 0) {
+      allocator.stats.free_words -= block_size;
+      cursor += block_size;
+      continue;
+    }
+
+    if (cursor == offset) {
+      cursor += block_size;
+      offset += block_size;
+      continue;
+    }
+
+    if (slice_size + block_size > COMPACT_SLICE_WORDS) {
+      break;
+    }
+
+    blocks.push_back({cursor, offset});
+    cursor += block_size;
+    offset += block_size;
+    slice_size += block_size;
+  }
+
+  allocator.stats.compacted_words += slice_size;
+
+  if (cursor >= heap_offset) {
+    allocator.heap_offset = offset;
+    allocator.compacting = 0;
+  } else {
+    allocator.compact_cursor = cursor;
+  }
+  allocator.compact_offset = offset;
+
+  std::vector<daxa_u32> slice_words;
+  for (auto [source, target] : blocks) {
+    slice_words.insert(slice_words.end(), heap.begin() + source,
+                       heap.begin() + source + heap[source]);
+  }
+
+  daxa_u32 staging = 0;
+  for (auto [source, target] : blocks) {
+    daxa_u32 block_size = slice_words[staging];
+    std::copy_n(slice_words.begin() + staging, block_size,
+                heap.begin() + target);
+
+    daxa_u32 owner = slice_words[staging + 1];
+    region_data[owner / REGION_SIZE].chunks[owner % REGION_SIZE].heap_offset =
+        target + 2;
+
+    staging += block_size;
+  }
+}
+
+bool ReferenceEngine::queue_visible(daxa_u32vec3 origin) const {
+  daxa_f32vec3 center = {daxa_f32(origin.x) + 0.5f, daxa_f32(origin.y) + 0.5f,
+                         daxa_f32(origin.z) + 0.5f};
+
+  for (auto const &plane : frustum_planes) {
+    daxa_f32 normal_length =
+        std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (plane.x * center.x + plane.y * center.y + plane.z * center.z +
+            plane.w <
+        -daxa_f32(QUEUE_REGION_RADIUS) * normal_length) {
+      return false;
+    }
+  }
+  return true;
+}
+
+daxa_u32 ReferenceEngine::queue_priority(daxa_u32vec3 origin) const {
+  if (!streaming) {
+    return 0;
+  }
+
+  daxa_f32 x = daxa_f32(origin.x) + 0.5f - camera_position.x;
+  daxa_f32 y = daxa_f32(origin.y) + 0.5f - camera_position.y;
+  daxa_f32 z = daxa_f32(origin.z) + 0.5f - camera_position.z;
+  daxa_u32 priority =
+      std::min(daxa_u32(std::sqrt(x * x + y * y + z * z)),
+               daxa_u32(QUEUE_DISTANCE_PRIORITY_COUNT - 1));
+
+  return queue_visible(origin)
+             ? priority
+             : priority + QUEUE_DISTANCE_PRIORITY_COUNT;
+}
+
+daxa_u32vec3
+ReferenceEngine::queue_window_origin(daxa_u32vec3 origin) const {
+  daxa_i32 camera_region[3] = {daxa_i32(std::floor(camera_position.x)),
+                               daxa_i32(std::floor(camera_position.y)),
+                               daxa_i32(std::floor(camera_position.z))};
+  daxa_u32 *axes[3] = {&origin.x, &origin.y, &origin.z};
+
+  for (daxa_u32 axis = 0; axis < 3; axis++) {
+    daxa_i32 camera_offset = camera_region[axis] - daxa_i32(*axes[axis]);
+    if (camera_offset < VIEW_MARGIN ||
+        camera_offset >= AXIS_VIEW_SIZE - VIEW_MARGIN) {
+      *axes[axis] =
+          daxa_u32(std::max(camera_region[axis] - AXIS_VIEW_SIZE / 2, 0));
+    }
+  }
+  return origin;
+}
+
+void ReferenceEngine::queue_evict(daxa_u32 slot) {
+  Region &target = region(slot);
+
+  for (auto &chunk : target.chunks) {
+    shader_free(chunk.heap_offset);
+    chunk.heap_offset = 0;
+    chunk.index_bits = 0;
+  }
+
+  target.uniformity = {};
+  target.occupancy = {};
+}
+
+void ReferenceEngine::queue_hash_insert(daxa_u32vec3 region_position,
+                                        daxa_u32 slot) {
+  daxa_u32 entry_index = volume_hash_start(region_position);
+
+  for (daxa_u32 probe = 0; probe < VOLUME_HASH_SIZE; probe++) {
+    VolumeHashEntry &entry = volume->region_hash[entry_index];
+    if (entry.slot == 0) {
+      entry = {.position = region_position, .slot = slot};
+      return;
+    }
+    entry_index = (entry_index + 1) & (VOLUME_HASH_SIZE - 1);
+  }
+}
+
+void ReferenceEngine::queue() {
+  specs->spec_count = 0;
+  specs->visible_region_count = 0;
+  unispecs->spec_count = 0;
+  volume->descriptor.bounds = {AXIS_VIEW_SIZE, AXIS_VIEW_SIZE, AXIS_VIEW_SIZE};
+
+  // every cell owns the slot after its index, slot 0 stays the void region
+  regions.region_count = VIEW_SIZE + 1;
+
+  volume->window_origin = queue_window_origin(volume->window_origin);
+  bool residency_changed = false;
+
+  for (daxa_u32 cell_index = 0; cell_index < VIEW_SIZE; cell_index++) {
+    daxa_u32 &slot = volume->region_indices[cell_index];
+    daxa_u32vec3 position =
+        view_cell_position(volume->window_origin, cell_index);
+
+    if (slot != 0 && (region(slot).position.x != position.x ||
+                      region(slot).position.y != position.y ||
+                      region(slot).position.z != position.z)) {
+      queue_evict(slot);
+      slot = 0;
+      volume->region_count--;
+      residency_changed = true;
+    }
+  }
+
+  // Sorting the (priority, cell index) keys gives the same workspace as the
+  // prefix sum in queue.glsl.
+  std::vector<std::pair<daxa_u32, daxa_u32>> keys;
+  std::vector<std::pair<daxa_u32, daxa_u32>> uniformity_keys;
+
+  for (daxa_u32 cell_index = 0; cell_index < VIEW_SIZE; cell_index++) {
+    daxa_u32vec3 position =
+        view_cell_position(volume->window_origin, cell_index);
+    daxa_u32 key = queue_priority(position) * VIEW_SIZE + cell_index;
+    daxa_u32 slot = volume->region_indices[cell_index];
+    daxa_u32 chunk_count = slot != 0 ? region(slot).chunk_count : 0;
+
+    if (slot != 0 && chunk_count >= REGION_SIZE &&
+        region(slot).uniformity_queued == 0) {
+      uniformity_keys.emplace_back(key, cell_index);
+    }
+
+    if (chunk_count < REGION_SIZE) {
+      keys.emplace_back(key, cell_index);
+    } else if (queue_visible(position)) {
+      specs->visible_region_count++;
+    }
+  }
+
+  std::sort(keys.begin(), keys.end());
+
+  daxa_u32 budget = std::min(chunk_budget, daxa_u32(WORKSPACE_SIZE));
+
+  for (auto [key, cell_index] : keys) {
+    if (specs->spec_count >= budget) {
+      break;
+    }
+
+    daxa_u32vec3 position =
+        view_cell_position(volume->window_origin, cell_index);
+    daxa_u32 &slot = volume->region_indices[cell_index];
+    if (slot == 0) {
+      slot = cell_index + 1;
+      volume->region_count++;
+
+      region(slot).position = position;
+      region(slot).chunk_count = 0;
+      region(slot).uniformity_queued = 0;
+      residency_changed = true;
+    }
+
+    Region &target = region(slot);
+    daxa_u32 taken = std::min(REGION_SIZE - target.chunk_count,
+                              budget - specs->spec_count);
+
+    for (daxa_u32 i = 0; i < taken; i++) {
+      specs->spec[specs->spec_count++] = Spec{
+          .region_index = cell_index,
+          .chunk_index = target.chunk_count + i,
+          .origin = {daxa_i32(position.x), daxa_i32(position.y),
+                     daxa_i32(position.z)},
+      };
+    }
+
+    target.chunk_count += taken;
+
+    if (target.chunk_count >= REGION_SIZE && queue_visible(position)) {
+      specs->visible_region_count++;
+    }
+  }
+
+  // the lowest keys, same as the atomicMin rounds in queue.glsl
+  std::sort(uniformity_keys.begin(), uniformity_keys.end());
+  for (auto [key, cell_index] : uniformity_keys) {
+    if (unispecs->spec_count >= UNIFORMITY_REGIONS_PER_FRAME) {
+      break;
+    }
+
+    region(volume->region_indices[cell_index]).uniformity_queued = 1;
+    unispecs->spec[unispecs->spec_count++] = {
+        .region_index = cell_index,
+        .block_mask = UNIFORMITY_ALL_BLOCKS,
+    };
+  }
+
+  if (residency_changed) {
+    std::fill(std::begin(volume->region_hash), std::end(volume->region_hash),
+              VolumeHashEntry{});
+    for (daxa_u32 cell_index = 0; cell_index < VIEW_SIZE; cell_index++) {
+      daxa_u32 slot = volume->region_indices[cell_index];
+      if (slot != 0) {
+        queue_hash_insert(
+            view_cell_position(volume->window_origin, cell_index), slot);
+      }
+    }
+  }
+}
+
+void ReferenceEngine::brush(Brush const &brush) {
+  pool.parallel_for(specs->spec_count, [&](daxa_u32 workspace_chunk_index) {
+    Spec spec = specs->spec[workspace_chunk_index];
+    daxa_u32vec3 chunk_position = one_d_to_three_d(
+        spec.chunk_index,
+        daxa_u32vec3{AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+    daxa_i32vec3 region_position = spec.origin;
+
+    for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+      daxa_u32vec3 local_position = one_d_to_three_d(
+          local_index,
+          daxa_u32vec3{AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+
+      daxa_i32vec3 position = {
+          daxa_i32(local_position.x + AXIS_CHUNK_SIZE * chunk_position.x) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * region_position.x,
+          daxa_i32(local_position.y + AXIS_CHUNK_SIZE * chunk_position.y) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * region_position.y,
+          daxa_i32(local_position.z + AXIS_CHUNK_SIZE * chunk_position.z) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * region_position.z,
+      };
+
+      workspace[workspace_chunk_index * CHUNK_SIZE + local_index] =
+          brush(position);
+    }
+  });
+}
+
+void ReferenceEngine::brush_terrain(bool avx2) {
+  pool.parallel_for(specs->spec_count, [&](daxa_u32 workspace_chunk_index) {
+    Spec spec = specs->spec[workspace_chunk_index];
+    daxa_u32vec3 chunk_position = one_d_to_three_d(
+        spec.chunk_index,
+        daxa_u32vec3{AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+    daxa_i32vec3 region_position = spec.origin;
+
+    daxa_i32vec3 origin = {
+        daxa_i32(AXIS_CHUNK_SIZE * chunk_position.x) +
+            daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * region_position.x,
+        daxa_i32(AXIS_CHUNK_SIZE * chunk_position.y) +
+            daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * region_position.y,
+        daxa_i32(AXIS_CHUNK_SIZE * chunk_position.z) +
+            daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * region_position.z,
+    };
+
+    world_gen_base_chunk(
+        origin, &workspace[workspace_chunk_index * CHUNK_SIZE], avx2);
+  });
+}
+
+void ReferenceEngine::compressor_free(Specs const &specs) {
+  // serial, shader_free() pushes onto the shared free lists
+  for (daxa_u32 i = 0; i < specs.spec_count; i++) {
+    compressor_free_chunk(specs.spec[i]);
+  }
+}
+
+void ReferenceEngine::compressor_free_chunk(Spec spec) {
+  Chunk &chunk =
+      region(volume->region_indices[spec.region_index])
+          .chunks[spec.chunk_index];
+
+  daxa_u32 heap_offset = chunk.heap_offset;
+  chunk.heap_offset = 0;
+  shader_free(heap_offset);
+
+  for (auto &palette : chunk.palettes) {
+    palette.information = VOID;
+  }
+  chunk.palette_count = 0;
+  chunk.index_bits = 0;
+
+  // the chunk owns its 8 bricks, compressor_write() sets them again
+  RegionOccupancy &occupancy =
+      region(volume->region_indices[spec.region_index]).occupancy;
+  daxa_u32vec3 chunk_position = one_d_to_three_d(
+      spec.chunk_index,
+      daxa_u32vec3{AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+  for (daxa_u32 i = 0; i < 8; i++) {
+    daxa_u32vec3 brick = one_d_to_three_d(i, daxa_u32vec3{2, 2, 2});
+    daxa_u32 brick_bit = occupancy_bit(
+        {chunk_position.x * AXIS_CHUNK_SIZE + brick.x * 4,
+         chunk_position.y * AXIS_CHUNK_SIZE + brick.y * 4,
+         chunk_position.z * AXIS_CHUNK_SIZE + brick.z * 4},
+        4);
+    occupancy.voxels[brick_bit * 2] = 0;
+    occupancy.voxels[brick_bit * 2 + 1] = 0;
+    occupancy.bricks[brick_bit / 32] &= ~(1u << (brick_bit % 32));
+  }
+}
+
+void ReferenceEngine::compressor_palettize(Specs const &specs) {
+  pool.parallel_for(specs.spec_count, [&](daxa_u32 workspace_chunk_index) {
+    compressor_palettize_chunk(
+        specs.spec[workspace_chunk_index],
+        &workspace[workspace_chunk_index * CHUNK_SIZE]);
+  });
+}
+
+void ReferenceEngine::compressor_palettize_chunk(Spec spec,
+                                                 daxa_u32 const *voxels) {
+  Chunk &chunk = region_data[volume->region_indices[spec.region_index]]
+                     .chunks[spec.chunk_index];
+
+  // the distinct ids sorted, the palettes COMPRESSOR_PALETTIZE ranks them
+  // into. Chunks hold a handful of ids, a linear search beats a hash here.
+  daxa_u32 ids[CHUNK_SIZE];
+  daxa_u32 id_count = 0;
+  for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+    daxa_u32 information = voxels[local_index];
+
+    if (information != VOID &&
+        std::find(ids, ids + id_count, information) == ids + id_count) {
+      ids[id_count++] = information;
+    }
+  }
+  std::sort(ids, ids + id_count);
+
+  chunk.palette_count = std::min(id_count, daxa_u32(PALETTES_SIZE));
+  for (daxa_u32 palette_id = 0; palette_id < chunk.palette_count;
+       palette_id++) {
+    chunk.palettes[palette_id].information = ids[palette_id];
+  }
+}
+
+void ReferenceEngine::compressor_allocate(Specs const &specs) {
+  // serial in workspace order, the order a GPU retires the 1x1x1 groups in
+  // is unspecified so heap offsets only match an in-order device
+  for (daxa_u32 i = 0; i < specs.spec_count; i++) {
+    compressor_allocate_chunk(specs.spec[i]);
+  }
+}
+
+void ReferenceEngine::compressor_allocate_chunk(Spec spec) {
+  Chunk &chunk =
+      region(volume->region_indices[spec.region_index])
+          .chunks[spec.chunk_index];
+
+  daxa_u32 u32_bits = 32;
+  daxa_u32 index_bits = this->index_bits(chunk.palette_count);
+  daxa_u32 blob_size = (CHUNK_SIZE * index_bits + u32_bits - 1) / u32_bits;
+
+  chunk.heap_offset = shader_malloc(
+      blob_size, ALLOCATOR_OWNER(volume->region_indices[spec.region_index],
+                                 spec.chunk_index));
+  chunk.index_bits = chunk.heap_offset != 0 ? index_bits : 0;
+}
+
+void ReferenceEngine::compressor_occupy(RegionOccupancy &occupancy,
+                                        daxa_u32vec3 position) {
+  daxa_u32 voxel_bit = occupancy_bit(position, 1);
+  if (std::atomic_ref(occupancy.voxels[voxel_bit / 32])
+          .fetch_or(1u << (voxel_bit % 32)) != 0) {
+    return;
+  }
+
+  daxa_u32 brick_bit = occupancy_bit(position, 4);
+  if ((std::atomic_ref(occupancy.bricks[brick_bit / 32])
+           .fetch_or(1u << (brick_bit % 32)) &
+       (1u << (brick_bit % 32))) != 0) {
+    return;
+  }
+
+  daxa_u32 node_bit = occupancy_bit(position, 16);
+  std::atomic_ref(occupancy.nodes[node_bit / 32])
+      .fetch_or(1u << (node_bit % 32));
+}
+
+void ReferenceEngine::compressor_write(Specs const &specs) {
+  pool.parallel_for(specs.spec_count, [&](daxa_u32 workspace_chunk_index) {
+    compressor_write_chunk(specs.spec[workspace_chunk_index],
+                           &workspace[workspace_chunk_index * CHUNK_SIZE]);
+  });
+}
+
+void ReferenceEngine::compressor_write_chunk(Spec spec,
+                                             daxa_u32 const *voxels) {
+  Region &target = region_data[volume->region_indices[spec.region_index]];
+  Chunk const &chunk = target.chunks[spec.chunk_index];
+
+  daxa_u32vec3 chunk_position = one_d_to_three_d(
+      spec.chunk_index,
+      daxa_u32vec3{AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+  for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+    daxa_u32 information = voxels[local_index];
+    if (information == VOID || information == BLOCK_ID_AIR) {
+      continue;
+    }
+
+    daxa_u32vec3 local_position = one_d_to_three_d(
+        local_index,
+        daxa_u32vec3{AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+    compressor_occupy(target.occupancy,
+                      {chunk_position.x * AXIS_CHUNK_SIZE + local_position.x,
+                       chunk_position.y * AXIS_CHUNK_SIZE + local_position.y,
+                       chunk_position.z * AXIS_CHUNK_SIZE + local_position.z});
+  }
+
+  if (chunk.palette_count == 0 || chunk.heap_offset == 0) {
+    return;
+  }
+
+  daxa_u32 u32_bits = 32;
+  daxa_u32 index_bits = chunk.index_bits;
+
+  if (index_bits == 0) {
+    return;
+  }
+
+  // binary search over the sorted palettes, ids without one fall back to the
+  // last palette like the shader's
+  daxa_u32 palette_ids[CHUNK_SIZE];
+  for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+    daxa_u32 information = voxels[local_index];
+    auto palettes_end = chunk.palettes + chunk.palette_count;
+    auto palette = std::lower_bound(
+        chunk.palettes, palettes_end, information,
+        [](Palette const &palette, daxa_u32 information) {
+          return palette.information < information;
+        });
+    daxa_u32 palette_id =
+        palette != palettes_end && palette->information == information
+            ? daxa_u32(palette - chunk.palettes)
+            : chunk.palette_count - 1;
+    palette_ids[local_index] = palette_id;
+  }
+
+  // whole words, plain stores
+  daxa_u32 word_count = CHUNK_SIZE * index_bits / u32_bits;
+  for (daxa_u32 word_index = 0; word_index < word_count; word_index++) {
+    daxa_u32 first_bit = word_index * u32_bits;
+    daxa_u32 word = 0;
+    for (daxa_u32 i = first_bit / index_bits;
+         i * index_bits < first_bit + u32_bits; i++) {
+      daxa_i32 shift = daxa_i32(i * index_bits) - daxa_i32(first_bit);
+      word |= shift >= 0 ? palette_ids[i] << shift : palette_ids[i] >> -shift;
+    }
+    heap[chunk.heap_offset + word_index] = word;
+  }
+}
+
+void ReferenceEngine::compressor_fused(Brush const &brush) {
+  pool.parallel_for(specs->spec_count, [&](daxa_u32 workspace_chunk_index) {
+    Spec spec = specs->spec[workspace_chunk_index];
+    daxa_u32vec3 chunk_position = one_d_to_three_d(
+        spec.chunk_index,
+        daxa_u32vec3{AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+
+    // stands in for the shared memory of the workgroup
+    daxa_u32 voxels[CHUNK_SIZE];
+    for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+      daxa_u32vec3 local_position = one_d_to_three_d(
+          local_index,
+          daxa_u32vec3{AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+      voxels[local_index] = brush({
+          daxa_i32(local_position.x + AXIS_CHUNK_SIZE * chunk_position.x) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * spec.origin.x,
+          daxa_i32(local_position.y + AXIS_CHUNK_SIZE * chunk_position.y) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * spec.origin.y,
+          daxa_i32(local_position.z + AXIS_CHUNK_SIZE * chunk_position.z) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * spec.origin.z,
+      });
+    }
+
+    compressor_palettize_chunk(spec, voxels);
+    // the free lists are shared, the shader takes them with atomics
+    {
+      std::lock_guard lock(allocator_mutex);
+      compressor_allocate_chunk(spec);
+    }
+    compressor_write_chunk(spec, voxels);
+  });
+}
+
+void ReferenceEngine::uniformity(UniSpecs const &unispecs) {
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  daxa_u32 a = axis_region_size / UNIFORMITY_BLOCK_SIZE;
+  daxa_u32 b = UNIFORMITY_BLOCK_SIZE / 4;
+
+  // one task per workgroup of uniformity.glsl, each reads its block once and
+  // merges every level from the one below
+  pool.parallel_for(unispecs.spec_count * a * a * a, [&](daxa_u32 task) {
+    UniSpec spec = unispecs.spec[task / (a * a * a)];
+    if (((spec.block_mask >> (task % (a * a * a))) & 1) == 0) {
+      return;
+    }
+
+    Region &target = region(volume->region_indices[spec.region_index]);
+    daxa_u32vec3 block = one_d_to_three_d(task % (a * a * a), {a, a, a});
+    daxa_u32 *lods[UNIFORMITY_LEVEL_COUNT] = {
+        target.uniformity.lod_x2, target.uniformity.lod_x4,
+        target.uniformity.lod_x8, target.uniformity.lod_x16,
+        target.uniformity.lod_x32};
+
+    // neighbouring blocks share a word, same as the atomics in the shader
+    auto store = [&](daxa_u32 level, daxa_u32vec3 position, daxa_u32 id) {
+      if (id == VOID) {
+        return;
+      }
+      daxa_u32 level_size = axis_region_size >> (level + 1);
+      daxa_u32 i = three_d_to_one_d(position,
+                                    {level_size, level_size, level_size});
+      std::atomic_ref<daxa_u32> word(lods[level][i / 32]);
+      if (id != UNIFORMITY_MIXED) {
+        word.fetch_or(1u << (i % 32));
+      } else {
+        word.fetch_and(~(1u << (i % 32)));
+      }
+    };
+    // merges the 8 children of parent in a level with size^3 blocks
+    auto merge = [](daxa_u32 const *ids, daxa_u32 size, daxa_u32vec3 parent) {
+      daxa_u32 id = 0;
+      for (daxa_u32 i = 0; i < 8; i++) {
+        daxa_u32vec3 offset = one_d_to_three_d(i, {2, 2, 2});
+        daxa_u32 child = ids[three_d_to_one_d(
+            {parent.x * 2 + offset.x, parent.y * 2 + offset.y,
+             parent.z * 2 + offset.z},
+            {size, size, size})];
+        id = i == 0 ? child : uniformity_merge(id, child);
+      }
+      return id;
+    };
+
+    std::vector<daxa_u32> ids_x4(b * b * b);
+    for (daxa_u32 l = 0; l < b * b * b; l++) {
+      daxa_u32vec3 local = one_d_to_three_d(l, {b, b, b});
+      daxa_u32vec3 brick = {block.x * b + local.x, block.y * b + local.y,
+                            block.z * b + local.z};
+      daxa_u32 id_x4 = 0;
+
+      for (daxa_u32 i = 0; i < 8; i++) {
+        daxa_u32vec3 offset = one_d_to_three_d(i, {2, 2, 2});
+        daxa_u32vec3 block_x2 = {brick.x * 2 + offset.x, brick.y * 2 + offset.y,
+                                 brick.z * 2 + offset.z};
+        daxa_u32 id_x2 = 0;
+
+        for (daxa_u32 j = 0; j < 8; j++) {
+          daxa_u32vec3 voxel = one_d_to_three_d(j, {2, 2, 2});
+          daxa_u32 information;
+          query({axis_region_size * target.position.x + block_x2.x * 2 +
+                     voxel.x,
+                 axis_region_size * target.position.y + block_x2.y * 2 +
+                     voxel.y,
+                 axis_region_size * target.position.z + block_x2.z * 2 +
+                     voxel.z},
+                information);
+          id_x2 = j == 0 ? information : uniformity_merge(id_x2, information);
+        }
+
+        store(0, block_x2, id_x2);
+        id_x4 = i == 0 ? id_x2 : uniformity_merge(id_x4, id_x2);
+      }
+
+      store(1, brick, id_x4);
+      ids_x4[l] = id_x4;
+    }
+
+    daxa_u32 ids_x8[64];
+    for (daxa_u32 l = 0; l < 64; l++) {
+      daxa_u32vec3 local = one_d_to_three_d(l, {4, 4, 4});
+      ids_x8[l] = merge(ids_x4.data(), b, local);
+      store(2, {block.x * 4 + local.x, block.y * 4 + local.y,
+                block.z * 4 + local.z},
+            ids_x8[l]);
+    }
+
+    daxa_u32 ids_x16[8];
+    for (daxa_u32 l = 0; l < 8; l++) {
+      daxa_u32vec3 local = one_d_to_three_d(l, {2, 2, 2});
+      ids_x16[l] = merge(ids_x8, 4, local);
+      store(3, {block.x * 2 + local.x, block.y * 2 + local.y,
+                block.z * 2 + local.z},
+            ids_x16[l]);
+    }
+
+    store(4, block, merge(ids_x16, 2, {0, 0, 0}));
+  });
+}
+
+void ReferenceEngine::edit(Edits const &edits) {
+  edit_queue(edits);
+  edit_apply(edits);
+  compressor_free(*edit_specs);
+  compressor_palettize(*edit_specs);
+  compressor_allocate(*edit_specs);
+  compressor_write(*edit_specs);
+  uniformity(*edit_unispecs);
+}
+
+void ReferenceEngine::edit_queue(Edits const &edits) {
+  daxa_u32 a = (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE) / UNIFORMITY_BLOCK_SIZE;
+
+  edit_specs->spec_count = 0;
+  edit_specs->visible_region_count = 0;
+  edit_unispecs->spec_count = 0;
+
+  // chunks are listed in edit order, the same set as edit.glsl lists with
+  // atomics, only the workspace order differs
+  std::vector<bool> known(VIEW_SIZE * REGION_SIZE);
+  std::vector<daxa_u32> block_masks(VIEW_SIZE);
+
+  for (daxa_u32 edit_index = 0; edit_index < edits.edit_count; edit_index++) {
+    Edit const &edit = edits.edit[edit_index];
+    daxa_u32vec3 minimum = edit_chunk_minimum(edit);
+    daxa_u32vec3 maximum = edit_chunk_maximum(edit);
+
+    for (daxa_u32 i = 0; i < edit_chunk_count(edit); i++) {
+      daxa_u32vec3 chunk = one_d_to_three_d(
+          i, {maximum.x - minimum.x, maximum.y - minimum.y,
+              maximum.z - minimum.z});
+      chunk = {minimum.x + chunk.x, minimum.y + chunk.y, minimum.z + chunk.z};
+      daxa_u32vec3 region_position = {chunk.x / AXIS_REGION_SIZE,
+                                      chunk.y / AXIS_REGION_SIZE,
+                                      chunk.z / AXIS_REGION_SIZE};
+
+      if (!view_contains(volume->window_origin, region_position)) {
+        continue;
+      }
+
+      daxa_u32 cell_index = view_cell_index(region_position);
+      daxa_u32 slot = volume->region_indices[cell_index];
+      daxa_u32vec3 chunk_position = {chunk.x % AXIS_REGION_SIZE,
+                                     chunk.y % AXIS_REGION_SIZE,
+                                     chunk.z % AXIS_REGION_SIZE};
+      daxa_u32 chunk_index = three_d_to_one_d(
+          chunk_position,
+          {AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+
+      if (slot == 0 || chunk_index >= region(slot).chunk_count ||
+          known[cell_index * REGION_SIZE + chunk_index]) {
+        continue;
+      }
+
+      known[cell_index * REGION_SIZE + chunk_index] = true;
+      edit_specs->spec[edit_specs->spec_count++] = Spec{
+          .region_index = cell_index,
+          .chunk_index = chunk_index,
+          .origin = {daxa_i32(region_position.x), daxa_i32(region_position.y),
+                     daxa_i32(region_position.z)},
+      };
+
+      if (region(slot).uniformity_queued != 0) {
+        daxa_u32vec3 block = {
+            chunk_position.x * AXIS_CHUNK_SIZE / UNIFORMITY_BLOCK_SIZE,
+            chunk_position.y * AXIS_CHUNK_SIZE / UNIFORMITY_BLOCK_SIZE,
+            chunk_position.z * AXIS_CHUNK_SIZE / UNIFORMITY_BLOCK_SIZE};
+        block_masks[cell_index] |= 1u << three_d_to_one_d(block, {a, a, a});
+      }
+    }
+  }
+
+  for (daxa_u32 cell_index = 0; cell_index < VIEW_SIZE; cell_index++) {
+    if (block_masks[cell_index] != 0) {
+      edit_unispecs->spec[edit_unispecs->spec_count++] = {
+          .region_index = cell_index,
+          .block_mask = block_masks[cell_index],
+      };
+    }
+  }
+}
+
+void ReferenceEngine::edit_apply(Edits const &edits) {
+  Specs const &specs = *edit_specs;
+  pool.parallel_for(specs.spec_count, [&](daxa_u32 workspace_chunk_index) {
+    Spec spec = specs.spec[workspace_chunk_index];
+    daxa_u32vec3 chunk_position = one_d_to_three_d(
+        spec.chunk_index,
+        daxa_u32vec3{AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+
+    for (daxa_u32 local_index = 0; local_index < CHUNK_SIZE; local_index++) {
+      daxa_u32vec3 local_position = one_d_to_three_d(
+          local_index,
+          daxa_u32vec3{AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+
+      daxa_i32vec3 position = {
+          daxa_i32(local_position.x + AXIS_CHUNK_SIZE * chunk_position.x) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * spec.origin.x,
+          daxa_i32(local_position.y + AXIS_CHUNK_SIZE * chunk_position.y) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * spec.origin.y,
+          daxa_i32(local_position.z + AXIS_CHUNK_SIZE * chunk_position.z) +
+              daxa_i32(AXIS_CHUNK_SIZE * AXIS_REGION_SIZE) * spec.origin.z,
+      };
+
+      daxa_u32 information;
+      query({daxa_u32(position.x), daxa_u32(position.y), daxa_u32(position.z)},
+            information);
+
+      for (daxa_u32 edit_index = 0; edit_index < edits.edit_count;
+           edit_index++) {
+        if (edit_contains(edits.edit[edit_index], position)) {
+          information = edits.edit[edit_index].block_id;
+        }
+      }
+
+      workspace[workspace_chunk_index * CHUNK_SIZE + local_index] =
+          information;
+    }
+  });
+}
+
+daxa_u32 ReferenceEngine::region_slot(daxa_u32vec3 region_position) const {
+  if (!info.region_hash) {
+    return view_contains(volume->window_origin, region_position)
+               ? volume->region_indices[view_cell_index(region_position)]
+               : 0;
+  }
+
+  daxa_u32 entry_index = volume_hash_start(region_position);
+  for (daxa_u32 probe = 0; probe < VOLUME_HASH_SIZE; probe++) {
+    VolumeHashEntry const &entry = volume->region_hash[entry_index];
+    if (entry.slot == 0 || (entry.position.x == region_position.x &&
+                            entry.position.y == region_position.y &&
+                            entry.position.z == region_position.z)) {
+      return entry.slot;
+    }
+    entry_index = (entry_index + 1) & (VOLUME_HASH_SIZE - 1);
+  }
+  return 0;
+}
+
+bool ReferenceEngine::query(daxa_u32vec3 position,
+                            daxa_u32 &information) const {
+  information = 0;
+
+  daxa_u32 local_index = three_d_to_one_d(
+      {position.x % AXIS_CHUNK_SIZE, position.y % AXIS_CHUNK_SIZE,
+       position.z % AXIS_CHUNK_SIZE},
+      {AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE, AXIS_CHUNK_SIZE});
+  daxa_u32 chunk_index = three_d_to_one_d(
+      {(position.x / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE,
+       (position.y / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE,
+       (position.z / AXIS_CHUNK_SIZE) % AXIS_REGION_SIZE},
+      {AXIS_REGION_SIZE, AXIS_REGION_SIZE, AXIS_REGION_SIZE});
+  daxa_u32 axis_region_size = AXIS_CHUNK_SIZE * AXIS_REGION_SIZE;
+  daxa_u32 region_index =
+      region_slot({position.x / axis_region_size, position.y / axis_region_size,
+                   position.z / axis_region_size});
+
+  if (region_index >= region_data.size()) {
+    return false;
+  }
+
+  Chunk const &chunk = region_data[region_index].chunks[chunk_index];
+
+  daxa_u32 u32_bits = 32;
+  daxa_u32 index_bits = chunk.index_bits;
+
+  daxa_u32 palette_id = 0;
+
+  if (index_bits != 0) {
+    daxa_u32 bit_index = local_index * index_bits;
+    daxa_u32 heap_offset = chunk.heap_offset + bit_index / u32_bits;
+    daxa_u32 bit_offset = bit_index % u32_bits;
+
+    daxa_u32 low = heap_word(heap_offset);
+    daxa_u32 high = 0;
+    if (bit_offset + index_bits > u32_bits) {
+      high = heap_word(heap_offset + 1);
+    }
+
+    palette_id = palette_index_extract(low, high, bit_offset, index_bits);
+  }
+
+  if (palette_id >= PALETTES_SIZE) {
+    return false;
+  }
+
+  information = chunk.palettes[palette_id].information;
+
+  return information != 0;
+}
+
+daxa_u32 ReferenceEngine::sample_lod(daxa_u32vec3 position) const {
+  daxa_u32 information;
+  if (query(position, information) && information != BLOCK_ID_AIR) {
+    return 0;
+  }
+
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  daxa_u32 region_index = region_slot(
+      {position.x / axis_region_size, position.y / axis_region_size,
+       position.z / axis_region_size});
+  if (region_index == 0 || region_index >= region_data.size()) {
+    return 6;
+  }
+
+  Region const &target = region_data[region_index];
+  daxa_u32 const *lods[5] = {target.uniformity.lod_x2, target.uniformity.lod_x4,
+                             target.uniformity.lod_x8, target.uniformity.lod_x16,
+                             target.uniformity.lod_x32};
+
+  for (daxa_u32 level = 5; level > 0; level--) {
+    daxa_u32 uniformity_size = 1u << level;
+    daxa_u32 a = axis_region_size / uniformity_size;
+    daxa_u32 i = three_d_to_one_d(
+        {position.x % axis_region_size / uniformity_size,
+         position.y % axis_region_size / uniformity_size,
+         position.z % axis_region_size / uniformity_size},
+        {a, a, a});
+    if (((lods[level - 1][i / 32] >> (i % 32)) & 1) != 0) {
+      return level;
+    }
+  }
+  return 0;
+}
+
+daxa_u32 ReferenceEngine::sample_occupancy(daxa_u32vec3 position) const {
+  daxa_u32 axis_region_size = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE;
+  daxa_u32 region_index = region_slot(
+      {position.x / axis_region_size, position.y / axis_region_size,
+       position.z / axis_region_size});
+
+  if (region_index == 0 || region_index >= region_data.size()) {
+    return axis_region_size;
+  }
+
+  RegionOccupancy const &occupancy = region_data[region_index].occupancy;
+  daxa_u32vec3 p = {position.x % axis_region_size,
+                    position.y % axis_region_size,
+                    position.z % axis_region_size};
+
+  daxa_u32 bit = occupancy_bit(p, 16);
+  if (((occupancy.nodes[bit / 32] >> (bit % 32)) & 1) == 0) {
+    return 16;
+  }
+  bit = occupancy_bit(p, 4);
+  if (((occupancy.bricks[bit / 32] >> (bit % 32)) & 1) == 0) {
+    return 4;
+  }
+  bit = occupancy_bit(p, 1);
+  if (((occupancy.voxels[bit / 32] >> (bit % 32)) & 1) == 0) {
+    return 1;
+  }
+  return 0;
+}
+
+ReferenceRay ReferenceEngine::ray_cast(daxa_f32vec3 origin,
+                                       daxa_f32vec3 direction,
+                                       daxa_i32vec3 minimum,
+                                       daxa_i32vec3 maximum,
+                                       bool uniformity) const {
+  // desc.max_dist in raytrace.glsl
+  daxa_f32 max_dist = 1000;
+
+  daxa_f32 length = std::sqrt(direction.x * direction.x +
+                              direction.y * direction.y +
+                              direction.z * direction.z);
+  daxa_f32 d[3] = {direction.x / length, direction.y / length,
+                   direction.z / length};
+  daxa_f32 position[3] = {origin.x, origin.y, origin.z};
+  daxa_i32 low[3] = {minimum.x, minimum.y, minimum.z};
+  daxa_i32 high[3] = {maximum.x, maximum.y, maximum.z};
+  daxa_f32 delta_dist[3], step[3], step01[3];
+  for (daxa_u32 i = 0; i < 3; i++) {
+    delta_dist[i] = 1.0f / d[i];
+    step[i] = daxa_f32((d[i] > 0) - (d[i] < 0));
+    step01[i] = std::max(step[i], 0.0f);
+  }
+  daxa_f32 dist = 0;
+  daxa_u32 step_count = 0;
+
+  auto inside = [&](daxa_i32 margin) {
+    for (daxa_u32 i = 0; i < 3; i++) {
+      daxa_i32 p = daxa_i32(position[i]);
+      if (p < low[i] - margin || p >= high[i] + margin) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto voxel = [&]() {
+    return daxa_u32vec3{daxa_u32(daxa_i32(position[0])),
+                        daxa_u32(daxa_i32(position[1])),
+                        daxa_u32(daxa_i32(position[2]))};
+  };
+
+  ReferenceRay ray;
+  while (ray.state_id == RAY_STATE_INITIAL) {
+    // ray_cast_check_over_count() runs twice per iteration, as in rtx.inl
+    if (step_count++ > MAX_STEP_COUNT) {
+      ray.state_id = RAY_STATE_MAX_STEP_REACHED;
+      break;
+    }
+    if (dist > max_dist) {
+      ray.state_id = RAY_STATE_MAX_DIST_REACHED;
+      break;
+    }
+    if (!inside(10)) {
+      ray.state_id = RAY_STATE_OUT_OF_BOUNDS;
+      break;
+    }
+    if (step_count++ > MAX_STEP_COUNT) {
+      ray.state_id = RAY_STATE_MAX_STEP_REACHED;
+      break;
+    }
+
+    // ray_cast_check_success()
+    auto check_success = [&]() {
+      daxa_u32 information;
+      if (inside(0) && query(voxel(), information) &&
+          information != BLOCK_ID_AIR) {
+        ray.state_id = RAY_STATE_VOXEL_FOUND;
+        ray.block_id = information;
+        return true;
+      }
+      return false;
+    };
+
+    daxa_u32 cell_size;
+    if (uniformity) {
+      if (check_success()) {
+        break;
+      }
+      cell_size = 1u << (inside(0) ? sample_lod(voxel()) : 0);
+    } else {
+      cell_size = sample_occupancy(voxel());
+      if (cell_size == 0 && check_success()) {
+        break;
+      }
+    }
+    daxa_f32 size = daxa_f32(std::max(cell_size, 1u));
+
+    // ray_cast_body()
+    daxa_f32 t_max[3];
+    for (daxa_u32 i = 0; i < 3; i++) {
+      t_max[i] = delta_dist[i] *
+                 (size * step01[i] -
+                  (position[i] - size * std::floor(position[i] / size)));
+    }
+    bool mask[3];
+    for (daxa_u32 i = 0; i < 3; i++) {
+      mask[i] = t_max[i] <= std::min(t_max[(i + 1) % 3], t_max[(i + 2) % 3]);
+    }
+    daxa_f32 c_dist = std::min(std::min(t_max[0], t_max[1]), t_max[2]);
+    for (daxa_u32 i = 0; i < 3; i++) {
+      position[i] += c_dist * d[i];
+      position[i] += 4e-4f * step[i] * daxa_f32(mask[i]);
+    }
+    dist += c_dist;
+    ray.step_count++;
+  }
+
+  ray.voxel = {daxa_i32(position[0]), daxa_i32(position[1]),
+               daxa_i32(position[2])};
+  return ray;
+}
@@ -0,0 +1,218 @@
+#include <hexane/terrain.hpp>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TERRAIN_AVX2
+#endif
+
+#ifdef TERRAIN_AVX2
+#include <immintrin.h>
+
+// Only these functions are compiled for AVX2, the rest of the build keeps
+// running on CPUs without it.
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+namespace {
+
+// AXIS_CHUNK_SIZE lanes of the shared code in util.inl and terrain.inl
+static_assert(AXIS_CHUNK_SIZE == 8);
+
+AVX2_TARGET __m256i hash_x8(__m256i x) {
+  x = _mm256_add_epi32(x, _mm256_slli_epi32(x, 10));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 6));
+  x = _mm256_add_epi32(x, _mm256_slli_epi32(x, 3));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 11));
+  x = _mm256_add_epi32(x, _mm256_slli_epi32(x, 15));
+  return x;
+}
+
+AVX2_TARGET __m256 float_construct_x8(__m256i x) {
+  x = _mm256_and_si256(x, _mm256_set1_epi32(0x007FFFFF));
+  x = _mm256_or_si256(x, _mm256_set1_epi32(0x3F800000));
+  return _mm256_sub_ps(_mm256_castsi256_ps(x), _mm256_set1_ps(1.0f));
+}
+
+// random(daxa_f32vec4) with w the same in every lane
+AVX2_TARGET __m256 random_x8(__m256 x, __m256 y, __m256 z, daxa_f32 w) {
+  __m256i h = _mm256_castps_si256(x);
+  h = _mm256_xor_si256(h, hash_x8(_mm256_castps_si256(y)));
+  h = _mm256_xor_si256(h, hash_x8(_mm256_castps_si256(z)));
+  h = _mm256_xor_si256(h, _mm256_set1_epi32(daxa_i32(hash(bitcast(w)))));
+  return float_construct_x8(hash_x8(h));
+}
+
+AVX2_TARGET __m256 madd_x8(daxa_f32 c, __m256 x2, __m256 s) {
+  return _mm256_add_ps(_mm256_set1_ps(c), _mm256_mul_ps(x2, s));
+}
+
+AVX2_TARGET __m256 noise_sin_x8(__m256 x) {
+  __m256 x2 = _mm256_mul_ps(x, x);
+  __m256 s = _mm256_set1_ps(2.75573188e-06f);
+  s = madd_x8(-0.000198412701f, x2, s);
+  s = madd_x8(0.00833333377f, x2, s);
+  s = madd_x8(-0.166666672f, x2, s);
+  s = madd_x8(1.0f, x2, s);
+  return _mm256_mul_ps(x, s);
+}
+
+AVX2_TARGET __m256 noise_cos_x8(__m256 x) {
+  __m256 x2 = _mm256_mul_ps(x, x);
+  __m256 c = _mm256_set1_ps(-2.755732e-07f);
+  c = madd_x8(2.48015876e-05f, x2, c);
+  c = madd_x8(-0.00138888892f, x2, c);
+  c = madd_x8(0.0416666679f, x2, c);
+  c = madd_x8(-0.5f, x2, c);
+  c = madd_x8(1.0f, x2, c);
+  return c;
+}
+
+AVX2_TARGET __m256 noise_mix_x8(__m256 a, __m256 b, __m256 t) {
+  return _mm256_add_ps(
+      _mm256_mul_ps(a, _mm256_sub_ps(_mm256_set1_ps(1.0f), t)),
+      _mm256_mul_ps(b, t));
+}
+
+struct Vec3x8 {
+  __m256 x;
+  __m256 y;
+  __m256 z;
+};
+
+struct IVec3x8 {
+  __m256i x;
+  __m256i y;
+  __m256i z;
+};
+
+AVX2_TARGET __m256 dot_grid_gradient_x8(IVec3x8 i, Vec3x8 p, daxa_u32 seed) {
+  Vec3x8 lattice = {_mm256_cvtepi32_ps(i.x), _mm256_cvtepi32_ps(i.y),
+                    _mm256_cvtepi32_ps(i.z)};
+  __m256 alpha = random_x8(lattice.x, lattice.y, lattice.z, daxa_f32(seed));
+  __m256 beta =
+      random_x8(lattice.x, lattice.y, lattice.z, daxa_f32(seed + 1));
+
+  __m256 cos_beta = noise_cos_x8(beta);
+  Vec3x8 gradient = {_mm256_mul_ps(noise_cos_x8(alpha), cos_beta),
+                     noise_sin_x8(beta),
+                     _mm256_mul_ps(noise_sin_x8(alpha), cos_beta)};
+
+  __m256 d = _mm256_add_ps(
+      _mm256_mul_ps(gradient.x, _mm256_sub_ps(p.x, lattice.x)),
+      _mm256_mul_ps(gradient.y, _mm256_sub_ps(p.y, lattice.y)));
+  return _mm256_add_ps(
+      d, _mm256_mul_ps(gradient.z, _mm256_sub_ps(p.z, lattice.z)));
+}
+
+AVX2_TARGET IVec3x8 noise_corner_x8(IVec3x8 m0, IVec3x8 m1,
+                                    daxa_u32 corner) {
+  return {(corner & 1u) != 0 ? m1.x : m0.x, (corner & 2u) != 0 ? m1.y : m0.y,
+          (corner & 4u) != 0 ? m1.z : m0.z};
+}
+
+AVX2_TARGET __m256 perlin_x8(Vec3x8 position, daxa_u32 seed) {
+  IVec3x8 m0 = {_mm256_cvttps_epi32(_mm256_floor_ps(position.x)),
+                _mm256_cvttps_epi32(_mm256_floor_ps(position.y)),
+                _mm256_cvttps_epi32(_mm256_floor_ps(position.z))};
+  __m256i one = _mm256_set1_epi32(1);
+  IVec3x8 m1 = {_mm256_add_epi32(m0.x, one), _mm256_add_epi32(m0.y, one),
+                _mm256_add_epi32(m0.z, one)};
+  Vec3x8 s = {_mm256_sub_ps(position.x, _mm256_cvtepi32_ps(m0.x)),
+              _mm256_sub_ps(position.y, _mm256_cvtepi32_ps(m0.y)),
+              _mm256_sub_ps(position.z, _mm256_cvtepi32_ps(m0.z))};
+
+  // corners in the same order as perlin() in util.inl
+  __m256 n[8];
+  for (daxa_u32 corner = 0; corner < 8; corner++) {
+    n[corner] = dot_grid_gradient_x8(noise_corner_x8(m0, m1, corner),
+                                     position, seed);
+  }
+
+  __m256 jx0 = noise_mix_x8(noise_mix_x8(n[0], n[1], s.x),
+                            noise_mix_x8(n[2], n[3], s.x), s.y);
+  __m256 jx1 = noise_mix_x8(noise_mix_x8(n[4], n[5], s.x),
+                            noise_mix_x8(n[6], n[7], s.x), s.y);
+  return noise_mix_x8(jx0, jx1, s.z);
+}
+
+AVX2_TARGET void world_gen_density_row_avx2(daxa_i32vec3 position,
+                                            daxa_f32 *density) {
+  // the parameters of world_gen_density() in terrain.inl
+  daxa_u32 seed = 400;
+  daxa_u32 octaves = 10;
+  daxa_f32 lacunarity = 2.0f;
+  daxa_f32 gain = 0.5f;
+  daxa_f32 amplitude = 1.0f;
+  daxa_f32 frequency = 0.05f;
+  daxa_f32 height_offset = 30.0f;
+  daxa_f32 squashing_factor = 0.02f;
+
+  Vec3x8 world_position = {
+      _mm256_cvtepi32_ps(
+          _mm256_add_epi32(_mm256_set1_epi32(position.x),
+                           _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))),
+      _mm256_set1_ps(daxa_f32(position.y)),
+      _mm256_set1_ps(daxa_f32(position.z))};
+
+  __m256 height = _mm256_setzero_ps();
+
+  for (daxa_u32 i = 0; i < octaves; i++) {
+    __m256 f = _mm256_set1_ps(frequency);
+    Vec3x8 octave_position = {_mm256_mul_ps(f, world_position.x),
+                              _mm256_mul_ps(f, world_position.y),
+                              _mm256_mul_ps(f, world_position.z)};
+    height = _mm256_add_ps(
+        height, _mm256_mul_ps(_mm256_set1_ps(amplitude),
+                              perlin_x8(octave_position, seed)));
+    frequency *= lacunarity;
+    amplitude *= gain;
+  }
+
+  // max and min pick 0 and 1 in the same cases as the ternaries
+  __m256 alpha = _mm256_max_ps(height, _mm256_setzero_ps());
+  alpha = _mm256_min_ps(alpha, _mm256_set1_ps(1.0f));
+
+  daxa_f32 falloff = (daxa_f32(position.z) - height_offset) * squashing_factor;
+
+  _mm256_storeu_ps(density, _mm256_sub_ps(alpha, _mm256_set1_ps(falloff)));
+}
+
+} // namespace
+#endif
+
+bool terrain_avx2_supported() {
+#ifdef TERRAIN_AVX2
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+void world_gen_density_row(daxa_i32vec3 position, daxa_f32 *density,
+                           bool avx2) {
+#ifdef TERRAIN_AVX2
+  if (avx2 && terrain_avx2_supported()) {
+    world_gen_density_row_avx2(position, density);
+    return;
+  }
+#endif
+
+  for (daxa_u32 x = 0; x < AXIS_CHUNK_SIZE; x++) {
+    density[x] =
+        world_gen_density({position.x + daxa_i32(x), position.y, position.z});
+  }
+}
+
+void world_gen_base_chunk(daxa_i32vec3 origin, daxa_u32 *voxels, bool avx2) {
+  for (daxa_u32 z = 0; z < AXIS_CHUNK_SIZE; z++) {
+    for (daxa_u32 y = 0; y < AXIS_CHUNK_SIZE; y++) {
+      daxa_f32 density[AXIS_CHUNK_SIZE];
+      world_gen_density_row(
+          {origin.x, origin.y + daxa_i32(y), origin.z + daxa_i32(z)}, density,
+          avx2);
+
+      daxa_u32 *row = voxels + (z * AXIS_CHUNK_SIZE + y) * AXIS_CHUNK_SIZE;
+      for (daxa_u32 x = 0; x < AXIS_CHUNK_SIZE; x++) {
+        row[x] = density[x] > 0.0f ? BLOCK_ID_STONE : BLOCK_ID_AIR;
+      }
+    }
+  }
+}
@@ -9,105 +9,172 @@ layout(push_constant, scalar) uniform Push
     UniformityPush push;
 };
 
+//every invocation reads a 4^3 brick, so a workgroup covers one
+//UNIFORMITY_BLOCK_SIZE block
+#define UNIFORMITY_INVOKE_SIZE (UNIFORMITY_BLOCK_SIZE / 4)
+
 layout(
-    local_size_x = UNIFORMITY_INVOKE_SIZE, 
-    local_size_y = UNIFORMITY_INVOKE_SIZE, 
+    local_size_x = UNIFORMITY_INVOKE_SIZE,
+    local_size_y = UNIFORMITY_INVOKE_SIZE,
     local_size_z = UNIFORMITY_INVOKE_SIZE
 ) in;
 
-shared daxa_u32 block_id;
-shared daxa_u32 is_uniform;
+//block ids of the x4, x8 and x16 levels of the workgroup's block
+shared daxa_u32 ids_x4[UNIFORMITY_INVOKE_SIZE * UNIFORMITY_INVOKE_SIZE * UNIFORMITY_INVOKE_SIZE];
+shared daxa_u32 ids_x8[64];
+shared daxa_u32 ids_x16[8];
+
+//sets the bit of a block that holds one id, clears it for a mixed one and
+//leaves blocks of void alone
+void uniformity_store(daxa_u32 region_index, daxa_u32 level, daxa_u32vec3 block, daxa_u32 id) {
+    if(id == VOID) {
+        return;
+    }
+
+    daxa_u32 a = (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE) >> (level + 1);
+    daxa_u32 i = three_d_to_one_d(block, daxa_u32vec3(a));
+    daxa_u32 u32_bits = 32;
+    daxa_u32 j = i / u32_bits;
+    daxa_u32 k = i % u32_bits;
+    bool is_uniform = id != UNIFORMITY_MIXED;
+
+    if(level == 0) {
+        if(is_uniform) {
+            atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x2[j], 1 << k);
+        } else {
+            atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x2[j], ~(1 << k));
+        }
+    }
+    if(level == 1) {
+        if(is_uniform) {
+            atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x4[j], 1 << k);
+        } else {
+            atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x4[j], ~(1 << k));
+        }
+    }
+    if(level == 2) {
+        if(is_uniform) {
+            atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x8[j], 1 << k);
+        } else {
+            atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x8[j], ~(1 << k));
+        }
+    }
+    if(level == 3) {
+        if(is_uniform) {
+            atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x16[j], 1 << k);
+        } else {
+            atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x16[j], ~(1 << k));
+        }
+    }
+    if(level == 4) {
+        if(is_uniform) {
+            atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x32[j], 1 << k);
+        } else {
+            atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x32[j], ~(1 << k));
+        }
+    }
+}
 
+//Dispatched indirectly from QueueDispatch::uniformity with one workgroup per
+//UNIFORMITY_BLOCK_SIZE block, the blocks of the regions in unispecs are stacked
+//along z so one dispatch covers every region queued this frame. The region is
+//read once, lod_x2 and lod_x4 come from the brick of every invocation and each
+//level after that is merged from 8 blocks of the one below in shared memory.
 void main() {
-	daxa_u32 region_index = deref(deref(push.unispecs).volume).region_indices[deref(push.unispecs).spec[0].region_index];
+    daxa_u32 a = (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE) / UNIFORMITY_BLOCK_SIZE;
+    daxa_u32 spec_index = gl_WorkGroupID.z / a;
+    daxa_u32vec3 block = daxa_u32vec3(gl_WorkGroupID.xy, gl_WorkGroupID.z % a);
+
+    UniSpec spec = deref(push.unispecs).spec[spec_index];
 
-    if(deref(push.unispecs).spec_count != 1) {
+    //edits only rebuild the blocks around the chunks they changed
+    if(((spec.block_mask >> three_d_to_one_d(block, daxa_u32vec3(a))) & 1) == 0) {
         return;
     }
 
-    daxa_u32 axis_region_in_world = AXIS_WORLD_SIZE / (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE);
-    daxa_u32vec3 origin = one_d_to_three_d(deref(push.unispecs).spec[0].region_index, daxa_u32vec3(axis_region_in_world));
+	daxa_u32 region_index = deref(deref(push.unispecs).volume).region_indices[spec.region_index];
+
+    daxa_u32vec3 origin = deref(deref(push.regions).data[region_index]).position;
 
     daxa_u32vec3 block_origin = AXIS_REGION_SIZE * AXIS_CHUNK_SIZE * origin;
 
-    Query q; 
+    Query q;
     q.volume = deref(push.unispecs).volume;
     q.allocator = push.allocator;
     q.regions = push.regions;
-    q.position = daxa_i32vec3(gl_GlobalInvocationID + block_origin);
 
-    if(all(equal(gl_LocalInvocationID, daxa_u32vec3(0)))) {
-        query(q);
+    //brick of this invocation, in x4 blocks of the region
+    daxa_u32vec3 brick = block * UNIFORMITY_INVOKE_SIZE + gl_LocalInvocationID;
+
+    daxa_u32 id_x4 = 0;
+
+    for(daxa_u32 i = 0; i < 8; i++) {
+        daxa_u32vec3 block_x2 = brick * 2 + one_d_to_three_d(i, daxa_u32vec3(2));
+        daxa_u32 id_x2 = 0;
 
-        block_id = q.information;
-        is_uniform = 1;
+        for(daxa_u32 j = 0; j < 8; j++) {
+            q.position = daxa_i32vec3(block_origin + block_x2 * 2 + one_d_to_three_d(j, daxa_u32vec3(2)));
+            query(q);
+
+            id_x2 = j == 0 ? q.information : uniformity_merge(id_x2, q.information);
+        }
+
+        uniformity_store(region_index, 0, block_x2, id_x2);
+
+        id_x4 = i == 0 ? id_x2 : uniformity_merge(id_x4, id_x2);
     }
 
+    uniformity_store(region_index, 1, brick, id_x4);
+
+    ids_x4[gl_LocalInvocationIndex] = id_x4;
+
     barrier();
 
-    if(block_id == VOID) {
-        return;
-    }
+    daxa_u32 invocation = gl_LocalInvocationIndex;
 
-    daxa_u32 l = UNIFORMITY_SIZE / UNIFORMITY_INVOKE_SIZE;
+    if(invocation < 64) {
+        daxa_u32vec3 local_x8 = one_d_to_three_d(invocation, daxa_u32vec3(4));
+        daxa_u32 id_x8 = 0;
 
-    for(daxa_u32 x = 0; x < l && bool(is_uniform); x++) {
-        for(daxa_u32 y = 0; y < l && bool(is_uniform); y++) {
-            for(daxa_u32 z = 0; z < l && bool(is_uniform); z++) {
-                q.position = daxa_i32vec3(gl_GlobalInvocationID + block_origin) * l + daxa_i32vec3(daxa_u32vec3(x, y, z));
-                query(q);
+        for(daxa_u32 i = 0; i < 8; i++) {
+            daxa_u32vec3 child = local_x8 * 2 + one_d_to_three_d(i, daxa_u32vec3(2));
+            daxa_u32 id = ids_x4[three_d_to_one_d(child, daxa_u32vec3(UNIFORMITY_INVOKE_SIZE))];
 
-                if(q.information != block_id) {
-                    atomicExchange(is_uniform, 0);
-                    break;
-                }
-            }
+            id_x8 = i == 0 ? id : uniformity_merge(id_x8, id);
         }
+
+        uniformity_store(region_index, 2, block * 4 + local_x8, id_x8);
+
+        ids_x8[invocation] = id_x8;
     }
 
     barrier();
 
-    if(all(equal(gl_LocalInvocationID, daxa_u32vec3(0)))) {
-        daxa_u32 a = (AXIS_REGION_SIZE * AXIS_CHUNK_SIZE) / UNIFORMITY_SIZE;
-        daxa_u32 i = three_d_to_one_d(gl_GlobalInvocationID / UNIFORMITY_SIZE % a, daxa_u32vec3(a));
-        daxa_u32 u32_bits = 32;   
-        daxa_u32 j = i / u32_bits;
-        daxa_u32 k = i % u32_bits;
-
-        if(UNIFORMITY_SIZE == 2) {
-            if(bool(is_uniform)) {
-                atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x2[j], 1 << k);
-            } else {
-                atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x2[j], ~(1 << k));
-            }
-        }
-        if(UNIFORMITY_SIZE == 4) {
-            if(bool(is_uniform)) {
-                atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x4[j], 1 << k);
-            } else {
-                atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x4[j], ~(1 << k));
-            }
-        }
-        if(UNIFORMITY_SIZE == 8) {
-            if(bool(is_uniform)) {
-                atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x8[j], 1 << k);
-            } else {
-                atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x8[j], ~(1 << k));
-            }
-        }
-        if(UNIFORMITY_SIZE == 16) {
-            if(bool(is_uniform)) {
-                atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x16[j], 1 << k);
-            } else {
-                atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x16[j], ~(1 << k));
-            }
+    if(invocation < 8) {
+        daxa_u32vec3 local_x16 = one_d_to_three_d(invocation, daxa_u32vec3(2));
+        daxa_u32 id_x16 = 0;
+
+        for(daxa_u32 i = 0; i < 8; i++) {
+            daxa_u32vec3 child = local_x16 * 2 + one_d_to_three_d(i, daxa_u32vec3(2));
+            daxa_u32 id = ids_x8[three_d_to_one_d(child, daxa_u32vec3(4))];
+
+            id_x16 = i == 0 ? id : uniformity_merge(id_x16, id);
         }
-        if(UNIFORMITY_SIZE == 32) {
-            if(bool(is_uniform)) {
-                atomicOr(deref(deref(push.regions).data[region_index]).uniformity.lod_x32[j], 1 << k);
-            } else {
-                atomicAnd(deref(deref(push.regions).data[region_index]).uniformity.lod_x32[j], ~(1 << k));
-            }
+
+        uniformity_store(region_index, 3, block * 2 + local_x16, id_x16);
+
+        ids_x16[invocation] = id_x16;
+    }
+
+    barrier();
+
+    if(invocation == 0) {
+        daxa_u32 id_x32 = ids_x16[0];
+
+        for(daxa_u32 i = 1; i < 8; i++) {
+            id_x32 = uniformity_merge(id_x32, ids_x16[i]);
         }
+
+        uniformity_store(region_index, 4, block, id_x32);
     }
 }
@@ -0,0 +1,49 @@
+#include "upload_ring.hpp"
+
+#include "benchmark.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+UploadRing::UploadRing(UploadRingInfo const &info) : info(info) {
+  buffer = benchmark_create_buffer(
+      this->info.device,
+      {
+          .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
+          .size = info.frame_count * info.frame_size,
+          .debug_name = "upload ring",
+      });
+  host_address = this->info.device.get_host_address_as<daxa::u8>(buffer);
+}
+
+UploadRing::~UploadRing() { info.device.destroy_buffer(buffer); }
+
+void UploadRing::begin_frame() {
+  frame_index = (frame_index + 1) % info.frame_count;
+  frame_offset = 0;
+}
+
+void UploadRing::upload(daxa::CommandList &cmd_list, void const *data,
+                        daxa_u32 size, daxa::BufferId dst_buffer,
+                        daxa_u32 dst_offset) {
+  // keeps every upload 16 byte aligned
+  daxa_u32 aligned_size = (size + 15) & ~daxa_u32(15);
+  if (frame_offset + aligned_size > info.frame_size) {
+    throw std::runtime_error("upload ring slot of " +
+                             std::to_string(info.frame_size) +
+                             " bytes is full");
+  }
+
+  daxa_u32 src_offset = frame_index * info.frame_size + frame_offset;
+  std::memcpy(host_address + src_offset, data, size);
+  frame_offset += aligned_size;
+
+  cmd_list.copy_buffer_to_buffer({
+      .src_buffer = buffer,
+      .src_offset = src_offset,
+      .dst_buffer = dst_buffer,
+      .dst_offset = dst_offset,
+      .size = size,
+  });
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+
+#include <hexane/shared.inl>
+
+// Persistently mapped staging memory for every host to device write of a
+// frame. Each frame bumps through its own slot of the ring, and the GPU is
+// done reading a slot by the time the ring wraps around to it, so nothing is
+// created or destroyed per frame.
+
+struct UploadRingInfo {
+  daxa::Device device;
+  // one more than the frames the swapchain lets into flight
+  daxa_u32 frame_count = 3;
+  daxa_u32 frame_size = 4096;
+};
+
+struct UploadRing {
+  explicit UploadRing(UploadRingInfo const &info);
+  UploadRing(UploadRing const &) = delete;
+  UploadRing &operator=(UploadRing const &) = delete;
+  ~UploadRing();
+
+  // Moves on to the slot of the next frame.
+  void begin_frame();
+
+  // Stages size bytes and records their copy to dst_offset of dst_buffer.
+  void upload(daxa::CommandList &cmd_list, void const *data, daxa_u32 size,
+              daxa::BufferId dst_buffer, daxa_u32 dst_offset = 0);
+
+  template <typename T>
+  void upload(daxa::CommandList &cmd_list, T const &value,
+              daxa::BufferId dst_buffer, daxa_u32 dst_offset = 0) {
+    upload(cmd_list, &value, static_cast<daxa_u32>(sizeof(T)), dst_buffer,
+           dst_offset);
+  }
+
+  UploadRingInfo info;
+  daxa::BufferId buffer;
+  daxa::u8 *host_address = nullptr;
+  daxa_u32 frame_index = 0;
+  // bytes of the current slot in use
+  daxa_u32 frame_offset = 0;
+};